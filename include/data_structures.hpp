@@ -7,10 +7,23 @@
  */
 #include "data_structures/BST.hpp"
 #include "data_structures/Map.hpp"
+#include "data_structures/FlatMap.hpp"
+#include "data_structures/IntMap.hpp"
+#include "data_structures/ConcurrentMap.hpp"
+#include "data_structures/RcuMap.hpp"
+#include "data_structures/StableMap.hpp"
+#if __has_include(<sys/mman.h>)
+#include "data_structures/MappedMap.hpp"
+#endif
 #include "data_structures/Trie.hpp"
 #include "data_structures/List.hpp"
 #include "data_structures/Graph.hpp"
 #include "data_structures/Vector.hpp"
+#include "data_structures/SmallVector.hpp"
+#if __has_include(<sys/mman.h>)
+#include "data_structures/HugePageAllocator.hpp"
+#endif
 #include "data_structures/PriorityQueue.hpp"
+#include "data_structures/Algorithms.hpp"
 
 #endif
\ No newline at end of file
@@ -0,0 +1,324 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <functional>
+#include <iterator>
+#include <memory>
+#include <type_traits>
+#include <utility>
+#include "ThreadPool.hpp"
+#include "Vector.hpp"
+
+namespace data_structures {
+
+namespace parallel {
+
+// Parallel sort, transform, reduce, inclusive_scan and for_each over random access ranges, such
+// as those of a Vector. They run on a ThreadPool, default_pool() unless one is passed first, and
+// the calling thread takes part. As with the std::execution::par algorithms, the functions they
+// are given are called at the same time from several threads, for different elements, and
+// reduce() and inclusive_scan() group the operations in no particular order, so op must be
+// associative (reduce() also assumes it is commutative). If a call throws, the exception is
+// passed on once the calls already running are done; the range is then left partly processed.
+
+namespace detail {
+
+// Ranges are cut in about this many pieces per thread, so that threads that get ahead can steal the rest
+constexpr std::size_t pieces_per_thread {8};
+
+// No piece is smaller than this, or the tasks would cost more than the work
+constexpr std::size_t min_grain {4096};
+
+inline std::size_t grain(const ThreadPool& pool, std::size_t n) {
+    std::size_t g = n / (pool.size() * pieces_per_thread);
+    return g < min_grain ? min_grain : g;
+}
+
+inline std::size_t min(std::size_t a, std::size_t b) { return a < b ? a : b; }
+
+
+// How many of the first k elements of the merge of a[0, m) and b[0, n) come from a, with equal
+// elements taken from a first as std::merge() does
+template <typename It1, typename It2, typename Compare>
+std::size_t co_rank(std::size_t k, It1 a, std::size_t m, It2 b, std::size_t n, Compare& comp) {
+    std::size_t lo = k > n ? k - n : 0;
+    std::size_t hi = k < m ? k : m;
+    while (lo < hi) {
+        std::size_t i = lo + (hi - lo) / 2;
+        if (comp(b[k - i - 1], a[i]))
+            hi = i;
+        else
+            lo = i + 1;
+    }
+    return lo;
+}
+
+
+// Merges every two adjacent sorted runs of width elements from src into dst. The output is cut
+// into pieces that are merged independently, each starting where co_rank() says its runs meet,
+// so that even the last round, with a single pair of runs, keeps every thread busy. All the
+// ranks are found before any piece is merged, since merging moves from the elements they compare.
+template <typename Src, typename Dst, typename Compare>
+void merge_round(ThreadPool& pool, Src src, Dst dst, std::size_t n, std::size_t width, Compare& comp) {
+    std::size_t g = grain(pool, n);
+    std::size_t pieces = (n + g - 1) / g;
+
+    // rank[p] is how much of the first run of its pair comes before index p * g of the output
+    Vector<std::size_t> rank(pieces + 1, 0);
+    pool.for_range(pieces + 1, 1, [&](std::size_t begin, std::size_t end) {
+        for (std::size_t p = begin; p < end; ++p) {
+            std::size_t k = min(p * g, n);
+            std::size_t pair = k / (2 * width) * (2 * width);
+            std::size_t mid = min(pair + width, n);
+            rank[p] = co_rank(k - pair, src + pair, mid - pair, src + mid, min(pair + 2 * width, n) - mid, comp);
+        }
+    });
+
+    pool.for_range(pieces, 1, [&](std::size_t begin, std::size_t end) {
+        for (std::size_t p = begin; p < end; ++p) {
+            std::size_t lo = p * g;
+            std::size_t hi = min(lo + g, n);
+            std::size_t from_first = rank[p];
+            while (lo < hi) {
+                std::size_t pair = lo / (2 * width) * (2 * width);
+                std::size_t mid = min(pair + width, n);
+                std::size_t last = min(pair + 2 * width, n);
+                std::size_t stop = min(hi, last);
+                std::size_t to_first = stop < last ? rank[p + 1] : mid - pair;
+
+                std::merge(std::make_move_iterator(src + pair + from_first), std::make_move_iterator(src + pair + to_first),
+                           std::make_move_iterator(src + mid + (lo - pair - from_first)),
+                           std::make_move_iterator(src + mid + (stop - pair - to_first)),
+                           dst + lo, comp);
+                lo = stop;
+                from_first = 0;  // the next pair starts here
+            }
+        }
+    });
+}
+
+
+// Storage the elements of a range are moved into, piece by piece in parallel. A piece that
+// throws destroys what it had constructed itself; the finished ones are destroyed here.
+template <typename T>
+class SortBuffer {
+public:
+    template <typename RandomIt>
+    SortBuffer(ThreadPool& pool, RandomIt first, std::size_t in_n);
+    ~SortBuffer();
+
+    SortBuffer(const SortBuffer&) = delete;
+    SortBuffer& operator=(const SortBuffer&) = delete;
+
+    T* data;
+    std::size_t n;
+};
+
+
+template <typename T>
+template <typename RandomIt>
+SortBuffer<T>::SortBuffer(ThreadPool& pool, RandomIt first, std::size_t in_n)
+    : data{std::allocator<T>{}.allocate(in_n)}, n{in_n}
+{
+    std::size_t g = grain(pool, n);
+    std::size_t pieces = (n + g - 1) / g;
+    Vector<char> done(pieces, 0);
+    try {
+        pool.for_range(pieces, 1, [&](std::size_t begin, std::size_t end) {
+            for (std::size_t p = begin; p < end; ++p) {
+                std::uninitialized_move(first + p * g, first + min(p * g + g, n), data + p * g);
+                done[p] = 1;
+            }
+        });
+    }
+    catch (...) {
+        for (std::size_t p = 0; p < pieces; ++p)
+            if (done[p])
+                std::destroy(data + p * g, data + min(p * g + g, n));
+        std::allocator<T>{}.deallocate(data, n);
+        throw;
+    }
+}
+
+
+template <typename T>
+SortBuffer<T>::~SortBuffer() {
+    std::destroy(data, data + n);
+    std::allocator<T>{}.deallocate(data, n);
+}
+
+}
+
+
+// Sorts [first, last) by comp, not stably. Runs of about n / (4 * threads) elements are sorted
+// with std::sort() at the same time, then moved to a buffer and merged in pairs, back and forth
+// between the buffer and the range, until one run is left. If comp or a move throws, some of
+// the elements may be left moved-from.
+template <typename RandomIt, typename Compare = std::less<>>
+void sort(ThreadPool& pool, RandomIt first, RandomIt last, Compare comp = Compare()) {
+    using T = std::remove_cv_t<typename std::iterator_traits<RandomIt>::value_type>;
+
+    std::size_t n = static_cast<std::size_t>(last - first);
+    std::size_t width = n / (pool.size() * 4) + 1;
+    if (width < detail::min_grain)
+        width = detail::min_grain;
+    if (pool.size() == 1 || n <= width) {
+        std::sort(first, last, comp);
+        return;
+    }
+
+    std::size_t runs = (n + width - 1) / width;
+    pool.for_range(runs, 1, [&](std::size_t begin, std::size_t end) {
+        for (std::size_t r = begin; r < end; ++r)
+            std::sort(first + r * width, first + detail::min(r * width + width, n), comp);
+    });
+
+    detail::SortBuffer<T> buffer(pool, first, n);
+    bool in_buffer = true;
+    for (; width < n; width *= 2) {
+        if (in_buffer)
+            detail::merge_round(pool, buffer.data, first, n, width, comp);
+        else
+            detail::merge_round(pool, first, buffer.data, n, width, comp);
+        in_buffer = !in_buffer;
+    }
+
+    if (in_buffer) {
+        pool.for_range(n, detail::grain(pool, n), [&](std::size_t begin, std::size_t end) {
+            std::move(buffer.data + begin, buffer.data + end, first + begin);
+        });
+    }
+}
+
+
+template <typename RandomIt, typename Compare = std::less<>>
+void sort(RandomIt first, RandomIt last, Compare comp = Compare()) {
+    parallel::sort(default_pool(), first, last, comp);
+}
+
+
+// Calls f(element) for every element of [first, last)
+template <typename RandomIt, typename F>
+void for_each(ThreadPool& pool, RandomIt first, RandomIt last, F f) {
+    std::size_t n = static_cast<std::size_t>(last - first);
+    pool.for_range(n, detail::grain(pool, n), [&](std::size_t begin, std::size_t end) {
+        for (std::size_t i = begin; i < end; ++i)
+            f(first[i]);
+    });
+}
+
+
+template <typename RandomIt, typename F>
+void for_each(RandomIt first, RandomIt last, F f) {
+    parallel::for_each(default_pool(), first, last, std::move(f));
+}
+
+
+// Stores op(first[i]) in d_first[i] and returns the end of the output. The output may be the input.
+template <typename RandomIt, typename OutputIt, typename F>
+OutputIt transform(ThreadPool& pool, RandomIt first, RandomIt last, OutputIt d_first, F op) {
+    std::size_t n = static_cast<std::size_t>(last - first);
+    pool.for_range(n, detail::grain(pool, n), [&](std::size_t begin, std::size_t end) {
+        for (std::size_t i = begin; i < end; ++i)
+            d_first[i] = op(first[i]);
+    });
+    return d_first + n;
+}
+
+
+template <typename RandomIt, typename OutputIt, typename F>
+OutputIt transform(RandomIt first, RandomIt last, OutputIt d_first, F op) {
+    return parallel::transform(default_pool(), first, last, d_first, std::move(op));
+}
+
+
+// Combines init and every element with op. Each piece of the range is folded on its own and
+// the results of the pieces are folded into init in order.
+template <typename RandomIt, typename T, typename Op = std::plus<>>
+T reduce(ThreadPool& pool, RandomIt first, RandomIt last, T init, Op op = Op()) {
+    std::size_t n = static_cast<std::size_t>(last - first);
+    std::size_t g = detail::grain(pool, n);
+    std::size_t pieces = (n + g - 1) / g;
+    if (pieces <= 1) {
+        for (std::size_t i = 0; i < n; ++i)
+            init = op(std::move(init), first[i]);
+        return init;
+    }
+
+    Vector<T> partial(pieces, init);
+    pool.for_range(pieces, 1, [&](std::size_t begin, std::size_t end) {
+        for (std::size_t p = begin; p < end; ++p) {
+            T acc = first[p * g];
+            for (std::size_t i = p * g + 1; i < detail::min(p * g + g, n); ++i)
+                acc = op(std::move(acc), first[i]);
+            partial[p] = std::move(acc);
+        }
+    });
+
+    for (std::size_t p = 0; p < pieces; ++p)
+        init = op(std::move(init), std::move(partial[p]));
+    return init;
+}
+
+
+template <typename RandomIt, typename T, typename Op = std::plus<>>
+T reduce(RandomIt first, RandomIt last, T init, Op op = Op()) {
+    return parallel::reduce(default_pool(), first, last, std::move(init), std::move(op));
+}
+
+
+// Stores op(first[0], ..., first[i]) in d_first[i] and returns the end of the output. The output
+// may be the input. The range is read twice: once to total every piece but the last, then once
+// more to scan each piece, starting from the total of the pieces before it.
+template <typename RandomIt, typename OutputIt, typename Op = std::plus<>>
+OutputIt inclusive_scan(ThreadPool& pool, RandomIt first, RandomIt last, OutputIt d_first, Op op = Op()) {
+    using T = std::remove_cv_t<typename std::iterator_traits<RandomIt>::value_type>;
+
+    std::size_t n = static_cast<std::size_t>(last - first);
+    if (n == 0)
+        return d_first;
+    std::size_t g = detail::grain(pool, n);
+    std::size_t pieces = (n + g - 1) / g;
+
+    auto scan = [&](std::size_t begin, std::size_t end, const T* carry) {
+        T acc = carry ? op(*carry, first[begin]) : T(first[begin]);
+        d_first[begin] = acc;
+        for (std::size_t i = begin + 1; i < end; ++i) {
+            acc = op(std::move(acc), first[i]);
+            d_first[i] = acc;
+        }
+    };
+    if (pieces <= 1) {
+        scan(0, n, nullptr);
+        return d_first + n;
+    }
+
+    Vector<T> totals(pieces - 1, T(first[0]));
+    pool.for_range(pieces - 1, 1, [&](std::size_t begin, std::size_t end) {
+        for (std::size_t p = begin; p < end; ++p) {
+            T acc = first[p * g];
+            for (std::size_t i = p * g + 1; i < p * g + g; ++i)
+                acc = op(std::move(acc), first[i]);
+            totals[p] = std::move(acc);
+        }
+    });
+    for (std::size_t p = 1; p < pieces - 1; ++p)
+        totals[p] = op(totals[p - 1], totals[p]);
+
+    pool.for_range(pieces, 1, [&](std::size_t begin, std::size_t end) {
+        for (std::size_t p = begin; p < end; ++p)
+            scan(p * g, detail::min(p * g + g, n), p ? &totals[p - 1] : nullptr);
+    });
+    return d_first + n;
+}
+
+
+template <typename RandomIt, typename OutputIt, typename Op = std::plus<>>
+OutputIt inclusive_scan(RandomIt first, RandomIt last, OutputIt d_first, Op op = Op()) {
+    return parallel::inclusive_scan(default_pool(), first, last, d_first, std::move(op));
+}
+
+}
+
+}
@@ -0,0 +1,93 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <type_traits>
+#include <utility>
+
+namespace data_structures {
+
+// The containers take their memory from an Allocator template parameter (std::allocator by
+// default) through std::allocator_traits, so any standard conforming allocator can be used,
+// std::pmr::polymorphic_allocator included. They follow the rules of the std containers:
+// a copy gets select_on_container_copy_construction() of the original's allocator, a move
+// takes the allocator along, and assignment and swap only replace the allocator when the
+// propagate_on_container_* traits say so. Swapping two containers whose allocators do not
+// propagate on swap and compare unequal is undefined, as it is for std containers.
+// Node based containers rebind the allocator to their node type. Allocators with fancy
+// pointer types are not supported.
+
+// Lets a member of an empty allocator type take no space. [[no_unique_address]] is a C++20
+// attribute that GCC also honours in C++17 without a warning; other compilers get it from C++20 on.
+#if defined(__has_cpp_attribute)
+#if __has_cpp_attribute(no_unique_address) && (__cplusplus >= 202002L || (defined(__GNUC__) && !defined(__clang__)))
+#define DATA_STRUCTURES_NO_UNIQUE_ADDRESS [[no_unique_address]]
+#endif
+#endif
+#ifndef DATA_STRUCTURES_NO_UNIQUE_ADDRESS
+#define DATA_STRUCTURES_NO_UNIQUE_ADDRESS
+#endif
+
+template <typename A, typename U>
+using rebind_alloc_t = typename std::allocator_traits<A>::template rebind_alloc<U>;
+
+template <typename A>
+constexpr bool propagate_on_copy_v = std::allocator_traits<A>::propagate_on_container_copy_assignment::value;
+
+template <typename A>
+constexpr bool propagate_on_move_v = std::allocator_traits<A>::propagate_on_container_move_assignment::value;
+
+template <typename A>
+constexpr bool propagate_on_swap_v = std::allocator_traits<A>::propagate_on_container_swap::value;
+
+template <typename A>
+constexpr bool always_equal_v = std::allocator_traits<A>::is_always_equal::value;
+
+// Allocators that can resize a buffer without copying it (HugePageAllocator remaps its pages)
+// offer T* reallocate(T* p, std::size_t old_n, std::size_t new_n), which keeps the bytes of the
+// first min(old_n, new_n) elements like realloc() does
+template <typename A, typename = void>
+constexpr bool has_reallocate_v = false;
+
+template <typename A>
+constexpr bool has_reallocate_v<A, std::void_t<decltype(std::declval<A&>().reallocate(
+    std::declval<typename std::allocator_traits<A>::pointer>(), std::size_t{}, std::size_t{}))>> = true;
+
+
+// Allocates a single node from alloc and constructs it from args
+template <typename A, typename... Args>
+typename std::allocator_traits<A>::value_type* create_node(A& alloc, Args&&... args) {
+    using traits = std::allocator_traits<A>;
+    static_assert(std::is_pointer_v<typename traits::pointer>, "fancy pointers are not supported");
+
+    typename traits::pointer p = traits::allocate(alloc, 1);
+    try {
+        traits::construct(alloc, p, std::forward<Args>(args)...);
+    }
+    catch (...) {
+        traits::deallocate(alloc, p, 1);
+        throw;
+    }
+    return p;
+}
+
+
+// Destroys and frees a node that came from create_node
+template <typename A>
+void destroy_node(A& alloc, typename std::allocator_traits<A>::value_type* p) noexcept {
+    using traits = std::allocator_traits<A>;
+    traits::destroy(alloc, p);
+    traits::deallocate(alloc, p, 1);
+}
+
+
+// Exchanges the allocators of two containers that are being swapped, if they propagate on swap
+template <typename A>
+void swap_allocators(A& lhs, A& rhs) noexcept {
+    if constexpr (propagate_on_swap_v<A>) {
+        using std::swap;
+        swap(lhs, rhs);
+    }
+}
+
+}
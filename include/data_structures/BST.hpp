@@ -4,13 +4,15 @@
 #include <cstddef>
 #include <initializer_list>
 #include <iterator>
+#include <memory>
 #include <stdexcept>
 #include <utility>
+#include "Allocator.hpp"
 
 namespace data_structures {
 
-template <typename T> class BST_Iterator;
-template <typename T> class Const_BST_Iterator;
+template <typename T, typename A = std::allocator<T>> class BST_Iterator;
+template <typename T, typename A = std::allocator<T>> class Const_BST_Iterator;
 
 template <typename T>
 struct TreeNode {
@@ -39,15 +41,22 @@ struct TreeNode {
 };
 
 
-template <typename T>
+// The nodes come from A rebound to TreeNode<T> (see Allocator.hpp)
+template <typename T, typename A = std::allocator<T>>
 class BST {
+    using node_allocator = rebind_alloc_t<A, TreeNode<T>>;
+
 public:
-    using iterator = BST_Iterator<T>;
-    using const_iterator = Const_BST_Iterator<T>;
+    using iterator = BST_Iterator<T,A>;
+    using const_iterator = Const_BST_Iterator<T,A>;
+    using allocator_type = A;
 
     BST();
-    BST(const std::initializer_list<T>& list);
+    explicit BST(const A& in_alloc);
+    BST(const std::initializer_list<T>& list, const A& in_alloc = A());
     ~BST();
+
+    A get_allocator() const { return A(alloc); }
     
     void insert(const T& value);
     bool search(const T& value);
@@ -66,6 +75,7 @@ public:
 private:
     TreeNode<T>* root;
     std::size_t sz;
+    DATA_STRUCTURES_NO_UNIQUE_ADDRESS node_allocator alloc;
 
     TreeNode<T>* p_insert(TreeNode<T>* node, const T& value, bool& inserted);
     TreeNode<T>* p_search(TreeNode<T>* node, const T& value);
@@ -77,49 +87,53 @@ private:
     TreeNode<T>* p_remove_min(TreeNode<T>* node, TreeNode<T>** min_node);
     void p_destroy(TreeNode<T>* node);
     
-    friend class BST_Iterator<T>;
-    friend class Const_BST_Iterator<T>;
+    friend class BST_Iterator<T,A>;
+    friend class Const_BST_Iterator<T,A>;
 };
 
 
-template <typename T>
-BST<T>::BST() : root{}, sz{} {}
+template <typename T, typename A>
+BST<T,A>::BST() : root{}, sz{}, alloc{} {}
 
 
-template <typename T>
-BST<T>::BST(const std::initializer_list<T>& list) : root{}, sz{} {
+template <typename T, typename A>
+BST<T,A>::BST(const A& in_alloc) : root{}, sz{}, alloc{in_alloc} {}
+
+
+template <typename T, typename A>
+BST<T,A>::BST(const std::initializer_list<T>& list, const A& in_alloc) : root{}, sz{}, alloc{in_alloc} {
     for (auto& value : list)
         insert(value);
 }
 
 
-template <typename T>
-BST<T>::~BST() {
+template <typename T, typename A>
+BST<T,A>::~BST() {
     p_destroy(root);
 }
 
-template <typename T>
-void BST<T>::p_destroy(TreeNode<T>* node) {
+template <typename T, typename A>
+void BST<T,A>::p_destroy(TreeNode<T>* node) {
     if (!node) return;
     p_destroy(node->left);
     p_destroy(node->right);
-    delete node;
+    destroy_node(alloc, node);
 }
 
 
-template <typename T>
-void BST<T>::insert(const T& value) {
+template <typename T, typename A>
+void BST<T,A>::insert(const T& value) {
     bool inserted {false};
     root = p_insert(root, value, inserted);
     if (inserted)
         ++sz;
 }
 
-template <typename T>
-TreeNode<T>* BST<T>::p_insert(TreeNode<T>* node, const T& value, bool& inserted) {
+template <typename T, typename A>
+TreeNode<T>* BST<T,A>::p_insert(TreeNode<T>* node, const T& value, bool& inserted) {
     if (!node) {
         inserted = true;
-        node = new TreeNode<T>{value};
+        node = create_node(alloc, value);
     }
     else if (node->data > value) {
         node->left = p_insert(node->left, value, inserted);
@@ -133,13 +147,13 @@ TreeNode<T>* BST<T>::p_insert(TreeNode<T>* node, const T& value, bool& inserted)
 }
 
 
-template<typename T>
-bool BST<T>::search(const T& value) {
+template <typename T, typename A>
+bool BST<T,A>::search(const T& value) {
     return p_search(root, value) != nullptr;
 }
 
-template<typename T>
-TreeNode<T>* BST<T>::p_search(TreeNode<T>* node, const T& value) {
+template <typename T, typename A>
+TreeNode<T>* BST<T,A>::p_search(TreeNode<T>* node, const T& value) {
     if (!node)                      return nullptr;
     else if (node->data == value)   return node;
     else if (node->data < value)    return p_search(node->right, value);
@@ -147,15 +161,15 @@ TreeNode<T>* BST<T>::p_search(TreeNode<T>* node, const T& value) {
 }
 
 
-template<typename T>
-TreeNode<T>* BST<T>::p_find_min(TreeNode<T>* node) const {
+template <typename T, typename A>
+TreeNode<T>* BST<T,A>::p_find_min(TreeNode<T>* node) const {
     return node != nullptr && node->left != nullptr 
            ? p_find_min(node->left)    // If a left subtree exists the min value will be there,
 	       : node;					   // otherwise the min value is in node
 }
 
-template<typename T>
-TreeNode<T>* BST<T>::p_find_max(TreeNode<T>* node) const {
+template <typename T, typename A>
+TreeNode<T>* BST<T,A>::p_find_max(TreeNode<T>* node) const {
     return node != nullptr && node->right != nullptr 
            ? p_find_max(node->right)
 		   : node;
@@ -163,8 +177,8 @@ TreeNode<T>* BST<T>::p_find_max(TreeNode<T>* node) const {
     
 
 // Returns target's previous in order TreeNode in the subtree with root node or nullptr if target is the subtree's min. 
-template<typename T>
-TreeNode<T>* BST<T>::p_find_previous(TreeNode<T>* node, TreeNode<T>* target) const {
+template <typename T, typename A>
+TreeNode<T>* BST<T,A>::p_find_previous(TreeNode<T>* node, TreeNode<T>* target) const {
     if (node == target)    // If target is root of the subtree then its previous will be the maximum value in the left subtree
         return p_find_max(node->left);
     else if (node->data > target->data)    // Target is in the left subtree so his previous will there too
@@ -176,8 +190,8 @@ TreeNode<T>* BST<T>::p_find_previous(TreeNode<T>* node, TreeNode<T>* target) con
 }
 
 // Returns target's next in order TreeNode in the subtree with root node or nullptr if target is the subtree's max. 
-template<typename T>
-TreeNode<T>* BST<T>::p_find_next(TreeNode<T>* node, TreeNode<T>* target) const {
+template <typename T, typename A>
+TreeNode<T>* BST<T,A>::p_find_next(TreeNode<T>* node, TreeNode<T>* target) const {
     if (node == target)    // If target is root of the subtree then its next will be the minimum value in the right subtree
         return p_find_min(node->right);
     else if (node->data < target->data)    // Target is in the right subtree so his next will there too
@@ -189,8 +203,8 @@ TreeNode<T>* BST<T>::p_find_next(TreeNode<T>* node, TreeNode<T>* target) const {
 }
 
 
-template<typename T>
-void BST<T>::remove(const T& value) {
+template <typename T, typename A>
+void BST<T,A>::remove(const T& value) {
     bool removed {false};
     root = p_remove(root, value, removed);
     if (!removed)
@@ -198,8 +212,8 @@ void BST<T>::remove(const T& value) {
     --sz;
 }
 
-template<typename T>
-TreeNode<T>* BST<T>::p_remove(TreeNode<T>* node, const T& value, bool& removed) {
+template <typename T, typename A>
+TreeNode<T>* BST<T,A>::p_remove(TreeNode<T>* node, const T& value, bool& removed) {
     if (!node)  return nullptr;
 
     if (node->data == value) {
@@ -207,7 +221,7 @@ TreeNode<T>* BST<T>::p_remove(TreeNode<T>* node, const T& value, bool& removed)
 
         // If node is a leaf just delete it
         if (node->is_leaf()) {
-            delete node;
+            destroy_node(alloc, node);
             return nullptr;
         }
 
@@ -215,7 +229,7 @@ TreeNode<T>* BST<T>::p_remove(TreeNode<T>* node, const T& value, bool& removed)
         else if (node->has_one_child()) {
             TreeNode<T>* node_child = node->left != nullptr ? node->left : node->right;
             node_child->parent = node->parent;
-            delete node;
+            destroy_node(alloc, node);
             return node_child;
         }
 
@@ -244,7 +258,7 @@ TreeNode<T>* BST<T>::p_remove(TreeNode<T>* node, const T& value, bool& removed)
             node->right->parent = previous;
             previous->parent = node->parent;
 
-            delete node;
+            destroy_node(alloc, node);
             return previous;
         }
     }
@@ -257,20 +271,20 @@ TreeNode<T>* BST<T>::p_remove(TreeNode<T>* node, const T& value, bool& removed)
 }
 
 
-template <typename T>
-void BST<T>::clear() {
+template <typename T, typename A>
+void BST<T,A>::clear() {
     p_destroy(root);
     root = nullptr;
     sz = 0;
 }
 
 
-template <typename T>
+template <typename T, typename A>
 class BST_Iterator {
 private:
-    BST<T>* bst;
+    BST<T,A>* bst;
     TreeNode<T>* current;
-    friend class BST<T>;
+    friend class BST<T,A>;
 public:
     using iterator_category = std::forward_iterator_tag;
     using difference_type = std::ptrdiff_t;
@@ -280,7 +294,7 @@ public:
 
     BST_Iterator() : bst{}, current{} {}
 
-    BST_Iterator(BST<T>* in_bst, TreeNode<T>* in_current = nullptr)
+    BST_Iterator(BST<T,A>* in_bst, TreeNode<T>* in_current = nullptr)
         : bst{in_bst}, current{in_current} {}
 
     BST_Iterator& operator++() {
@@ -316,12 +330,12 @@ public:
 };
 
 
-template <typename T>
+template <typename T, typename A>
 class Const_BST_Iterator {
 private:
-    const BST<T>* bst;
+    const BST<T,A>* bst;
     TreeNode<T>* current;
-    friend class BST<T>;
+    friend class BST<T,A>;
 public:
     using iterator_category = std::forward_iterator_tag;
     using difference_type = std::ptrdiff_t;
@@ -331,7 +345,7 @@ public:
 
     Const_BST_Iterator() : bst{}, current{} {}
 
-    Const_BST_Iterator(const BST<T>* in_bst, TreeNode<T>* in_current = nullptr)
+    Const_BST_Iterator(const BST<T,A>* in_bst, TreeNode<T>* in_current = nullptr)
         : bst{in_bst}, current{in_current} {}
 
     Const_BST_Iterator& operator++() {
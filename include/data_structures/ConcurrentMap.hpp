@@ -0,0 +1,184 @@
+#pragma once
+
+#include "Map.hpp"
+#include <cstdint>
+#include <mutex>
+#include <optional>
+#include <shared_mutex>
+
+namespace data_structures {
+
+// A Map split into independently locked shards. Readers of a shard share its lock,
+// writers take it exclusively, so threads only contend when their keys land in the same shard.
+// Since references into a shard are not safe once its lock is released, values are returned
+// by copy or accessed through visit()/upsert(), which run a function while the lock is held.
+template <typename K, typename V, typename H = std::hash<K>>
+class ConcurrentMap {
+public:
+    explicit ConcurrentMap(std::size_t shards = default_shards);
+    ConcurrentMap(const ConcurrentMap&) = delete;
+    ConcurrentMap& operator=(const ConcurrentMap&) = delete;
+    ~ConcurrentMap();
+
+    void insert(const K& key, const V& value);
+    bool remove(const K& key);
+
+    std::optional<V> find(const K& key) const;
+    bool contains(const K& key) const;
+
+    // Calls fn(V&) on the value of key, inserting a default V first if key is missing
+    template <typename F>
+    void upsert(const K& key, F fn);
+
+    // Calls fn on the value of key if it exists and returns whether it did.
+    // The non-const version holds the shard exclusively, the const one shares it.
+    template <typename F>
+    bool visit(const K& key, F fn);
+    template <typename F>
+    bool visit(const K& key, F fn) const;
+
+    std::size_t size() const;
+    bool empty() const { return size() == 0; }
+    std::size_t shard_count() const { return no_shards; }
+
+    void clear();
+
+private:
+    static constexpr std::size_t default_shards {64};
+
+    // Each shard gets its own cache line so that locking one does not invalidate its neighbours
+    struct alignas(64) Shard {
+        mutable std::shared_mutex mutex;
+        Map<K,V,H> map;
+    };
+
+    Shard* shards;
+    std::size_t no_shards;
+    unsigned shift;
+    H hash_function;
+
+    Shard& shard_of(const K& key) const;
+};
+
+
+// The number of shards is rounded up to a power of two
+template <typename K, typename V, typename H>
+ConcurrentMap<K,V,H>::ConcurrentMap(std::size_t in_shards)
+    : no_shards{1}, shift{64}, hash_function{H()}
+{
+    while (no_shards < in_shards) {
+        no_shards *= 2;
+        --shift;
+    }
+    shards = new Shard[no_shards];
+}
+
+
+template <typename K, typename V, typename H>
+ConcurrentMap<K,V,H>::~ConcurrentMap() {
+    delete[] shards;
+}
+
+
+// The shard is picked from the high bits of a multiplicative hash, since the Map
+// inside the shard uses hash % cap and would otherwise see only a fraction of its buckets.
+template <typename K, typename V, typename H>
+typename ConcurrentMap<K,V,H>::Shard& ConcurrentMap<K,V,H>::shard_of(const K& key) const {
+    if (no_shards == 1)
+        return shards[0];
+    std::uint64_t h = static_cast<std::uint64_t>(hash_function(key)) * 0x9E3779B97F4A7C15ULL;
+    return shards[h >> shift];
+}
+
+
+template <typename K, typename V, typename H>
+void ConcurrentMap<K,V,H>::insert(const K& key, const V& value) {
+    Shard& s = shard_of(key);
+    std::unique_lock<std::shared_mutex> lock{s.mutex};
+    s.map.insert(key, value);
+}
+
+
+template <typename K, typename V, typename H>
+bool ConcurrentMap<K,V,H>::remove(const K& key) {
+    Shard& s = shard_of(key);
+    std::unique_lock<std::shared_mutex> lock{s.mutex};
+    return s.map.erase_key(key);
+}
+
+
+template <typename K, typename V, typename H>
+std::optional<V> ConcurrentMap<K,V,H>::find(const K& key) const {
+    Shard& s = shard_of(key);
+    std::shared_lock<std::shared_mutex> lock{s.mutex};
+    std::pair<K,V>* p = s.map.lookup(key);
+    if (!p)
+        return std::nullopt;
+    return p->second;
+}
+
+
+template <typename K, typename V, typename H>
+bool ConcurrentMap<K,V,H>::contains(const K& key) const {
+    Shard& s = shard_of(key);
+    std::shared_lock<std::shared_mutex> lock{s.mutex};
+    return s.map.lookup(key) != nullptr;
+}
+
+
+template <typename K, typename V, typename H>
+template <typename F>
+void ConcurrentMap<K,V,H>::upsert(const K& key, F fn) {
+    Shard& s = shard_of(key);
+    std::unique_lock<std::shared_mutex> lock{s.mutex};
+    fn(s.map[key]);
+}
+
+
+template <typename K, typename V, typename H>
+template <typename F>
+bool ConcurrentMap<K,V,H>::visit(const K& key, F fn) {
+    Shard& s = shard_of(key);
+    std::unique_lock<std::shared_mutex> lock{s.mutex};
+    std::pair<K,V>* p = s.map.lookup(key);
+    if (!p)
+        return false;
+    fn(p->second);
+    return true;
+}
+
+
+template <typename K, typename V, typename H>
+template <typename F>
+bool ConcurrentMap<K,V,H>::visit(const K& key, F fn) const {
+    Shard& s = shard_of(key);
+    std::shared_lock<std::shared_mutex> lock{s.mutex};
+    const std::pair<K,V>* p = s.map.lookup(key);
+    if (!p)
+        return false;
+    fn(p->second);
+    return true;
+}
+
+
+// Shards are counted one after the other, so under concurrent writes the result is only a snapshot
+template <typename K, typename V, typename H>
+std::size_t ConcurrentMap<K,V,H>::size() const {
+    std::size_t total {};
+    for (std::size_t i = 0; i < no_shards; ++i) {
+        std::shared_lock<std::shared_mutex> lock{shards[i].mutex};
+        total += shards[i].map.size();
+    }
+    return total;
+}
+
+
+template <typename K, typename V, typename H>
+void ConcurrentMap<K,V,H>::clear() {
+    for (std::size_t i = 0; i < no_shards; ++i) {
+        std::unique_lock<std::shared_mutex> lock{shards[i].mutex};
+        shards[i].map.clear();
+    }
+}
+
+}
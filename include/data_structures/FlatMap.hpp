@@ -0,0 +1,546 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <initializer_list>
+#include <iterator>
+#include <new>
+#include <stdexcept>
+#include <utility>
+#include "HashMix.hpp"
+#include "MapStats.hpp"
+#include "Simd.hpp"
+
+namespace data_structures {
+
+template <typename K, typename V, typename H> class Flat_Map_Iterator;
+template <typename K, typename V, typename H> class Const_Flat_Map_Iterator;
+
+// Open addressing hash map in the style of Swiss tables.
+// Every slot has a one byte control value: empty, deleted or the low 7 bits of the key's hash.
+// Keys and values live inline in one contiguous slot array. A probe compares the control bytes
+// of a whole group at once (AVX2 when the cpu has it, SSE2 or scalar code otherwise),
+// so a lookup touches half a cache line of metadata and then (usually) a single slot.
+template <typename K, typename V, typename H = std::hash<K>>
+class FlatMap {
+public:
+    using iterator = Flat_Map_Iterator<K,V,H>;
+    using const_iterator = Const_Flat_Map_Iterator<K,V,H>;
+
+    FlatMap();
+    explicit FlatMap(H in_hash);
+    explicit FlatMap(const std::initializer_list<std::pair<K,V>>& list);
+    FlatMap(const FlatMap& map);
+    FlatMap(FlatMap&& map) noexcept;
+    ~FlatMap();
+
+    void insert(const K& key, const V& value);
+    void remove(const K& key);
+
+    std::size_t size()     const { return sz;      }
+    std::size_t capacity() const { return cap;     }
+    bool empty()           const { return sz == 0; }
+
+    void clear();
+    void swap(FlatMap& rhs) noexcept;
+
+    V& operator[](const K& key);
+    const V& operator[](const K& key) const;
+    FlatMap&  operator=(const FlatMap& rhs);
+    FlatMap&  operator=(FlatMap&& rhs) noexcept;
+
+    iterator find(const K& key);
+    const_iterator find(const K& key) const;
+    bool contains(const K& key) const { return counted_find_index(key) != npos; }
+
+    MapStats stats() const;
+
+    iterator begin() { return iterator{this, next_full(0)}; }
+    iterator end()   { return iterator{this, cap};          }
+
+    const_iterator cbegin() const { return const_iterator{this, next_full(0)}; }
+    const_iterator cend()   const { return const_iterator{this, cap};          }
+
+private:
+    friend class Flat_Map_Iterator<K,V,H>;
+    friend class Const_Flat_Map_Iterator<K,V,H>;
+
+    using ctrl_t = signed char;
+
+    static constexpr ctrl_t ctrl_empty   {-128};   // 0b10000000
+    static constexpr ctrl_t ctrl_deleted {-2};     // 0b11111110
+
+    static constexpr std::size_t group_width {32};
+    static constexpr std::size_t min_cap {group_width};
+    static constexpr std::size_t npos = static_cast<std::size_t>(-1);
+
+    std::size_t sz {};
+    std::size_t cap {};
+    std::size_t growth_left {};  // how many empty slots we may still fill before rehashing
+
+    H hash_function;
+    ctrl_t* ctrl {};
+    std::pair<K,V>* slots {};
+
+    std::size_t rehashes {};
+    std::chrono::nanoseconds rehash_time {};
+    LookupCounters counters;
+
+    static std::size_t max_load(std::size_t n) { return n - n / 8; }  // 7/8 load factor
+
+    // Each returns a bitmask with one bit per slot of the group
+    static std::uint32_t match_byte(const ctrl_t* group, ctrl_t h2) { return simd::match_byte(group, h2);         }
+    static std::uint32_t match_empty(const ctrl_t* group)           { return simd::match_byte(group, ctrl_empty); }
+    static std::uint32_t match_empty_or_deleted(const ctrl_t* group) { return simd::match_negative(group);       }
+
+    // Mixed, or the identity std::hash of integers would put consecutive keys in one group with one control byte
+    std::size_t hash_of(const K& key) const { return detail::mix_hash(hash_function(key)); }
+    std::size_t find_index(const K& key) const;
+    std::size_t counted_find_index(const K& key) const {  // records a hit or a miss for stats()
+        std::size_t index = find_index(key);
+        counters.record(index != npos);
+        return index;
+    }
+    std::size_t find_insert_slot(std::size_t hash) const;
+    std::size_t next_full(std::size_t pos) const;
+
+    void allocate(std::size_t n);
+    void deallocate();
+    void rehash(std::size_t new_cap);
+    V& insert_unique(std::size_t hash, const K& key, const V& value);
+};
+
+
+template <typename K, typename V, typename H>
+FlatMap<K,V,H>::FlatMap()
+    : hash_function{H()} {}
+
+
+template <typename K, typename V, typename H>
+FlatMap<K,V,H>::FlatMap(H in_hash)
+    : hash_function{in_hash} {}
+
+
+template <typename K, typename V, typename H>
+FlatMap<K,V,H>::FlatMap(const std::initializer_list<std::pair<K,V>>& list)
+    : hash_function{H()}
+{
+    for (auto& e : list)
+        insert(e.first, e.second);
+}
+
+
+template <typename K, typename V, typename H>
+FlatMap<K,V,H>::FlatMap(const FlatMap& map)
+    : hash_function{map.hash_function}
+{
+    if (!map.cap)
+        return;
+
+    allocate(map.cap);
+    for (std::size_t i = 0; i < map.cap; ++i) {
+        if (map.ctrl[i] >= 0) {
+            new (&slots[i]) std::pair<K,V>(map.slots[i]);
+            ctrl[i] = map.ctrl[i];
+        }
+        else if (map.ctrl[i] == ctrl_deleted)
+            ctrl[i] = ctrl_deleted;
+    }
+    sz = map.sz;
+    growth_left = map.growth_left;
+}
+
+
+template <typename K, typename V, typename H>
+FlatMap<K,V,H>::FlatMap(FlatMap&& map) noexcept
+    : hash_function{H()}
+{
+    map.swap(*this);
+}
+
+
+template <typename K, typename V, typename H>
+FlatMap<K,V,H>::~FlatMap() {
+    deallocate();
+}
+
+
+template <typename K, typename V, typename H>
+void FlatMap<K,V,H>::allocate(std::size_t n) {
+    ctrl = (ctrl_t*)::operator new(n * sizeof(ctrl_t));
+    slots = (std::pair<K,V>*)::operator new(n * sizeof(std::pair<K,V>));
+    for (std::size_t i = 0; i < n; ++i)
+        ctrl[i] = ctrl_empty;
+    cap = n;
+    sz = 0;
+    growth_left = max_load(n);
+}
+
+
+template <typename K, typename V, typename H>
+void FlatMap<K,V,H>::deallocate() {
+    if (!ctrl)
+        return;
+    for (std::size_t i = 0; i < cap; ++i)
+        if (ctrl[i] >= 0)
+            slots[i].~pair();
+    ::operator delete(ctrl, cap * sizeof(ctrl_t));
+    ::operator delete(slots, cap * sizeof(std::pair<K,V>));
+    ctrl = nullptr;
+    slots = nullptr;
+    cap = sz = growth_left = 0;
+}
+
+
+// The table is split into aligned groups of group_width slots. The high bits of the hash
+// choose the first group and the probe sequence visits the groups in triangular order,
+// which covers all of them because their number is a power of two.
+// A group that contains an empty slot ends the search.
+template <typename K, typename V, typename H>
+std::size_t FlatMap<K,V,H>::find_index(const K& key) const {
+    if (!cap)
+        return npos;
+
+    std::size_t hash = hash_of(key);
+    ctrl_t h2 = static_cast<ctrl_t>(hash & 0x7F);
+    std::size_t group_mask = cap / group_width - 1;
+    std::size_t group = (hash >> 7) & group_mask;
+
+    for (std::size_t step = 0; step <= group_mask; ++step) {
+        const ctrl_t* g = ctrl + group * group_width;
+        for (std::uint32_t m = match_byte(g, h2); m; m &= m - 1) {
+            std::size_t index = group * group_width + simd::first_bit(m);
+            if (slots[index].first == key)
+                return index;
+        }
+        if (match_empty(g))
+            return npos;
+        group = (group + step + 1) & group_mask;
+    }
+    return npos;
+}
+
+
+// The probe length of an element is the number of groups a lookup of its key visits,
+// from its home group (length 1) along the triangular sequence up to the group it sits in.
+template <typename K, typename V, typename H>
+MapStats FlatMap<K,V,H>::stats() const {
+    MapStats s;
+    s.size = sz;
+    s.buckets = cap;
+    s.load_factor = cap ? static_cast<double>(sz) / cap : 0.0;
+    s.rehashes = rehashes;
+    s.rehash_time = rehash_time;
+    s.bytes_allocated = cap * (sizeof(ctrl_t) + sizeof(std::pair<K,V>));
+    s.hits = counters.hits();
+    s.misses = counters.misses();
+
+    std::size_t group_mask = cap / group_width - 1;
+    for (std::size_t i = 0; i < cap; ++i) {
+        if (ctrl[i] < 0)
+            continue;
+        std::size_t group = (hash_of(slots[i].first) >> 7) & group_mask;
+        std::size_t length {1};
+        for (std::size_t step = 0; group != i / group_width; ++step, ++length)
+            group = (group + step + 1) & group_mask;
+
+        while (s.histogram.size() <= length)
+            s.histogram.push_back(0);
+        ++s.histogram[length];
+        if (length > s.max_length)
+            s.max_length = length;
+    }
+    return s;
+}
+
+
+// Returns the first empty or deleted slot on the probe sequence of hash
+template <typename K, typename V, typename H>
+std::size_t FlatMap<K,V,H>::find_insert_slot(std::size_t hash) const {
+    std::size_t group_mask = cap / group_width - 1;
+    std::size_t group = (hash >> 7) & group_mask;
+
+    for (std::size_t step = 0; ; ++step) {
+        std::uint32_t m = match_empty_or_deleted(ctrl + group * group_width);
+        if (m)
+            return group * group_width + simd::first_bit(m);
+        group = (group + step + 1) & group_mask;
+    }
+}
+
+
+template <typename K, typename V, typename H>
+std::size_t FlatMap<K,V,H>::next_full(std::size_t pos) const {
+    while (pos < cap && ctrl[pos] < 0)
+        ++pos;
+    return pos;
+}
+
+
+// Moves every element into a fresh table of new_cap slots. Deleted slots are dropped on the way.
+template <typename K, typename V, typename H>
+void FlatMap<K,V,H>::rehash(std::size_t new_cap) {
+    if (cap)
+        ++rehashes;  // the first allocation of the table is not a rehash
+    ScopedTimer timer{rehash_time};
+
+    ctrl_t* old_ctrl = ctrl;
+    std::pair<K,V>* old_slots = slots;
+    std::size_t old_cap = cap;
+    std::size_t old_sz = sz;
+
+    allocate(new_cap);
+
+    for (std::size_t i = 0; i < old_cap; ++i) {
+        if (old_ctrl[i] < 0)
+            continue;
+        std::size_t hash = hash_of(old_slots[i].first);
+        std::size_t index = find_insert_slot(hash);
+        new (&slots[index]) std::pair<K,V>(std::move(old_slots[i]));
+        ctrl[index] = static_cast<ctrl_t>(hash & 0x7F);
+        old_slots[i].~pair();
+    }
+    sz = old_sz;
+    growth_left -= sz;
+
+    ::operator delete(old_ctrl, old_cap * sizeof(ctrl_t));
+    ::operator delete(old_slots, old_cap * sizeof(std::pair<K,V>));
+}
+
+
+// Inserts a key that is known not to be in the map
+template <typename K, typename V, typename H>
+V& FlatMap<K,V,H>::insert_unique(std::size_t hash, const K& key, const V& value) {
+    std::size_t index = cap ? find_insert_slot(hash) : npos;
+
+    // Reusing a deleted slot does not consume growth, so we only rehash when we would fill an empty one.
+    // If tombstones take up most of the table a same-sized rehash is enough to clean them up.
+    if (index == npos || (growth_left == 0 && ctrl[index] == ctrl_empty)) {
+        rehash(!cap ? min_cap : sz * 2 < max_load(cap) ? cap : cap * 2);
+        index = find_insert_slot(hash);
+    }
+
+    new (&slots[index]) std::pair<K,V>(key, value);
+    if (ctrl[index] == ctrl_empty)
+        --growth_left;
+    ctrl[index] = static_cast<ctrl_t>(hash & 0x7F);
+    ++sz;
+    return slots[index].second;
+}
+
+
+template <typename K, typename V, typename H>
+void FlatMap<K,V,H>::insert(const K& key, const V& value) {
+    std::size_t index = find_index(key);
+    if (index != npos)
+        slots[index].second = value;
+    else
+        insert_unique(hash_of(key), key, value);
+}
+
+
+// A slot can go back to empty only if its group already has an empty slot,
+// because then no probe sequence ever went past this group.
+template <typename K, typename V, typename H>
+void FlatMap<K,V,H>::remove(const K& key) {
+    std::size_t index = find_index(key);
+    if (index == npos)
+        throw std::runtime_error("no such key in the map");
+
+    slots[index].~pair();
+    --sz;
+
+    const ctrl_t* group = ctrl + index / group_width * group_width;
+    if (match_empty(group)) {
+        ctrl[index] = ctrl_empty;
+        ++growth_left;
+    }
+    else
+        ctrl[index] = ctrl_deleted;
+}
+
+
+template <typename K, typename V, typename H>
+void FlatMap<K,V,H>::clear() {
+    for (std::size_t i = 0; i < cap; ++i) {
+        if (ctrl[i] >= 0)
+            slots[i].~pair();
+        ctrl[i] = ctrl_empty;
+    }
+    sz = 0;
+    growth_left = max_load(cap);
+}
+
+
+template <typename K, typename V, typename H>
+void FlatMap<K,V,H>::swap(FlatMap& rhs) noexcept {
+    std::swap(sz, rhs.sz);
+    std::swap(cap, rhs.cap);
+    std::swap(growth_left, rhs.growth_left);
+    std::swap(hash_function, rhs.hash_function);
+    std::swap(ctrl, rhs.ctrl);
+    std::swap(slots, rhs.slots);
+    std::swap(rehashes, rhs.rehashes);
+    std::swap(rehash_time, rhs.rehash_time);
+    counters.swap(rhs.counters);
+}
+
+
+// If the key exists in the map we return the value it maps to, otherwise
+// we insert the key with a default value V.
+template <typename K, typename V, typename H>
+V& FlatMap<K,V,H>::operator[](const K& key) {
+    std::size_t index = counted_find_index(key);
+    if (index != npos)
+        return slots[index].second;
+    return insert_unique(hash_of(key), key, V{});
+}
+
+
+template <typename K, typename V, typename H>
+const V& FlatMap<K,V,H>::operator[](const K& key) const {
+    std::size_t index = counted_find_index(key);
+    if (index == npos)
+        throw std::runtime_error("no such key in the map");
+    return slots[index].second;
+}
+
+
+// Because self assignment happens so rarely we don't check that this != &rhs
+template <typename K, typename V, typename H>
+FlatMap<K,V,H>& FlatMap<K,V,H>::operator=(const FlatMap& rhs) {
+    FlatMap temp{rhs};
+    temp.swap(*this);
+    return *this;
+}
+
+
+template <typename K, typename V, typename H>
+FlatMap<K,V,H>& FlatMap<K,V,H>::operator=(FlatMap&& rhs) noexcept {
+    rhs.swap(*this);
+    return *this;
+}
+
+
+template <typename K, typename V, typename H>
+typename FlatMap<K,V,H>::iterator FlatMap<K,V,H>::find(const K& key) {
+    std::size_t index = counted_find_index(key);
+    return index == npos ? end() : iterator{this, index};
+}
+
+
+template <typename K, typename V, typename H>
+typename FlatMap<K,V,H>::const_iterator FlatMap<K,V,H>::find(const K& key) const {
+    std::size_t index = counted_find_index(key);
+    return index == npos ? cend() : const_iterator{this, index};
+}
+
+
+// The slot order depends on the capacity, so we compare by lookup instead of walking both maps
+template <typename K, typename V, typename H>
+bool operator==(const FlatMap<K,V,H>& lhs, const FlatMap<K,V,H>& rhs) {
+    if (lhs.size() != rhs.size())
+        return false;
+
+    for (auto iter = lhs.cbegin(); iter != lhs.cend(); ++iter) {
+        auto found = rhs.find(iter->first);
+        if (found == rhs.cend() || found->second != iter->second)
+            return false;
+    }
+    return true;
+}
+
+
+template <typename K, typename V, typename H>
+bool operator!=(const FlatMap<K,V,H>& lhs, const FlatMap<K,V,H>& rhs) {
+    return !(lhs == rhs);
+}
+
+
+template <typename K, typename V, typename H>
+class Flat_Map_Iterator {
+private:
+    FlatMap<K,V,H>* map;
+    std::size_t pos;
+
+public:
+    using iterator_category = std::forward_iterator_tag;
+    using difference_type = std::ptrdiff_t;
+    using value_type = std::pair<K, V>;
+    using pointer = value_type*;
+    using reference = value_type&;
+
+    Flat_Map_Iterator() : map{}, pos{} {}
+
+    Flat_Map_Iterator(FlatMap<K,V,H>* in_map, std::size_t in_pos)
+        : map{in_map}, pos{in_pos} {}
+
+    reference operator*() const { return map->slots[pos];  }
+
+    pointer operator->()  const { return &map->slots[pos]; }
+
+    Flat_Map_Iterator& operator++() {
+        pos = map->next_full(pos + 1);
+        return *this;
+    }
+
+    Flat_Map_Iterator operator++(int) {
+        Flat_Map_Iterator temp = *this;
+        operator++();
+        return temp;
+    }
+
+    bool operator==(const Flat_Map_Iterator& rhs) const {
+        return map == rhs.map && pos == rhs.pos;
+    }
+
+    bool operator!=(const Flat_Map_Iterator& rhs) const {
+        return !operator==(rhs);
+    }
+};
+
+
+template <typename K, typename V, typename H>
+class Const_Flat_Map_Iterator {
+private:
+    const FlatMap<K,V,H>* map;
+    std::size_t pos;
+
+public:
+    using iterator_category = std::forward_iterator_tag;
+    using difference_type = std::ptrdiff_t;
+    using value_type = const std::pair<K, V>;
+    using pointer = value_type*;
+    using reference = value_type&;
+
+    Const_Flat_Map_Iterator() : map{}, pos{} {}
+
+    Const_Flat_Map_Iterator(const FlatMap<K,V,H>* in_map, std::size_t in_pos)
+        : map{in_map}, pos{in_pos} {}
+
+    reference operator*() const { return map->slots[pos];  }
+
+    pointer operator->()  const { return &map->slots[pos]; }
+
+    Const_Flat_Map_Iterator& operator++() {
+        pos = map->next_full(pos + 1);
+        return *this;
+    }
+
+    Const_Flat_Map_Iterator operator++(int) {
+        Const_Flat_Map_Iterator temp = *this;
+        operator++();
+        return temp;
+    }
+
+    bool operator==(const Const_Flat_Map_Iterator& rhs) const {
+        return map == rhs.map && pos == rhs.pos;
+    }
+
+    bool operator!=(const Const_Flat_Map_Iterator& rhs) const {
+        return !operator==(rhs);
+    }
+};
+
+}
@@ -1,14 +1,25 @@
 #pragma once
 
-#include "Map.hpp"
+#include <functional>
+#include <memory>
+#include "Allocator.hpp"
+#include "HashPolicy.hpp"
+#include "SmallVector.hpp"
+#include "StableMap.hpp"
 
 namespace data_structures {
 
-template <typename T>
+// The vertices and their edge lists take their memory from A (see Allocator.hpp)
+template <typename T, typename A = std::allocator<T>>
 class Graph {
 public:
+    using allocator_type = A;
+
     Graph() = default;
-    Graph(const std::initializer_list<T>& list);
+    explicit Graph(const A& alloc);
+    Graph(const std::initializer_list<T>& list, const A& alloc = A());
+
+    A get_allocator() const { return A(vertices.get_allocator()); }
 
     void add_vertex(const T& value);
     void remove_vertex(const T& value);
@@ -29,42 +40,59 @@ private:
     class Vertex;
     class Edge;
 
-    Map<T, Vertex> vertices;
+    using edge_allocator = rebind_alloc_t<A, Edge>;
+
+    // Edges point at their destination vertex, so vertices must not move when others are added
+    StableMap<T, Vertex, std::hash<T>, PrimeSizePolicy, rebind_alloc_t<A, std::pair<T, Vertex>>> vertices;
     std::size_t no_vertices {};
     std::size_t no_edges    {};
 
     bool validate(const T& v1, const T& v2);
+    Vertex& vertex_of(const T& value) { return vertices.find(value)->second; }  // value must be a vertex
 };
 
 
-template<typename T>
-Graph<T>::Graph(const std::initializer_list<T>& list) {
+template <typename T, typename A>
+Graph<T,A>::Graph(const A& alloc)
+    : vertices(alloc) {}
+
+
+template <typename T, typename A>
+Graph<T,A>::Graph(const std::initializer_list<T>& list, const A& alloc)
+    : vertices(alloc)
+{
     for (auto& val : list)
         add_vertex(val);
 }
 
 
-template <typename T>
-bool Graph<T>::validate(const T& v1, const T& v2) {
+template <typename T, typename A>
+bool Graph<T,A>::validate(const T& v1, const T& v2) {
     return ( vertices.find(v1) == vertices.end() || vertices.find(v2) == vertices.end() ) ? false : true;
 }
 
 
-template <typename T>
-void Graph<T>::add_vertex(const T& value) {
-    vertices[value] = Vertex{value};
+// The edge list of the vertex gets the allocator of the graph. Adding an existing vertex clears its edges.
+template <typename T, typename A>
+void Graph<T,A>::add_vertex(const T& value) {
+    edge_allocator alloc(get_allocator());
+    auto iter = vertices.find(value);
+    if (iter != vertices.end())
+        iter->second = Vertex{value, alloc};
+    else
+        vertices.try_emplace(value, value, alloc);
     ++no_vertices;
 }
 
 
-template <typename T>
-void Graph<T>::remove_vertex(const T& value) {
+template <typename T, typename A>
+void Graph<T,A>::remove_vertex(const T& value) {
     auto iter = vertices.find(value);
     if (iter == vertices.end())
         throw std::invalid_argument("no such vertex in the graph");
 
     for (auto& neighboor : iter->second.get_neighboors()) {
-        vertices[neighboor.get_dest().get_data()].remove_edge(iter->second);
+        vertex_of(neighboor.get_dest().get_data()).remove_edge(iter->second);
         no_edges -= 2;
     }
 
@@ -78,58 +106,58 @@ void Graph<T>::remove_vertex(const T& value) {
 
 
 // If an edge between these vertices already exists, its weight gets updated to the argument's new weight
-template <typename T>
-void Graph<T>::add_edge(const T& v1, const T& v2, unsigned weight) {   
+template <typename T, typename A>
+void Graph<T,A>::add_edge(const T& v1, const T& v2, unsigned weight) {   
     if (!validate(v1, v2))
         throw std::invalid_argument("no such vertex/vertices in the graph");
 
-    vertices[v1].add_edge(vertices[v2], weight);
-    if (vertices[v2].add_edge(vertices[v1], weight))    // if the edge did not already exist
+    vertex_of(v1).add_edge(vertex_of(v2), weight);
+    if (vertex_of(v2).add_edge(vertex_of(v1), weight))    // if the edge did not already exist
         no_edges += 2;
 }
 
 
-template <typename T>
-void Graph<T>::remove_edge(const T& v1, const T& v2) {
+template <typename T, typename A>
+void Graph<T,A>::remove_edge(const T& v1, const T& v2) {
     if (!validate(v1, v2))
         throw std::invalid_argument("no such vertex/vertices in the graph");
 
-    if (!vertices[v1].is_neighboor(vertices[v2]))
+    if (!vertex_of(v1).is_neighboor(vertex_of(v2)))
         throw std::runtime_error("vertices are not connected");
 
-    vertices[v1].remove_edge(vertices[v2]);
-    vertices[v2].remove_edge(vertices[v1]);
+    vertex_of(v1).remove_edge(vertex_of(v2));
+    vertex_of(v2).remove_edge(vertex_of(v1));
     no_edges -= 2;
 }
 
 
-template <typename T>
-void Graph<T>::change_weight(const T& v1, const T& v2, unsigned new_weight) {
+template <typename T, typename A>
+void Graph<T,A>::change_weight(const T& v1, const T& v2, unsigned new_weight) {
     if (!validate(v1, v2))
         throw std::invalid_argument("no such vertex/vertices in the graph");
 
-    if (!vertices[v1].is_neighboor(vertices[v2]))
+    if (!vertex_of(v1).is_neighboor(vertex_of(v2)))
         throw std::runtime_error("vertices are not connected");
 
-    vertices[v1].change_weight(v2, new_weight);
-    vertices[v2].change_weight(v1, new_weight);
+    vertex_of(v1).change_weight(v2, new_weight);
+    vertex_of(v2).change_weight(v1, new_weight);
 }
 
 
-template <typename T>
-unsigned Graph<T>::get_weight(const T& v1, const T& v2) {    
+template <typename T, typename A>
+unsigned Graph<T,A>::get_weight(const T& v1, const T& v2) {    
     if (!validate(v1, v2))
         throw std::invalid_argument("no such vertex/vertices in the graph");
 
-    if (!vertices[v2].is_neighboor(vertices[v1]))
+    if (!vertex_of(v2).is_neighboor(vertex_of(v1)))
         throw std::runtime_error("vertices are not connected");
 
-    return vertices[v1].get_weight(vertices[v2]);
+    return vertex_of(v1).get_weight(vertex_of(v2));
 }
 
 
-template <typename T>
-Vector<T> Graph<T>::get_vertices() {
+template <typename T, typename A>
+Vector<T> Graph<T,A>::get_vertices() {
     Vector<T> to_return;
     for (auto& v : vertices)
         to_return.push_back(v.first);        
@@ -137,29 +165,54 @@ Vector<T> Graph<T>::get_vertices() {
 }
 
 
-template <typename T>
-Vector<T> Graph<T>::get_neighboors(const T& vertex) {
+template <typename T, typename A>
+Vector<T> Graph<T,A>::get_neighboors(const T& vertex) {
     if (vertices.find(vertex) == vertices.end())
         throw std::invalid_argument("no such vertex in the graph");
 
     Vector<T> neighboors;
-    for (auto& v : vertices[vertex].get_neighboors())
+    for (auto& v : vertex_of(vertex).get_neighboors())
         neighboors.push_back((v.get_dest()).get_data());
 
     return neighboors;  // return a copy of the neighboors, the user is only allowed to modify the graph through its methodata_structures
 }
 
 
-template <typename T>
-class Graph<T>::Vertex {
+template <typename T, typename A>
+class Graph<T,A>::Edge {
+private:
+    Vertex* dest;
+    unsigned weight;
+public:
+    Edge() : dest{}, weight{} {}
+
+    Edge(Vertex& in_dest, unsigned in_weight = 0)
+        : dest{&in_dest}, weight{in_weight} {}
+
+    bool operator==(const Edge& rhs) const {
+        return *dest == *rhs.dest;  // no duplicate vertices
+    }
+    
+    Vertex& get_dest() { return *dest;  }
+
+    unsigned get_weight() const { return weight; }
+
+    void set_weight(unsigned new_weight) { weight = new_weight; }
+};
+
+
+template <typename T, typename A>
+class Graph<T,A>::Vertex {
 private:
     T data;
-    Vector<Edge> neighboors;
+    SmallVector<Edge, 4, edge_allocator> neighboors;  // most vertices have few edges, so they are kept inline
 public:
     Vertex() = default;
 
     explicit Vertex(const T& in_data) : data{in_data} {}         
 
+    Vertex(const T& in_data, const edge_allocator& alloc) : data{in_data}, neighboors(alloc) {}
+
     // Returns true if a new edge was inserted, otherwise it updates its weight and returns false
     bool add_edge(Vertex& dest, unsigned weight) { 
         Edge temp{dest};
@@ -193,7 +246,7 @@ public:
 
     T& get_data() { return data; }
 
-    Vector<Edge>& get_neighboors() { return neighboors; }
+    SmallVector<Edge, 4, edge_allocator>& get_neighboors() { return neighboors; }
 
     void change_weight(const T& data, unsigned new_weight) {
         for (auto& e : neighboors)
@@ -218,27 +271,4 @@ public:
     }
 };
 
-
-template <typename T>
-class Graph<T>::Edge {
-private:
-    Vertex* dest;
-    unsigned weight;
-public:
-    Edge() : dest{}, weight{} {}
-
-    Edge(Vertex& in_dest, unsigned in_weight = 0)
-        : dest{&in_dest}, weight{in_weight} {}
-
-    bool operator==(const Edge& rhs) const {
-        return *dest == *rhs.dest;  // no duplicate vertices
-    }
-    
-    Vertex& get_dest() { return *dest;  }
-
-    unsigned get_weight() const { return weight; }
-
-    void set_weight(unsigned new_weight) { weight = new_weight; }
-};
-
 }
\ No newline at end of file
@@ -0,0 +1,24 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace data_structures {
+
+namespace detail {
+
+// The finalizer of MurmurHash3: every bit of the input affects every bit of the output.
+// Tables that take the bucket from a few bits of the hash run it through this first.
+inline std::size_t mix_hash(std::size_t h) {
+    std::uint64_t x = static_cast<std::uint64_t>(h);
+    x ^= x >> 33;
+    x *= 0xff51afd7ed558ccdULL;
+    x ^= x >> 33;
+    x *= 0xc4ceb9fe1a85ec53ULL;
+    x ^= x >> 33;
+    return static_cast<std::size_t>(x);
+}
+
+}
+
+}
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include "HashMix.hpp"
+
+namespace data_structures {
+
+// A size policy decides how many buckets a hash table has and which of them a hash goes into.
+// It provides min_size(), next_size(buckets), which returns the smallest size the policy allows
+// that has at least the given number of buckets, index(hash, cap) and an id that map snapshots
+// record, since a table laid out by one policy cannot be searched with another.
+
+
+// Prime sizes: the hash is reduced with a division, which spreads even poor hashes
+// (e.g. the identity std::hash of integers) over all buckets.
+struct PrimeSizePolicy {
+    static constexpr std::size_t sizes[] = {
+        53, 97, 193, 389, 769, 1543, 3079, 6151, 12289,
+        24593, 49157, 98317, 196613, 393241,
+        786433, 1572869, 3145739, 6291469, 12582917,
+        25165843, 50331653, 100663319, 201326611,
+        402653189, 805306457, 1610612741
+    };
+
+    static constexpr std::uint64_t id {1};
+
+    static constexpr std::size_t min_size() { return sizes[0]; }
+
+    // Past the end of the table the size keeps doubling
+    static std::size_t next_size(std::size_t buckets) {
+        std::size_t new_cap {};
+        for (std::size_t s : sizes) {
+            new_cap = s;
+            if (new_cap >= buckets)
+                return new_cap;
+        }
+        while (new_cap < buckets)
+            new_cap *= 2;
+        return new_cap;
+    }
+
+    static std::size_t index(std::size_t hash, std::size_t cap) { return hash % cap; }
+};
+
+
+// Power of two sizes: the bucket is taken from the low bits of the hash with a mask instead of
+// a division. Since that ignores the high bits, the hash is first run through a mixer.
+struct PowerOfTwoPolicy {
+    static constexpr std::uint64_t id {2};
+
+    static constexpr std::size_t min_size() { return 64; }
+
+    static std::size_t next_size(std::size_t buckets) {
+        std::size_t new_cap {min_size()};
+        while (new_cap < buckets)
+            new_cap *= 2;
+        return new_cap;
+    }
+
+    static std::size_t index(std::size_t hash, std::size_t cap) { return detail::mix_hash(hash) & (cap - 1); }
+};
+
+}
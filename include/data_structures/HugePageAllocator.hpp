@@ -0,0 +1,171 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+namespace data_structures {
+
+// Where the pages of a mapped buffer are placed: wherever the kernel likes (the node of the
+// thread that first touches them, by default), on the given nodes only, or spread round robin
+// over the given nodes.
+enum class NumaPolicy { none, bind, interleave };
+
+namespace huge_pages {
+
+// Size of a transparent huge page on x86-64 and on most aarch64 kernels
+constexpr std::size_t page_size {std::size_t{2} << 20};
+
+inline std::size_t round_up(std::size_t bytes) {
+    return (bytes + page_size - 1) / page_size * page_size;
+}
+
+// Applies policy to [p, p + length). Advice and placement are only hints: a kernel without
+// transparent huge pages or NUMA support leaves the buffer with ordinary pages, wherever
+// it would have put them anyway.
+inline void advise(void* p, std::size_t length, NumaPolicy policy, unsigned long nodes) {
+#ifdef MADV_HUGEPAGE
+    ::madvise(p, length, MADV_HUGEPAGE);
+#endif
+#ifdef SYS_mbind
+    if (policy != NumaPolicy::none && nodes) {
+        constexpr int mpol_bind {2};        // MPOL_BIND and MPOL_INTERLEAVE of <linux/mempolicy.h>,
+        constexpr int mpol_interleave {3};  // so that libnuma is not needed
+        int mode = policy == NumaPolicy::bind ? mpol_bind : mpol_interleave;
+        ::syscall(SYS_mbind, p, length, mode, &nodes, sizeof(nodes) * 8 + 1, 0);
+    }
+#else
+    (void)policy;
+    (void)nodes;
+#endif
+}
+
+// Maps length bytes (a multiple of page_size) at an address aligned to page_size,
+// so that the kernel can back all of it with huge pages
+inline void* map(std::size_t length, NumaPolicy policy, unsigned long nodes) {
+    std::size_t padded = length + page_size;
+    void* p = ::mmap(nullptr, padded, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (p == MAP_FAILED)
+        throw std::bad_alloc();
+
+    char* start = static_cast<char*>(p);
+    char* aligned = reinterpret_cast<char*>((reinterpret_cast<std::uintptr_t>(start) + page_size - 1) / page_size * page_size);
+    if (aligned != start)
+        ::munmap(start, static_cast<std::size_t>(aligned - start));
+    if (char* end = start + padded; aligned + length != end)
+        ::munmap(aligned + length, static_cast<std::size_t>(end - aligned - length));
+
+    advise(aligned, length, policy, nodes);
+    return aligned;
+}
+
+inline void unmap(void* p, std::size_t length) noexcept {
+    ::munmap(p, length);
+}
+
+}
+
+
+// Allocator for large buffers, such as those of a Vector with many millions of elements.
+// Requests of at least threshold bytes get their own anonymous mapping, rounded up to whole
+// huge pages and advised to be backed by them (madvise(MADV_HUGEPAGE)), which cuts the TLB
+// misses of scans over the buffer; the mapping can also be bound or interleaved across NUMA
+// nodes (nodes is a bitmask of node numbers). Smaller requests come from std::allocator.
+// Mapped buffers grow with mremap(), which moves their pages instead of copying them:
+// Vector uses reallocate() for that when its elements are trivially copyable.
+template <typename T>
+class HugePageAllocator {
+public:
+    using value_type = T;
+    using propagate_on_container_move_assignment = std::true_type;
+    using propagate_on_container_swap = std::true_type;
+    using is_always_equal = std::false_type;
+
+    explicit HugePageAllocator(std::size_t in_threshold = huge_pages::page_size,
+                               NumaPolicy in_policy = NumaPolicy::none, unsigned long in_nodes = 0) noexcept
+        : threshold{in_threshold}, policy{in_policy}, nodes{in_nodes} {}
+
+    template <typename U>
+    HugePageAllocator(const HugePageAllocator<U>& rhs) noexcept
+        : threshold{rhs.get_threshold()}, policy{rhs.get_policy()}, nodes{rhs.get_nodes()} {}
+
+    T* allocate(std::size_t n);
+    void deallocate(T* p, std::size_t n) noexcept;
+
+    // Resizes a buffer of old_n elements that came from this allocator to new_n elements,
+    // keeping the bytes of the first min(old_n, new_n) ones like realloc() does
+    T* reallocate(T* p, std::size_t old_n, std::size_t new_n);
+
+    std::size_t get_threshold() const { return threshold; }
+    NumaPolicy get_policy() const { return policy; }
+    unsigned long get_nodes() const { return nodes; }
+
+    // Whether a buffer of n elements is mapped; the placement policy does not matter to deallocate()
+    bool mapped(std::size_t n) const { return n * sizeof(T) >= threshold; }
+
+    template <typename U>
+    bool operator==(const HugePageAllocator<U>& rhs) const { return threshold == rhs.get_threshold(); }
+
+    template <typename U>
+    bool operator!=(const HugePageAllocator<U>& rhs) const { return !(*this == rhs); }
+
+private:
+    std::size_t threshold;
+    NumaPolicy policy;
+    unsigned long nodes;
+};
+
+
+template <typename T>
+T* HugePageAllocator<T>::allocate(std::size_t n) {
+    if (n > (static_cast<std::size_t>(-1) - 2 * huge_pages::page_size) / sizeof(T))  // room to round up and align
+        throw std::bad_alloc();
+    if (!mapped(n))
+        return std::allocator<T>{}.allocate(n);
+    return static_cast<T*>(huge_pages::map(huge_pages::round_up(n * sizeof(T)), policy, nodes));
+}
+
+
+template <typename T>
+void HugePageAllocator<T>::deallocate(T* p, std::size_t n) noexcept {
+    if (!mapped(n))
+        std::allocator<T>{}.deallocate(p, n);
+    else
+        huge_pages::unmap(p, huge_pages::round_up(n * sizeof(T)));
+}
+
+
+// Between two mapped sizes the pages are remapped; the kernel extends the mapping in place if
+// the addresses after it are free and otherwise moves it, without copying. The grown part gets
+// the same advice and placement as a new buffer would.
+template <typename T>
+T* HugePageAllocator<T>::reallocate(T* p, std::size_t old_n, std::size_t new_n) {
+#ifdef MREMAP_MAYMOVE
+    if (mapped(old_n) && mapped(new_n)) {
+        std::size_t old_length = huge_pages::round_up(old_n * sizeof(T));
+        std::size_t new_length = huge_pages::round_up(new_n * sizeof(T));
+        if (old_length == new_length)
+            return p;
+
+        void* q = ::mremap(p, old_length, new_length, MREMAP_MAYMOVE);
+        if (q == MAP_FAILED)
+            throw std::bad_alloc();
+        if (new_length > old_length)
+            huge_pages::advise(static_cast<char*>(q) + old_length, new_length - old_length, policy, nodes);
+        return static_cast<T*>(q);
+    }
+#endif
+
+    T* q = allocate(new_n);
+    std::memcpy(static_cast<void*>(q), static_cast<const void*>(p), (old_n < new_n ? old_n : new_n) * sizeof(T));
+    deallocate(p, old_n);
+    return q;
+}
+
+}
@@ -0,0 +1,577 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <initializer_list>
+#include <iterator>
+#include <limits>
+#include <new>
+#include <optional>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+#include "HashPolicy.hpp"
+#include "Map.hpp"
+#include "Simd.hpp"
+
+namespace data_structures {
+
+template <typename K, typename V, typename H> class Int_Map_Iterator;
+template <typename K, typename V, typename H> class Const_Int_Map_Iterator;
+
+// Open addressing hash map for integer keys and trivially copyable values.
+// Keys and values are kept in two separate arrays, so probing only touches the key array,
+// where a cache line holds 16 four byte or 8 eight byte keys. An empty slot holds the sentinel
+// key std::numeric_limits<K>::max(); that key itself is stored outside the table.
+// Collisions are resolved by linear probing, which compares a whole 32 byte block of keys at
+// once with SIMD. Removal shifts the following keys back instead of leaving tombstones.
+// Iterators yield std::pair<const K&, V&> proxies, since keys and values are not stored as pairs.
+template <typename K, typename V, typename H = std::hash<K>>
+class IntMap {
+    static_assert(std::is_integral_v<K> && !std::is_same_v<K, bool>, "IntMap keys must be integers");
+    static_assert(std::is_trivially_copyable_v<V>, "IntMap values must be trivially copyable");
+
+public:
+    using iterator = Int_Map_Iterator<K,V,H>;
+    using const_iterator = Const_Int_Map_Iterator<K,V,H>;
+
+    static constexpr K empty_key = std::numeric_limits<K>::max();
+
+    IntMap();
+    explicit IntMap(H in_hash);
+    explicit IntMap(const std::initializer_list<std::pair<K,V>>& list);
+    IntMap(const IntMap& map);
+    IntMap(IntMap&& map) noexcept;
+    ~IntMap();
+
+    void insert(const K& key, const V& value);
+    void remove(const K& key);
+
+    std::size_t size()     const { return used + (sentinel_value ? 1 : 0); }
+    std::size_t capacity() const { return cap;         }
+    bool empty()           const { return size() == 0; }
+
+    void clear();
+    void swap(IntMap& rhs) noexcept;
+
+    V& operator[](const K& key);
+    const V& operator[](const K& key) const;
+    IntMap& operator=(const IntMap& rhs);
+    IntMap& operator=(IntMap&& rhs) noexcept;
+
+    iterator find(const K& key);
+    const_iterator find(const K& key) const;
+    bool contains(const K& key) const { return find_index(key) != npos; }
+    std::size_t count(const K& key) const { return contains(key) ? 1 : 0; }
+
+    // Calls fn(key, value) for every element. Faster than the iterators, since whole
+    // blocks of the key array are checked for occupied slots at once.
+    template <typename F>
+    void for_each(F fn);
+
+    iterator begin() { return iterator{this, next_full(0)}; }
+    iterator end()   { return iterator{this, cap + 1};      }
+
+    const_iterator cbegin() const { return const_iterator{this, next_full(0)}; }
+    const_iterator cend()   const { return const_iterator{this, cap + 1};      }
+
+private:
+    friend class Int_Map_Iterator<K,V,H>;
+    friend class Const_Int_Map_Iterator<K,V,H>;
+
+    // Keys per SIMD block. Only 4 and 8 byte keys are matched with SIMD, smaller ones one by one.
+    static constexpr bool simd_keys = sizeof(K) == 4 || sizeof(K) == 8;
+    static constexpr std::size_t block = 32 / sizeof(K);
+    static constexpr std::uint32_t block_mask = (std::uint64_t{1} << block) - 1;
+
+    static constexpr std::size_t min_cap {32};
+    static constexpr std::size_t npos = static_cast<std::size_t>(-1);
+
+    // Positions 0 .. cap-1 are slots of the table, position cap stands for the sentinel key
+    std::size_t used {};
+    std::size_t cap {};
+
+    H hash_function;
+    K* keys {};
+    V* values {};
+    std::optional<V> sentinel_value;  // the value of empty_key, if it is in the map
+
+    static std::uint32_t match(const K* block_keys, K key);
+
+    std::size_t home(K key) const { return PowerOfTwoPolicy::index(hash_function(key), cap); }
+    std::size_t find_index(const K& key) const;
+    std::size_t find_empty(K key) const;
+    std::size_t claim(const K& key);
+    std::size_t next_full(std::size_t pos) const;
+
+    const K& key_at(std::size_t pos)         const { return pos < cap ? keys[pos] : empty_key;          }
+    V& value_at(std::size_t pos)                   { return pos < cap ? values[pos] : *sentinel_value; }
+    const V& value_at(std::size_t pos)       const { return pos < cap ? values[pos] : *sentinel_value; }
+
+    void allocate(std::size_t n);
+    void deallocate();
+    void rehash(std::size_t new_cap);
+};
+
+
+// Selects IntMap when it can hold K and V, Map otherwise
+template <typename K, typename V>
+inline constexpr bool is_compact_map_v = std::is_integral_v<K> && !std::is_same_v<K, bool> && std::is_trivially_copyable_v<V>;
+
+template <bool compact, typename K, typename V, typename H>
+struct select_map { using type = Map<K,V,H>; };
+
+template <typename K, typename V, typename H>
+struct select_map<true, K, V, H> { using type = IntMap<K,V,H>; };
+
+template <typename K, typename V, typename H = std::hash<K>>
+using CompactMap = typename select_map<is_compact_map_v<K,V>, K, V, H>::type;
+
+
+template <typename K, typename V, typename H>
+IntMap<K,V,H>::IntMap()
+    : hash_function{H()} {}
+
+
+template <typename K, typename V, typename H>
+IntMap<K,V,H>::IntMap(H in_hash)
+    : hash_function{in_hash} {}
+
+
+template <typename K, typename V, typename H>
+IntMap<K,V,H>::IntMap(const std::initializer_list<std::pair<K,V>>& list)
+    : hash_function{H()}
+{
+    for (auto& e : list)
+        insert(e.first, e.second);
+}
+
+
+template <typename K, typename V, typename H>
+IntMap<K,V,H>::IntMap(const IntMap& map)
+    : hash_function{map.hash_function}, sentinel_value{map.sentinel_value}
+{
+    if (!map.cap)
+        return;
+
+    allocate(map.cap);
+    for (std::size_t i = 0; i < cap; ++i) {
+        if (map.keys[i] != empty_key) {
+            keys[i] = map.keys[i];
+            new (&values[i]) V(map.values[i]);
+        }
+    }
+    used = map.used;
+}
+
+
+template <typename K, typename V, typename H>
+IntMap<K,V,H>::IntMap(IntMap&& map) noexcept
+    : hash_function{H()}
+{
+    map.swap(*this);
+}
+
+
+template <typename K, typename V, typename H>
+IntMap<K,V,H>::~IntMap() {
+    deallocate();
+}
+
+
+// Values are trivially copyable, so they need no destructor calls and slots can be reused freely
+template <typename K, typename V, typename H>
+void IntMap<K,V,H>::allocate(std::size_t n) {
+    keys = (K*)::operator new(n * sizeof(K));
+    values = (V*)::operator new(n * sizeof(V));
+    for (std::size_t i = 0; i < n; ++i)
+        keys[i] = empty_key;
+    cap = n;
+    used = 0;
+}
+
+
+template <typename K, typename V, typename H>
+void IntMap<K,V,H>::deallocate() {
+    if (!keys)
+        return;
+    ::operator delete(keys, cap * sizeof(K));
+    ::operator delete(values, cap * sizeof(V));
+    keys = nullptr;
+    values = nullptr;
+    cap = used = 0;
+}
+
+
+template <typename K, typename V, typename H>
+inline std::uint32_t IntMap<K,V,H>::match(const K* block_keys, K key) {
+    if constexpr (sizeof(K) == 4)
+        return simd::match_key32(block_keys, static_cast<std::uint32_t>(key));
+    else
+        return simd::match_key64(block_keys, static_cast<std::uint64_t>(key));
+}
+
+
+// Linear probing from the home slot of key. A whole block is checked at a time as long as
+// it does not run past the end of the table; only the key matches in front of the first
+// empty slot of the block count, since the probe sequence of key ends there.
+template <typename K, typename V, typename H>
+std::size_t IntMap<K,V,H>::find_index(const K& key) const {
+    if (key == empty_key)
+        return sentinel_value ? cap : npos;
+    if (!cap)
+        return npos;
+
+    std::size_t pos = home(key);
+    while (true) {
+        if constexpr (simd_keys) {
+            if (pos + block <= cap) {
+                std::uint32_t found = match(keys + pos, key);
+                std::uint32_t empty = match(keys + pos, empty_key);
+                std::uint32_t before_empty = empty ? (empty & (0u - empty)) - 1 : block_mask;
+                if (found & before_empty)
+                    return pos + simd::first_bit(found & before_empty);
+                if (empty)
+                    return npos;
+                pos = (pos + block) & (cap - 1);
+                continue;
+            }
+        }
+        if (keys[pos] == key)
+            return pos;
+        if (keys[pos] == empty_key)
+            return npos;
+        pos = (pos + 1) & (cap - 1);
+    }
+}
+
+
+// Returns the first empty slot on the probe sequence of key
+template <typename K, typename V, typename H>
+std::size_t IntMap<K,V,H>::find_empty(K key) const {
+    std::size_t pos = home(key);
+    while (true) {
+        if constexpr (simd_keys) {
+            if (pos + block <= cap) {
+                std::uint32_t empty = match(keys + pos, empty_key);
+                if (empty)
+                    return pos + simd::first_bit(empty);
+                pos = (pos + block) & (cap - 1);
+                continue;
+            }
+        }
+        if (keys[pos] == empty_key)
+            return pos;
+        pos = (pos + 1) & (cap - 1);
+    }
+}
+
+
+template <typename K, typename V, typename H>
+std::size_t IntMap<K,V,H>::next_full(std::size_t pos) const {
+    if constexpr (simd_keys) {
+        for (; pos + block <= cap; pos += block) {
+            std::uint32_t full = ~match(keys + pos, empty_key) & block_mask;
+            if (full)
+                return pos + simd::first_bit(full);
+        }
+    }
+    for (; pos < cap; ++pos)
+        if (keys[pos] != empty_key)
+            return pos;
+    return pos == cap && sentinel_value ? cap : cap + 1;
+}
+
+
+// Moves every element into a fresh table of new_cap slots
+template <typename K, typename V, typename H>
+void IntMap<K,V,H>::rehash(std::size_t new_cap) {
+    K* old_keys = keys;
+    V* old_values = values;
+    std::size_t old_cap = cap;
+    std::size_t old_used = used;
+
+    allocate(new_cap);
+
+    for (std::size_t i = 0; i < old_cap; ++i) {
+        if (old_keys[i] == empty_key)
+            continue;
+        std::size_t pos = find_empty(old_keys[i]);
+        keys[pos] = old_keys[i];
+        new (&values[pos]) V(old_values[i]);
+    }
+    used = old_used;
+
+    ::operator delete(old_keys, old_cap * sizeof(K));
+    ::operator delete(old_values, old_cap * sizeof(V));
+}
+
+
+// Returns the slot that holds key, taking an empty one if key is missing.
+// The value of a new slot is left unconstructed. Keeps the load factor under 3/4.
+template <typename K, typename V, typename H>
+std::size_t IntMap<K,V,H>::claim(const K& key) {
+    std::size_t pos = find_index(key);
+    if (pos != npos)
+        return pos;
+
+    if ((used + 1) * 4 > cap * 3)
+        rehash(cap ? cap * 2 : min_cap);
+    pos = find_empty(key);
+    keys[pos] = key;
+    ++used;
+    return pos;
+}
+
+
+// If the key already exists, its value gets updated
+template <typename K, typename V, typename H>
+void IntMap<K,V,H>::insert(const K& key, const V& value) {
+    if (key == empty_key) {
+        sentinel_value = value;
+        return;
+    }
+    std::size_t pos = claim(key);  // may rehash, so values must be read after it
+    new (&values[pos]) V(value);
+}
+
+
+// Backward shift deletion: every following key of the cluster whose home slot is not between
+// the hole and itself moves into the hole, so no probe sequence gets broken.
+template <typename K, typename V, typename H>
+void IntMap<K,V,H>::remove(const K& key) {
+    std::size_t hole = find_index(key);
+    if (hole == npos)
+        throw std::runtime_error("no such key in the map");
+
+    if (hole == cap) {
+        sentinel_value.reset();
+        return;
+    }
+
+    std::size_t mask = cap - 1;
+    for (std::size_t pos = (hole + 1) & mask; keys[pos] != empty_key; pos = (pos + 1) & mask) {
+        std::size_t h = home(keys[pos]);
+        if (((pos - h) & mask) >= ((pos - hole) & mask)) {
+            keys[hole] = keys[pos];
+            new (&values[hole]) V(values[pos]);
+            hole = pos;
+        }
+    }
+    keys[hole] = empty_key;
+    --used;
+}
+
+
+template <typename K, typename V, typename H>
+void IntMap<K,V,H>::clear() {
+    for (std::size_t i = 0; i < cap; ++i)
+        keys[i] = empty_key;
+    used = 0;
+    sentinel_value.reset();
+}
+
+
+template <typename K, typename V, typename H>
+void IntMap<K,V,H>::swap(IntMap& rhs) noexcept {
+    std::swap(used, rhs.used);
+    std::swap(cap, rhs.cap);
+    std::swap(hash_function, rhs.hash_function);
+    std::swap(keys, rhs.keys);
+    std::swap(values, rhs.values);
+    sentinel_value.swap(rhs.sentinel_value);
+}
+
+
+// If the key exists in the map we return the value it maps to, otherwise
+// we insert the key with a value-initialized V.
+template <typename K, typename V, typename H>
+V& IntMap<K,V,H>::operator[](const K& key) {
+    if (key == empty_key) {
+        if (!sentinel_value)
+            sentinel_value.emplace();
+        return *sentinel_value;
+    }
+
+    std::size_t old_used = used;
+    std::size_t pos = claim(key);
+    if (used != old_used)
+        new (&values[pos]) V{};
+    return values[pos];
+}
+
+
+template <typename K, typename V, typename H>
+const V& IntMap<K,V,H>::operator[](const K& key) const {
+    std::size_t pos = find_index(key);
+    if (pos == npos)
+        throw std::runtime_error("no such key in the map");
+    return value_at(pos);
+}
+
+
+// Because self assignment happens so rarely we don't check that this != &rhs
+template <typename K, typename V, typename H>
+IntMap<K,V,H>& IntMap<K,V,H>::operator=(const IntMap& rhs) {
+    IntMap temp{rhs};
+    temp.swap(*this);
+    return *this;
+}
+
+
+template <typename K, typename V, typename H>
+IntMap<K,V,H>& IntMap<K,V,H>::operator=(IntMap&& rhs) noexcept {
+    rhs.swap(*this);
+    return *this;
+}
+
+
+template <typename K, typename V, typename H>
+typename IntMap<K,V,H>::iterator IntMap<K,V,H>::find(const K& key) {
+    std::size_t pos = find_index(key);
+    return pos == npos ? end() : iterator{this, pos};
+}
+
+
+template <typename K, typename V, typename H>
+typename IntMap<K,V,H>::const_iterator IntMap<K,V,H>::find(const K& key) const {
+    std::size_t pos = find_index(key);
+    return pos == npos ? cend() : const_iterator{this, pos};
+}
+
+
+template <typename K, typename V, typename H>
+template <typename F>
+void IntMap<K,V,H>::for_each(F fn) {
+    std::size_t pos {};
+    if constexpr (simd_keys) {
+        for (; pos + block <= cap; pos += block)
+            for (std::uint32_t full = ~match(keys + pos, empty_key) & block_mask; full; full &= full - 1) {
+                std::size_t i = pos + simd::first_bit(full);
+                fn(static_cast<const K&>(keys[i]), values[i]);
+            }
+    }
+    for (; pos < cap; ++pos)
+        if (keys[pos] != empty_key)
+            fn(static_cast<const K&>(keys[pos]), values[pos]);
+    if (sentinel_value)
+        fn(empty_key, *sentinel_value);
+}
+
+
+template <typename K, typename V, typename H>
+bool operator==(const IntMap<K,V,H>& lhs, const IntMap<K,V,H>& rhs) {
+    if (lhs.size() != rhs.size())
+        return false;
+
+    for (auto iter = lhs.cbegin(); iter != lhs.cend(); ++iter) {
+        auto found = rhs.find(iter->first);
+        if (found == rhs.cend() || !(found->second == iter->second))
+            return false;
+    }
+    return true;
+}
+
+
+template <typename K, typename V, typename H>
+bool operator!=(const IntMap<K,V,H>& lhs, const IntMap<K,V,H>& rhs) {
+    return !(lhs == rhs);
+}
+
+
+template <typename K, typename V, typename H>
+class Int_Map_Iterator {
+private:
+    IntMap<K,V,H>* map;
+    std::size_t pos;
+
+public:
+    using iterator_category = std::forward_iterator_tag;
+    using difference_type = std::ptrdiff_t;
+    using value_type = std::pair<K, V>;
+    using reference = std::pair<const K&, V&>;
+
+    // operator-> has to return something that outlives the call, so it wraps the proxy pair
+    struct pointer {
+        reference ref;
+        reference* operator->() { return &ref; }
+    };
+
+    Int_Map_Iterator() : map{}, pos{} {}
+
+    Int_Map_Iterator(IntMap<K,V,H>* in_map, std::size_t in_pos)
+        : map{in_map}, pos{in_pos} {}
+
+    reference operator*() const { return reference{map->key_at(pos), map->value_at(pos)}; }
+
+    pointer operator->()  const { return pointer{operator*()}; }
+
+    Int_Map_Iterator& operator++() {
+        pos = map->next_full(pos + 1);
+        return *this;
+    }
+
+    Int_Map_Iterator operator++(int) {
+        Int_Map_Iterator temp = *this;
+        operator++();
+        return temp;
+    }
+
+    bool operator==(const Int_Map_Iterator& rhs) const {
+        return map == rhs.map && pos == rhs.pos;
+    }
+
+    bool operator!=(const Int_Map_Iterator& rhs) const {
+        return !operator==(rhs);
+    }
+};
+
+
+template <typename K, typename V, typename H>
+class Const_Int_Map_Iterator {
+private:
+    const IntMap<K,V,H>* map;
+    std::size_t pos;
+
+public:
+    using iterator_category = std::forward_iterator_tag;
+    using difference_type = std::ptrdiff_t;
+    using value_type = std::pair<K, V>;
+    using reference = std::pair<const K&, const V&>;
+
+    struct pointer {
+        reference ref;
+        const reference* operator->() const { return &ref; }
+    };
+
+    Const_Int_Map_Iterator() : map{}, pos{} {}
+
+    Const_Int_Map_Iterator(const IntMap<K,V,H>* in_map, std::size_t in_pos)
+        : map{in_map}, pos{in_pos} {}
+
+    reference operator*() const { return reference{map->key_at(pos), map->value_at(pos)}; }
+
+    pointer operator->()  const { return pointer{operator*()}; }
+
+    Const_Int_Map_Iterator& operator++() {
+        pos = map->next_full(pos + 1);
+        return *this;
+    }
+
+    Const_Int_Map_Iterator operator++(int) {
+        Const_Int_Map_Iterator temp = *this;
+        operator++();
+        return temp;
+    }
+
+    bool operator==(const Const_Int_Map_Iterator& rhs) const {
+        return map == rhs.map && pos == rhs.pos;
+    }
+
+    bool operator!=(const Const_Int_Map_Iterator& rhs) const {
+        return !operator==(rhs);
+    }
+};
+
+}
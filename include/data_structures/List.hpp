@@ -3,12 +3,14 @@
 #include <cassert>
 #include <cstddef>
 #include <initializer_list>
+#include <memory>
 #include <stdexcept>
 #include <utility>
+#include "Allocator.hpp"
 
 namespace data_structures {
 
-template <typename T> class List;
+template <typename T, typename A> class List;
 template <typename T> class List_Iterator;
 template <typename T> class Const_List_Iterator;
 
@@ -21,18 +23,27 @@ struct ListNode {
         : data{in_data}, next{in_next} {}
 };
 
-template <typename T>
+// The nodes come from A rebound to ListNode<T> (see Allocator.hpp)
+template <typename T, typename A = std::allocator<T>>
 class List {
+    using node_allocator = rebind_alloc_t<A, ListNode<T>>;
+
 public:
     using iterator = List_Iterator<T>;
     using const_iterator = Const_List_Iterator<T>;
+    using allocator_type = A;
 
     List();
-    explicit List(const std::initializer_list<T>& values);
+    explicit List(const A& in_alloc);
+    explicit List(const std::initializer_list<T>& values, const A& in_alloc = A());
     List(const List& list);
+    List(const List& list, const A& in_alloc);
     List(List&& list) noexcept;
+    List(List&& list, const A& in_alloc);
     ~List();
 
+    A get_allocator() const { return A(alloc); }
+
     void push_front(const T& data);
     void push_back(const T& data);
 
@@ -49,10 +60,10 @@ public:
     T& at(std::size_t index);
 
     void clear();
-    void swap(List<T>& rhs) noexcept;
+    void swap(List& rhs) noexcept;
 
     List&  operator=(const List& rhs);
-    List&  operator=(List&& rhs) noexcept;
+    List&  operator=(List&& rhs) noexcept(propagate_on_move_v<node_allocator> || always_equal_v<node_allocator>);
 
     std::size_t size()  const { return sz;      }
     bool        empty() const { return sz == 0; }
@@ -64,31 +75,44 @@ public:
     const_iterator cend()   const { return const_iterator{};            }
 
 private:
+    DATA_STRUCTURES_NO_UNIQUE_ADDRESS node_allocator alloc;
     ListNode<T>* dummy;
     ListNode<T>* last;
     std::size_t sz;
+
+    void p_swap_nodes(List& rhs) noexcept;
 };
 
 
 // Constructor: create a dummy node so that even an empty list has one node.
 // In an empty list last_node == dummy.
-template <typename T>
-List<T>::List() 
-    : dummy{new ListNode<T>}, last{dummy}, sz{} {}
+template <typename T, typename A>
+List<T,A>::List()
+    : List(A()) {}
 
 
-template<typename T>
-List<T>::List(const std::initializer_list<T>& values)
-    : dummy{new ListNode<T>}, last{dummy}, sz{}
+template <typename T, typename A>
+List<T,A>::List(const A& in_alloc)
+    : alloc{in_alloc}, dummy{create_node(alloc)}, last{dummy}, sz{} {}
+
+
+template <typename T, typename A>
+List<T,A>::List(const std::initializer_list<T>& values, const A& in_alloc)
+    : List(in_alloc)
 {
     for (auto p : values)
         push_back(p);
 } 
 
 
-template <typename T>
-List<T>::List(const List<T>& list)
-    : dummy{new ListNode<T>}, last{dummy}, sz{}
+template <typename T, typename A>
+List<T,A>::List(const List& list)
+    : List(list, std::allocator_traits<A>::select_on_container_copy_construction(A(list.alloc))) {}
+
+
+template <typename T, typename A>
+List<T,A>::List(const List& list, const A& in_alloc)
+    : List(in_alloc)
 {
     ListNode<T>* node = list.dummy->next;
     while (node) {
@@ -98,24 +122,40 @@ List<T>::List(const List<T>& list)
 }
 
 
-template <typename T>
-List<T>::List(List<T>&& list) noexcept
-    : dummy{new ListNode<T>}, last{dummy}, sz{}
+// The allocator moves along with the nodes; only the new dummy node is allocated
+template <typename T, typename A>
+List<T,A>::List(List&& list) noexcept
+    : List(A(list.alloc))
 {
-    list.swap(*this);
+    p_swap_nodes(list);
 }
 
 
-template <typename T>
-List<T>::~List() {
+// The nodes of list can only be taken over if in_alloc can free them, otherwise they are copied
+template <typename T, typename A>
+List<T,A>::List(List&& list, const A& in_alloc)
+    : List(in_alloc)
+{
+    if (alloc == list.alloc)
+        p_swap_nodes(list);
+    else {
+        for (ListNode<T>* node = list.dummy->next; node; node = node->next)
+            push_back(node->data);
+        list.clear();
+    }
+}
+
+
+template <typename T, typename A>
+List<T,A>::~List() {
     clear();
-    delete dummy;
+    destroy_node(alloc, dummy);
 }
 
 
-template<typename T>
-void List<T>::push_front(const T& data) {
-    ListNode<T>* new_node = new ListNode<T>{data, dummy->next};
+template <typename T, typename A>
+void List<T,A>::push_front(const T& data) {
+    ListNode<T>* new_node = create_node(alloc, data, dummy->next);
     dummy->next = new_node;
 
     // Update size and last
@@ -125,9 +165,9 @@ void List<T>::push_front(const T& data) {
 }
 
 
-template <typename T>
-void List<T>::push_back(const T& data) {
-    ListNode<T>* new_node = new ListNode<T>{data};
+template <typename T, typename A>
+void List<T,A>::push_back(const T& data) {
+    ListNode<T>* new_node = create_node(alloc, data);
     last->next = new_node;
     last = new_node;
     ++sz;   
@@ -135,8 +175,8 @@ void List<T>::push_back(const T& data) {
 
 
 // Insert an item at a given index. The first argument is the index of the value before which to insert (indexes start at 0)
-template<typename T>
-void List<T>::insert(std::size_t index, const T& data) {
+template <typename T, typename A>
+void List<T,A>::insert(std::size_t index, const T& data) {
     if (index >= sz)
         index = sz;
     
@@ -146,7 +186,7 @@ void List<T>::insert(std::size_t index, const T& data) {
     while (t_index++ != index)
         node = node->next;
     
-    ListNode<T>* new_node = new ListNode<T>(data, node->next);
+    ListNode<T>* new_node = create_node(alloc, data, node->next);
     node->next = new_node;
     
     if (node == last)
@@ -155,8 +195,8 @@ void List<T>::insert(std::size_t index, const T& data) {
 }
 
 
-template<typename T>
-void List<T>::pop_front() {
+template <typename T, typename A>
+void List<T,A>::pop_front() {
     if (!sz)  return;
 
     ListNode<T>* first = dummy->next;
@@ -164,28 +204,28 @@ void List<T>::pop_front() {
     
     if (first == last)
         last = dummy;       
-    delete first;
+    destroy_node(alloc, first);
     --sz;    
 }
 
 
-template<typename T>
-void List<T>::pop_back() {
+template <typename T, typename A>
+void List<T,A>::pop_back() {
     if (!sz)  return;
 
     ListNode<T>* node = dummy;
     while (node->next != last)
         node = node->next;
 
-    delete last;
+    destroy_node(alloc, last);
     last = node;
     node->next = nullptr;
     --sz;    
 }
 
 
-template<typename T>
-void List<T>::remove(std::size_t index) {
+template <typename T, typename A>
+void List<T,A>::remove(std::size_t index) {
     if (index >= sz)
         throw std::invalid_argument("invalid index");       
 
@@ -199,13 +239,13 @@ void List<T>::remove(std::size_t index) {
 
     if (to_remove == last)
         last = node;
-    delete to_remove;
+    destroy_node(alloc, to_remove);
     --sz;    
 }
 
 
-template <typename T>
-typename List<T>::iterator List<T>::find(T key) {
+template <typename T, typename A>
+typename List<T,A>::iterator List<T,A>::find(T key) {
     for (auto iter = begin(); iter != end(); ++iter)
         if (*iter == key)
             return iter;
@@ -213,24 +253,24 @@ typename List<T>::iterator List<T>::find(T key) {
 }
 
 
-template <typename T>
-T& List<T>::front() {
+template <typename T, typename A>
+T& List<T,A>::front() {
     if (!sz)
         throw std::runtime_error("list is empty");
     return dummy->next->data;
 }
 
 
-template <typename T>
-T& List<T>::back() {
+template <typename T, typename A>
+T& List<T,A>::back() {
     if (!sz)
         throw std::runtime_error("list is empty");
     return last->data;
 }
 
 
-template <typename T>
-T& List<T>::at(std::size_t index) {
+template <typename T, typename A>
+T& List<T,A>::at(std::size_t index) {
     if (!sz)
         throw std::runtime_error("list is empty");
     else if (index >= sz)
@@ -244,12 +284,12 @@ T& List<T>::at(std::size_t index) {
 }
 
 
-template <typename T>
-void List<T>::clear() {
+template <typename T, typename A>
+void List<T,A>::clear() {
     ListNode<T>* node = dummy->next;
     while (node) {
         ListNode<T>* next = node->next;
-        delete node;
+        destroy_node(alloc, node);
         node = next;
     }
     dummy->next = nullptr;
@@ -258,38 +298,62 @@ void List<T>::clear() {
 }
 
 
-template <typename T>
-void List<T>::swap(List<T>& rhs) noexcept {
+template <typename T, typename A>
+void List<T,A>::p_swap_nodes(List& rhs) noexcept {
     std::swap(sz,    rhs.sz);
     std::swap(last,  rhs.last);
     std::swap(dummy, rhs.dummy);
 }
 
 
-template <typename T>
-void swap(List<T>& lhs, List<T>& rhs) noexcept {
+template <typename T, typename A>
+void List<T,A>::swap(List& rhs) noexcept {
+    swap_allocators(alloc, rhs.alloc);
+    p_swap_nodes(rhs);
+}
+
+
+template <typename T, typename A>
+void swap(List<T,A>& lhs, List<T,A>& rhs) noexcept {
     lhs.swap(rhs);
 }
 
 
-// Because self assignment happens so rarely we don't check that this != &rhs
-template <typename T>
-List<T>&  List<T>::operator=(const List<T>& rhs) {
-    List<T> temp{rhs};  // Exceptions may occur at this state so we create a temp list and then swap it with *this
-    temp.swap(*this);
+// Because self assignment happens so rarely we don't check that this != &rhs.
+// The copy is made with the allocator that *this will end up with, then the two are exchanged.
+template <typename T, typename A>
+List<T,A>&  List<T,A>::operator=(const List& rhs) {
+    // Exceptions may occur at this state so we create a temp list and then swap it with *this
+    if constexpr (propagate_on_copy_v<node_allocator>) {
+        List temp(rhs, A(rhs.alloc));
+        p_swap_nodes(temp);
+        std::swap(alloc, temp.alloc);
+    }
+    else {
+        List temp(rhs, A(alloc));
+        p_swap_nodes(temp);
+    }
     return *this;
 }
 
 
-template <typename T>
-List<T>&  List<T>::operator=(List<T>&& rhs) noexcept {
-    rhs.swap(*this);
+template <typename T, typename A>
+List<T,A>&  List<T,A>::operator=(List&& rhs) noexcept(propagate_on_move_v<node_allocator> || always_equal_v<node_allocator>) {
+    if constexpr (propagate_on_move_v<node_allocator>) {
+        List temp{std::move(rhs)};
+        p_swap_nodes(temp);
+        std::swap(alloc, temp.alloc);
+    }
+    else {
+        List temp(std::move(rhs), A(alloc));
+        p_swap_nodes(temp);
+    }
     return *this;
 }
 
 
-template <typename T>
-bool operator==(const List<T>& lhs, const List<T>& rhs) {
+template <typename T, typename A>
+bool operator==(const List<T,A>& lhs, const List<T,A>& rhs) {
     if (lhs.size() != rhs.size())
         return false;
 
@@ -304,8 +368,8 @@ bool operator==(const List<T>& lhs, const List<T>& rhs) {
 }
 
 
-template <typename T>
-bool operator!=(const List<T>& lhs, const List<T>& rhs) {
+template <typename T, typename A>
+bool operator!=(const List<T,A>& lhs, const List<T,A>& rhs) {
     return !(lhs == rhs);
 }
 
@@ -314,7 +378,7 @@ template <typename T>
 class List_Iterator {
 private:
     ListNode<T>* current;
-    friend class List<T>;
+    template <typename, typename> friend class List;
 public:
     using iterator_category = std::forward_iterator_tag;
     using difference_type = std::ptrdiff_t;
@@ -359,7 +423,7 @@ template <typename T>
 class Const_List_Iterator {
 private:
     ListNode<T>* current;
-    friend class List<T>;
+    template <typename, typename> friend class List;
 public:
     using iterator_category = std::forward_iterator_tag;
     using difference_type = std::ptrdiff_t;
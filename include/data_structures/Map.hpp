@@ -1,41 +1,169 @@
 #pragma once
 
+#include "Allocator.hpp"
+#include "HashPolicy.hpp"
+#include "MapStats.hpp"
+#include "Simd.hpp"
+#include "SmallVector.hpp"
+#include "ThreadPool.hpp"
 #include "Vector.hpp"
 #include <functional>
+#include <iterator>
+#include <memory>
+#include <string_view>
+#include <tuple>
+#include <type_traits>
 
 namespace data_structures {
 
-template <typename K, typename V, typename H> class Map_Iterator;
-template <typename K, typename V, typename H> class Const_Map_Iterator;
+// A hash function that defines is_transparent promises to hash equal values of different types
+// (e.g. std::string and std::string_view) the same way. Maps that use one can be searched
+// with such values directly, without constructing a temporary key.
+template <typename H, typename Q, typename = void>
+struct is_transparent_lookup : std::false_type {};
 
-template <typename K, typename V, typename H = std::hash<K>>
+template <typename H, typename Q>
+struct is_transparent_lookup<H, Q, std::void_t<typename H::is_transparent>> : std::true_type {};
+
+
+// Transparent hash for std::string keys: lookups can use a std::string_view or a const char*
+struct StringHash {
+    using is_transparent = void;
+    std::size_t operator()(std::string_view s) const { return std::hash<std::string_view>{}(s); }
+};
+
+template <typename K, typename V, typename H, typename P, typename A> class Map_Iterator;
+template <typename K, typename V, typename H, typename P, typename A> class Const_Map_Iterator;
+template <typename K, typename V, typename H> class ConcurrentMap;
+
+// P is the size policy of the table (see HashPolicy.hpp). The default uses prime sizes,
+// PowerOfTwoPolicy trades the division on every access for a mask and a hash mixer.
+// The buckets and the bucket array take their memory from A (see Allocator.hpp).
+template <typename K, typename V, typename H = std::hash<K>, typename P = PrimeSizePolicy,
+          typename A = std::allocator<std::pair<K,V>>>
 class Map {
+    template <typename Q>
+    using transparent_key = std::enable_if_t<is_transparent_lookup<H, Q>::value>;
+
 public:
-    using iterator = Map_Iterator<K,V,H>;
-    using const_iterator = Const_Map_Iterator<K,V,H>;
+    using iterator = Map_Iterator<K,V,H,P,A>;
+    using const_iterator = Const_Map_Iterator<K,V,H,P,A>;
+    using allocator_type = A;
 
     Map();
-    explicit Map(H in_hash);
-    explicit Map(const std::initializer_list<std::pair<K,V>>& list);
+    explicit Map(const A& in_alloc);
+    explicit Map(H in_hash, const A& in_alloc = A());
+    explicit Map(const std::initializer_list<std::pair<K,V>>& list, const A& in_alloc = A());
+    template <typename InputIt, typename = typename std::iterator_traits<InputIt>::iterator_category>
+    Map(InputIt first, InputIt last, const A& in_alloc = A());
+    explicit Map(const Vector<std::pair<K,V>>& entries);
+    explicit Map(Vector<std::pair<K,V>>&& entries);
     Map(const Map& vec);
+    Map(const Map& vec, const A& in_alloc);
     Map(Map&& vec) noexcept;
     ~Map() = default;
 
+    A get_allocator() const { return A(array.get_allocator()); }
+    H get_hasher() const { return hash_function; }
+
     void insert(const K& key, const V& value);
+    void insert(K&& key, V&& value);
     void remove(const K& key);
 
-    std::size_t size() const { return sz;      }
-    bool empty()       const { return sz == 0; }
+    // Inserts a range of pairs, a later pair overwriting the value of an earlier one with the same key.
+    // Forward ranges are loaded in bulk: the table is sized once for all of them and each bucket
+    // grows to its final size in one step, instead of the map rehashing again and again as it fills up.
+    template <typename InputIt, typename = typename std::iterator_traits<InputIt>::iterator_category>
+    void insert(InputIt first, InputIt last);
+
+    // Loads a forward range of pairs using several threads, with the same result as insert(first, last).
+    // The work is split in threads parts that run on parallel::default_pool(). Each part hashes a slice
+    // of the input, then the pairs are partitioned by bucket so that every part fills a disjoint range
+    // of buckets and no locking is needed. It must not run concurrently with any other use of the map.
+    // The buckets allocate from the map's allocator on several threads at once, so that is only done
+    // with stateless allocators (those that are always equal, such as std::allocator). A stateful
+    // allocator, e.g. a polymorphic_allocator over an unsynchronized_pool_resource, need not be
+    // thread safe, so with one the pairs are inserted serially by insert(first, last).
+    template <typename ForwardIt>
+    void parallel_insert(ForwardIt first, ForwardIt last, unsigned threads = parallel::default_threads());
+
+    // Calls fn(key, value) for every element, splitting the buckets into threads ranges that are
+    // walked on the threads of parallel::default_pool(). fn is called concurrently and in no
+    // particular order, so it must be safe to call from several threads at once; it may modify
+    // the values but not the map.
+    template <typename F>
+    void parallel_for_each(F fn, unsigned threads = parallel::default_threads());
+    template <typename F>
+    void parallel_for_each(F fn, unsigned threads = parallel::default_threads()) const;
+
+    // Makes room for n elements in total, so that inserting them will not trigger a rehash
+    void reserve(std::size_t n);
+
+    // Like their std::unordered_map counterparts, these return an iterator to the element
+    // of key and whether it was inserted. try_emplace constructs the value in place from
+    // args only if key is missing, emplace constructs the whole pair before looking it up.
+    template <typename... Args>
+    std::pair<iterator, bool> emplace(Args&&... args);
+    template <typename... Args>
+    std::pair<iterator, bool> try_emplace(const K& key, Args&&... args);
+    template <typename... Args>
+    std::pair<iterator, bool> try_emplace(K&& key, Args&&... args);
+    template <typename M>
+    std::pair<iterator, bool> insert_or_assign(const K& key, M&& value);
+    template <typename M>
+    std::pair<iterator, bool> insert_or_assign(K&& key, M&& value);
+
+    std::size_t size()     const { return sz;      }
+    std::size_t capacity() const { return cap;     }  // number of buckets
+    bool empty()           const { return sz == 0; }
 
     void clear();
     void swap(Map& rhs) noexcept;
 
     V& operator[](const K& key);
+    V& operator[](K&& key);
     const V& operator[](const K& key) const;
     Map&  operator=(const Map& rhs);
-    Map&  operator=(Map&& rhs) noexcept;
+    Map&  operator=(Map&& rhs) noexcept(propagate_on_move_v<A> || always_equal_v<A>);
 
     iterator find(const K& key);
+    const_iterator find(const K& key) const;
+    bool contains(const K& key) const { return counted_lookup(key) != nullptr; }
+    std::size_t count(const K& key) const { return contains(key) ? 1 : 0; }
+
+    // Batched lookups: out[i] receives a pointer to the value of keys[i], or nullptr if it is missing
+    // (for contains_batch, whether it exists). The keys are hashed a window at a time and the memory
+    // of all their buckets is prefetched before any of them is searched, so on maps much larger
+    // than the cache the cache misses of the different keys overlap instead of adding up.
+    void find_batch(const K* keys, std::size_t n, V** out);
+    void find_batch(const K* keys, std::size_t n, const V** out) const;
+    void contains_batch(const K* keys, std::size_t n, bool* out) const;
+    Vector<V*> find_batch(const Vector<K>& keys);
+    Vector<bool> contains_batch(const Vector<K>& keys) const;
+
+    // Heterogeneous overloads, available when H is transparent. K must be comparable
+    // with Q through operator==, and constructible from Q for operator[] to insert.
+    template <typename Q, typename = transparent_key<Q>>
+    iterator find(const Q& key);
+    template <typename Q, typename = transparent_key<Q>>
+    bool contains(const Q& key) const { return counted_lookup(key) != nullptr; }
+    template <typename Q, typename = transparent_key<Q>>
+    std::size_t count(const Q& key) const { return contains(key) ? 1 : 0; }
+    template <typename Q, typename = transparent_key<Q>>
+    V& operator[](const Q& key);
+    template <typename Q, typename = transparent_key<Q>>
+    void remove(const Q& key);
+
+    // Incremental rehashing: once the load factor is exceeded a bigger table is allocated,
+    // but the buckets of the old one are moved over by the following insert/lookup/remove calls,
+    // at most buckets of them per call. A step of 0 (the default) rehashes everything at once.
+    // When the step is too small for the old table to be drained by the inserts that fit before
+    // the next rehash, the calls move more buckets each, as many as it takes to finish in time.
+    void set_rehash_step(std::size_t buckets);
+    std::size_t get_rehash_step() const { return rehash_step;  }
+    bool rehashing()              const { return old_cap != 0; }
+
+    MapStats stats() const;
 
     iterator begin();
     iterator end();
@@ -44,300 +172,933 @@ public:
     const_iterator cend() const;
 
 private: 
-    friend class Map_Iterator<K,V,H>;
-    friend class Const_Map_Iterator<K,V,H>;
+    friend class Map_Iterator<K,V,H,P,A>;
+    friend class Const_Map_Iterator<K,V,H,P,A>;
+    friend class ConcurrentMap<K,V,H>;
+    template <typename K2, typename V2, typename H2, typename P2, typename A2>
+    friend bool operator==(const Map<K2,V2,H2,P2,A2>& lhs, const Map<K2,V2,H2,P2,A2>& rhs);
 
-    static constexpr int prime_sizes[] = { 
-        53, 97, 193, 389, 769, 1543, 3079, 6151, 12289,
-        24593, 49157, 98317, 196613, 393241,
-        786433, 1572869, 3145739, 6291469, 12582917,
-        25165843, 50331653, 100663319, 201326611,
-        402653189, 805306457, 1610612741
-    };
+    // At the maximum load factor most buckets hold at most one element, so that one is kept
+    // inside the bucket itself and only longer chains allocate
+    using Bucket = SmallVector<std::pair<K,V>, 1, A>;
+    using Table = Vector<Bucket, rebind_alloc_t<A, Bucket>>;
 
     static constexpr double max_load_factor {0.9};
+    static constexpr std::size_t batch_window {16};  // keys whose buckets are prefetched together
 
     std::size_t sz {};
-    std::size_t cap {prime_sizes[0]};
+    std::size_t cap {P::min_size()};
+    std::size_t old_cap {};      // while rehashing, the number of buckets of the table being drained
+    std::size_t migrate_pos {};  // buckets of old_array before this position have already been moved
+    std::size_t rehash_step {};
+    std::size_t min_drain_step {};  // buckets a call has to move for the current rehash to finish in time
 
     H hash_function;
-    Vector<Vector<std::pair<K,V>>> array;
+    Table array;
+    Table old_array;
+
+    std::size_t rehashes {};
+    std::chrono::nanoseconds rehash_time {};
+    LookupCounters counters;
+
+    void rehash(std::size_t new_cap);
+    void migrate(std::size_t buckets);
+    void p_swap_fields(Map& rhs) noexcept;  // everything but the tables
+    std::size_t drain_step() const { return rehash_step > min_drain_step ? rehash_step : min_drain_step; }
+    void fill_table(std::size_t n);
+    void copy_table(Table& to, const Table& from);
+
+    template <typename Q>
+    const std::pair<K,V>* lookup(const Q& key, std::size_t* found_in = nullptr) const;
+    template <typename Q>
+    std::pair<K,V>* lookup(const Q& key, std::size_t* found_in = nullptr) {
+        return const_cast<std::pair<K,V>*>(static_cast<const Map*>(this)->lookup(key, found_in));
+    }
+    // lookup() for the public search functions, which also records a hit or a miss for stats()
+    template <typename Q>
+    const std::pair<K,V>* counted_lookup(const Q& key, std::size_t* found_in = nullptr) const {
+        const std::pair<K,V>* p = lookup(key, found_in);
+        counters.record(p != nullptr);
+        return p;
+    }
+    template <typename Q>
+    std::pair<K,V>* counted_lookup(const Q& key, std::size_t* found_in = nullptr) {
+        return const_cast<std::pair<K,V>*>(static_cast<const Map*>(this)->counted_lookup(key, found_in));
+    }
+    template <typename Q>
+    iterator locate(const Q& key);
+    template <typename F>
+    void p_find_batch(const K* keys, std::size_t n, F&& found) const;
+    template <typename M, typename F>
+    static void p_parallel_for_each(M& map, F& fn, unsigned threads);
+    template <typename Q>
+    bool erase_key(const Q& key);
+
+    std::size_t prepare_insert(std::size_t hash);
+    template <typename KK, typename... Args>
+    std::pair<K,V>& emplace_new(std::size_t hash, KK&& key, Args&&... args);
+    template <typename KK, typename... Args>
+    std::pair<iterator, bool> p_try_emplace(KK&& key, Args&&... args);
+    template <typename KK, typename M>
+    std::pair<iterator, bool> p_insert_or_assign(KK&& key, M&& value);
+
+    iterator iterator_at(std::size_t b, std::pair<K,V>* p) {
+        return iterator{this, b, typename Bucket::iterator{p}};
+    }
 
-    void rehash();
-    V& get_value(const K& key);
+    // The iterators see the new table followed by the old one as a single sequence of buckets
+    std::size_t bucket_count() const { return cap + old_cap; }
+    Bucket& bucket(std::size_t i) { return i < cap ? array[i] : old_array[i - cap]; }
+    const Bucket& bucket(std::size_t i) const { return i < cap ? array[i] : old_array[i - cap]; }
 };
 
 
-template <typename K, typename V, typename H>
-Map<K,V,H>::Map()
-    : hash_function{H()}
-{
-    array.reserve(cap);
-    array.resize(cap);  // value-initialize the inner vectors
-}
+template <typename K, typename V, typename H, typename P, typename A>
+Map<K,V,H,P,A>::Map()
+    : Map(H()) {}
+
 
+template <typename K, typename V, typename H, typename P, typename A>
+Map<K,V,H,P,A>::Map(const A& in_alloc)
+    : Map(H(), in_alloc) {}
 
-template <typename K, typename V, typename H>
-Map<K,V,H>::Map(H in_hash)
-    : hash_function{in_hash()}
+
+template <typename K, typename V, typename H, typename P, typename A>
+Map<K,V,H,P,A>::Map(H in_hash, const A& in_alloc)
+    : hash_function{in_hash}, array(in_alloc), old_array(in_alloc)
 {
-    array.reserve(cap);
-    array.resize(cap);
+    fill_table(cap);
 }
 
 
-template <typename K, typename V, typename H>
-Map<K,V,H>::Map(const std::initializer_list<std::pair<K,V>>& list)
-    : hash_function{H()}
+template <typename K, typename V, typename H, typename P, typename A>
+Map<K,V,H,P,A>::Map(const std::initializer_list<std::pair<K,V>>& list, const A& in_alloc)
+    : Map(H(), in_alloc)
 {
-    array.reserve(cap);
-    array.resize(cap);
     for (auto& e : list)
         insert(e.first, e.second);
 }
 
 
-template <typename K, typename V, typename H>
-Map<K,V,H>::Map(const Map& map) 
-    : sz{map.sz}, cap{map.cap}, hash_function{H()}, array{map.array}
-{    
-    for (int i = 0; i < map.array.capacity(); ++i)
-        array[i] = map.array[i];
+template <typename K, typename V, typename H, typename P, typename A>
+template <typename InputIt, typename>
+Map<K,V,H,P,A>::Map(InputIt first, InputIt last, const A& in_alloc)
+    : Map(in_alloc)
+{
+    insert(first, last);
 }
 
 
-template <typename K, typename V, typename H>
-Map<K,V,H>::Map(Map&& map) noexcept
-    : hash_function{H()}
+template <typename K, typename V, typename H, typename P, typename A>
+Map<K,V,H,P,A>::Map(const Vector<std::pair<K,V>>& entries)
+    : Map()
+{
+    insert(entries.cbegin(), entries.cend());
+}
+
+
+// The pairs are moved out of entries, which is left with moved-from elements
+template <typename K, typename V, typename H, typename P, typename A>
+Map<K,V,H,P,A>::Map(Vector<std::pair<K,V>>&& entries)
+    : Map()
+{
+    insert(std::make_move_iterator(entries.begin()), std::make_move_iterator(entries.end()));
+}
+
+
+template <typename K, typename V, typename H, typename P, typename A>
+Map<K,V,H,P,A>::Map(const Map& map) 
+    : Map(map, std::allocator_traits<A>::select_on_container_copy_construction(map.get_allocator())) {}
+
+
+template <typename K, typename V, typename H, typename P, typename A>
+Map<K,V,H,P,A>::Map(const Map& map, const A& in_alloc) 
+    : sz{map.sz}, cap{map.cap}, old_cap{map.old_cap}, migrate_pos{map.migrate_pos}, rehash_step{map.rehash_step},
+      min_drain_step{map.min_drain_step},
+      hash_function{map.hash_function}, array(in_alloc), old_array(in_alloc)
+{
+    copy_table(array, map.array);
+    copy_table(old_array, map.old_array);
+}
+
+
+// The moved-from map is left as a valid empty map
+template <typename K, typename V, typename H, typename P, typename A>
+Map<K,V,H,P,A>::Map(Map&& map) noexcept
+    : Map(map.get_allocator())
 {
     map.swap(*this);
 } 
 
 
-template <typename K, typename V, typename H>
-void Map<K,V,H>::swap(Map& rhs) noexcept {
+template <typename K, typename V, typename H, typename P, typename A>
+void Map<K,V,H,P,A>::swap(Map& rhs) noexcept {
+    p_swap_fields(rhs);
+    array.swap(rhs.array);
+    old_array.swap(rhs.old_array);
+}
+
+
+template <typename K, typename V, typename H, typename P, typename A>
+void Map<K,V,H,P,A>::p_swap_fields(Map& rhs) noexcept {
     std::swap(sz, rhs.sz);
     std::swap(cap, rhs.cap);
+    std::swap(old_cap, rhs.old_cap);
+    std::swap(migrate_pos, rhs.migrate_pos);
+    std::swap(rehash_step, rhs.rehash_step);
+    std::swap(min_drain_step, rhs.min_drain_step);
+    std::swap(hash_function, rhs.hash_function);
+    std::swap(rehashes, rhs.rehashes);
+    std::swap(rehash_time, rhs.rehash_time);
+    counters.swap(rhs.counters);
+}
 
-    // We need also to swap the contents of the inner vectors
-    Map temp {*this};
 
-    array = rhs.array;
-    for (int i = 0; i < array.capacity(); ++i)
-        array[i] = std::move(rhs.array[i]);
+// Returns the pair that holds key, or nullptr if there is none. If found_in is given it receives
+// the index of the bucket in the numbering of the iterators (see bucket()).
+// While rehashing, a key whose old bucket has not been moved yet is still in old_array.
+template <typename K, typename V, typename H, typename P, typename A>
+template <typename Q>
+const std::pair<K,V>* Map<K,V,H,P,A>::lookup(const Q& key, std::size_t* found_in) const {
+    std::size_t hash = hash_function(key);
+    std::size_t pos = P::index(hash, cap);
+    const Bucket& b = array[pos];
+    for (std::size_t i = 0; i < b.size(); ++i) {
+        if (b[i].first == key) {
+            if (found_in)
+                *found_in = pos;
+            return &b[i];
+        }
+    }
 
-    rhs.array = temp.array;
-    for (int i = 0; i < rhs.array.capacity(); ++i)
-        rhs.array[i] = std::move(temp.array[i]);
+    if (old_cap && P::index(hash, old_cap) >= migrate_pos) {
+        pos = P::index(hash, old_cap);
+        const Bucket& old_b = old_array[pos];
+        for (std::size_t i = 0; i < old_b.size(); ++i) {
+            if (old_b[i].first == key) {
+                if (found_in)
+                    *found_in = cap + pos;
+                return &old_b[i];
+            }
+        }
+    }
+    return nullptr;
 }
 
 
-template <typename K, typename V, typename H>
-V& Map<K,V,H>::get_value(const K& key) {
-    unsigned pos = hash_function(key) % cap;
-    for (auto& p : array[pos])
-        if (p.first == key)
-            return p.second;
-    throw std::runtime_error("");
+// Same search as lookup, but it returns an iterator to the pair
+template <typename K, typename V, typename H, typename P, typename A>
+template <typename Q>
+typename Map<K,V,H,P,A>::iterator Map<K,V,H,P,A>::locate(const Q& key) {
+    std::size_t b {};
+    std::pair<K,V>* p = counted_lookup(key, &b);
+    return p ? iterator_at(b, p) : end();
 }
 
 
-template <typename K, typename V, typename H>
-void Map<K,V,H>::rehash() {
-    Vector<Vector<std::pair<K,V>>> old_array{array};
+// Appends empty buckets to array until it has n of them. Every bucket gets the allocator of the map.
+template <typename K, typename V, typename H, typename P, typename A>
+void Map<K,V,H,P,A>::fill_table(std::size_t n) {
+    array.reserve(n);
+    array.resize(n, Bucket(get_allocator()));
+}
 
-    std::size_t old_cap {cap};
-    int prime_no = sizeof(prime_sizes) / sizeof(int);
-    for (int i = 0; i < prime_no; ++i) {
-        if (prime_sizes[i] > old_cap) {
-            cap = prime_sizes[i];
-            break;
-        }
+
+// Makes to (an empty table) a copy of from, with buckets that use the allocator of the map
+template <typename K, typename V, typename H, typename P, typename A>
+void Map<K,V,H,P,A>::copy_table(Table& to, const Table& from) {
+    to.reserve(from.size());
+    for (std::size_t i = 0; i < from.size(); ++i) {
+        to.push_back(Bucket(get_allocator()));
+        to.back() = from[i];
     }
- 
-    if (cap == old_cap)
-        cap *= 2;
- 
-    array.clear();
-    array.reserve(cap);
-    array.resize(cap);
+}
 
-    sz = 0;
-    for (std::size_t i = 0; i < old_array.size(); ++i) {
-        for (auto& p : old_array[i])
-            insert(p.first, p.second);
-        old_array[i].clear();
+
+// Moves up to the given number of buckets from old_array to array and
+// releases the old table once it has been drained.
+template <typename K, typename V, typename H, typename P, typename A>
+void Map<K,V,H,P,A>::migrate(std::size_t buckets) {
+    if (!old_cap)
+        return;
+
+    ScopedTimer timer{rehash_time};
+    for (; buckets && migrate_pos < old_cap; --buckets, ++migrate_pos) {
+        for (auto& p : old_array[migrate_pos])
+            array[P::index(hash_function(p.first), cap)].push_back(std::move(p));
+        Bucket(get_allocator()).swap(old_array[migrate_pos]);
+    }
+
+    if (migrate_pos == old_cap) {
+        Table(old_array.get_allocator()).swap(old_array);
+        old_cap = 0;
+        migrate_pos = 0;
     }
-    old_array.clear();
 }
-    
 
-template <typename K, typename V, typename H>
-void Map<K,V,H>::insert(const K& key, const V& value) {
-    bool already_in_map = false;
-    unsigned pos = hash_function(key) % cap;
 
-    for (auto& p : array[pos]) {
-        if (p.first == key) {
-            p.second = value;
-            already_in_map = true;
-        }
+// Allocates a table of new_cap buckets. The old buckets are kept in old_array and
+// get moved either right away or, in incremental mode, by later operations.
+// Those must drain the old table before the inserts reach the next load threshold, or the
+// insert that crosses it would have to move all the buckets that are left in one go.
+template <typename K, typename V, typename H, typename P, typename A>
+void Map<K,V,H,P,A>::rehash(std::size_t new_cap) {
+    ++rehashes;
+    {
+        ScopedTimer timer{rehash_time};
+        old_array.swap(array);
+        old_cap = cap;
+        migrate_pos = 0;
+
+        cap = new_cap;
+        fill_table(cap);
     }
 
-    if (!already_in_map) {
-        array[pos].push_back(std::make_pair(key, value));
-        ++sz;
+    if (!rehash_step) {
+        migrate(old_cap);
+        return;
     }
 
-    double load_factor = static_cast<double>(sz) / cap;
-    if (load_factor >= max_load_factor)
-        rehash();
-} 
+    // The insert that triggered this one and the one that triggers the next rehash don't count
+    std::size_t threshold = static_cast<std::size_t>(max_load_factor * cap);
+    std::size_t inserts = threshold > sz + 2 ? threshold - sz - 2 : 1;
+    min_drain_step = (old_cap + inserts - 1) / inserts;
+}
 
 
-template <typename K, typename V, typename H>
-void Map<K,V,H>::remove(const K& key) {
-    unsigned pos = hash_function(key) % cap;
-    if (array[pos].empty()) 
-        throw std::runtime_error("no such key in the map");
+// Walks every bucket, so it takes time linear in the number of buckets
+template <typename K, typename V, typename H, typename P, typename A>
+MapStats Map<K,V,H,P,A>::stats() const {
+    MapStats s;
+    s.size = sz;
+    s.buckets = cap;
+    s.load_factor = static_cast<double>(sz) / cap;
+    s.rehashes = rehashes;
+    s.rehash_time = rehash_time;
+    s.hits = counters.hits();
+    s.misses = counters.misses();
+
+    s.bytes_allocated = (array.capacity() + old_array.capacity()) * sizeof(Bucket);
+    for (std::size_t i = 0; i < bucket_count(); ++i) {
+        const Bucket& b = bucket(i);
+        if (!b.inlined())
+            s.bytes_allocated += b.capacity() * sizeof(std::pair<K,V>);
+        while (s.histogram.size() <= b.size())
+            s.histogram.push_back(0);
+        ++s.histogram[b.size()];
+        if (b.size() > s.max_length)
+            s.max_length = b.size();
+    }
+    return s;
+}
+
+
+template <typename K, typename V, typename H, typename P, typename A>
+void Map<K,V,H,P,A>::set_rehash_step(std::size_t buckets) {
+    rehash_step = buckets;
+    if (!rehash_step)
+        migrate(old_cap);
+}
     
-    for (auto iter = array[pos].begin(); iter != array[pos].end(); ++iter) {
-        if (iter->first == key) {
-            array[pos].erase(iter);
-            --sz;
+
+// Grows the table if one more element would reach the maximum load factor and returns
+// the bucket that an element with the given hash goes into.
+template <typename K, typename V, typename H, typename P, typename A>
+std::size_t Map<K,V,H,P,A>::prepare_insert(std::size_t hash) {
+    double load_factor = static_cast<double>(sz + 1) / cap;
+    if (load_factor >= max_load_factor) {
+        migrate(old_cap);  // a rehash that is still in progress has to finish before the next one starts
+        rehash(P::next_size(cap + 1));
+    }
+    return P::index(hash, cap);
+}
+
+
+// Inserts a key that is known to be missing. The pair is constructed directly inside its bucket,
+// so the key is only copied or moved once (or converted, for heterogeneous keys).
+template <typename K, typename V, typename H, typename P, typename A>
+template <typename KK, typename... Args>
+std::pair<K,V>& Map<K,V,H,P,A>::emplace_new(std::size_t hash, KK&& key, Args&&... args) {
+    std::size_t pos = prepare_insert(hash);
+    array[pos].emplace_back(std::piecewise_construct,
+                            std::forward_as_tuple(std::forward<KK>(key)),
+                            std::forward_as_tuple(std::forward<Args>(args)...));
+    ++sz;
+    return array[pos].back();
+}
+
+
+template <typename K, typename V, typename H, typename P, typename A>
+template <typename KK, typename... Args>
+std::pair<typename Map<K,V,H,P,A>::iterator, bool> Map<K,V,H,P,A>::p_try_emplace(KK&& key, Args&&... args) {
+    migrate(drain_step());
+
+    std::size_t b {};
+    if (std::pair<K,V>* p = lookup(key, &b))
+        return {iterator_at(b, p), false};
+
+    std::size_t hash = hash_function(key);
+    std::pair<K,V>& p = emplace_new(hash, std::forward<KK>(key), std::forward<Args>(args)...);
+    return {iterator_at(P::index(hash, cap), &p), true};
+}
+
+
+template <typename K, typename V, typename H, typename P, typename A>
+template <typename KK, typename M>
+std::pair<typename Map<K,V,H,P,A>::iterator, bool> Map<K,V,H,P,A>::p_insert_or_assign(KK&& key, M&& value) {
+    migrate(drain_step());
+
+    std::size_t b {};
+    if (std::pair<K,V>* p = lookup(key, &b)) {
+        p->second = std::forward<M>(value);
+        return {iterator_at(b, p), false};
+    }
+
+    std::size_t hash = hash_function(key);
+    std::pair<K,V>& p = emplace_new(hash, std::forward<KK>(key), std::forward<M>(value));
+    return {iterator_at(P::index(hash, cap), &p), true};
+}
+
+
+template <typename K, typename V, typename H, typename P, typename A>
+template <typename... Args>
+std::pair<typename Map<K,V,H,P,A>::iterator, bool> Map<K,V,H,P,A>::try_emplace(const K& key, Args&&... args) {
+    return p_try_emplace(key, std::forward<Args>(args)...);
+}
+
+
+template <typename K, typename V, typename H, typename P, typename A>
+template <typename... Args>
+std::pair<typename Map<K,V,H,P,A>::iterator, bool> Map<K,V,H,P,A>::try_emplace(K&& key, Args&&... args) {
+    return p_try_emplace(std::move(key), std::forward<Args>(args)...);
+}
+
+
+template <typename K, typename V, typename H, typename P, typename A>
+template <typename M>
+std::pair<typename Map<K,V,H,P,A>::iterator, bool> Map<K,V,H,P,A>::insert_or_assign(const K& key, M&& value) {
+    return p_insert_or_assign(key, std::forward<M>(value));
+}
+
+
+template <typename K, typename V, typename H, typename P, typename A>
+template <typename M>
+std::pair<typename Map<K,V,H,P,A>::iterator, bool> Map<K,V,H,P,A>::insert_or_assign(K&& key, M&& value) {
+    return p_insert_or_assign(std::move(key), std::forward<M>(value));
+}
+
+
+// The key is needed before we know where the pair goes, so the pair is built first and moved into place
+template <typename K, typename V, typename H, typename P, typename A>
+template <typename... Args>
+std::pair<typename Map<K,V,H,P,A>::iterator, bool> Map<K,V,H,P,A>::emplace(Args&&... args) {
+    std::pair<K,V> p(std::forward<Args>(args)...);
+    return p_try_emplace(std::move(p.first), std::move(p.second));
+}
+
+
+// If the key already exists its value gets updated
+template <typename K, typename V, typename H, typename P, typename A>
+void Map<K,V,H,P,A>::insert(const K& key, const V& value) {
+    p_insert_or_assign(key, value);
+} 
+
+
+template <typename K, typename V, typename H, typename P, typename A>
+void Map<K,V,H,P,A>::insert(K&& key, V&& value) {
+    p_insert_or_assign(std::move(key), std::move(value));
+}
+
+
+template <typename K, typename V, typename H, typename P, typename A>
+void Map<K,V,H,P,A>::reserve(std::size_t n) {
+    std::size_t needed = static_cast<std::size_t>(n / max_load_factor) + 1;
+    if (needed <= cap)
+        return;
+    migrate(old_cap);
+    std::size_t step = rehash_step;
+    rehash_step = 0;  // a reserve moves every bucket right away
+    rehash(P::next_size(needed));
+    rehash_step = step;
+}
+
+
+// Bulk loading makes two passes over a forward range. The first one hashes every pair and sizes
+// the table for all of them, the second one reserves each bucket for the pairs that land in it
+// and then places them, so that neither the table nor any bucket is reallocated while filling.
+// A single pass input range is inserted one pair at a time.
+template <typename K, typename V, typename H, typename P, typename A>
+template <typename InputIt, typename>
+void Map<K,V,H,P,A>::insert(InputIt first, InputIt last) {
+    if constexpr (!std::is_base_of_v<std::forward_iterator_tag, typename std::iterator_traits<InputIt>::iterator_category>) {
+        for (; first != last; ++first) {
+            auto&& e = *first;
+            p_insert_or_assign(std::forward<decltype(e)>(e).first, std::forward<decltype(e)>(e).second);
+        }
+    }
+    else {
+        Vector<std::size_t> hashes;
+        for (InputIt it = first; it != last; ++it) {
+            const auto& e = *it;
+            hashes.push_back(hash_function(static_cast<const K&>(e.first)));
+        }
+        if (hashes.empty())
             return;
+
+        reserve(sz + hashes.size());
+        migrate(old_cap);
+
+        Vector<std::size_t> counts(cap, 0);
+        for (std::size_t i = 0; i < hashes.size(); ++i)
+            ++counts[P::index(hashes[i], cap)];
+        for (std::size_t b = 0; b < cap; ++b)
+            if (counts[b])
+                array[b].reserve(array[b].size() + counts[b]);
+
+        std::size_t i {};
+        for (; first != last; ++first, ++i) {
+            auto&& e = *first;
+            Bucket& b = array[P::index(hashes[i], cap)];
+            std::size_t j {};
+            while (j < b.size() && !(b[j].first == e.first))
+                ++j;
+            if (j < b.size())
+                b[j].second = std::forward<decltype(e)>(e).second;
+            else {
+                b.emplace_back(std::forward<decltype(e)>(e));
+                ++sz;
+            }
         }
     }
 }
 
 
-template <typename K, typename V, typename H>
-void Map<K,V,H>::clear() {
-    array.clear();
-    sz = 0;
-}
+// Parallel bulk loading runs in four phases, each split in the same parts: hash the pairs,
+// count how many pairs every part's slice of the input sends to every part's range of
+// buckets, scatter the pair indices into per-range lists (in input order, so that the last pair
+// with a key still wins), and finally let each part place the pairs of its own bucket range.
+template <typename K, typename V, typename H, typename P, typename A>
+template <typename ForwardIt>
+void Map<K,V,H,P,A>::parallel_insert(ForwardIt first, ForwardIt last, unsigned threads) {
+    static_assert(std::is_base_of_v<std::forward_iterator_tag, typename std::iterator_traits<ForwardIt>::iterator_category>,
+                  "parallel_insert needs a forward range");
+    if constexpr (!always_equal_v<A>) {
+        insert(first, last);
+        return;
+    }
+
+    Vector<ForwardIt> items;
+    for (; first != last; ++first)
+        items.push_back(first);
+    std::size_t n = items.size();
+    if (n == 0)
+        return;
+    if (threads == 0)
+        threads = 1;
+    if (threads > n)
+        threads = static_cast<unsigned>(n);
+
+    Vector<std::size_t> buckets(n, 0);
+    parallel::fork_join(parallel::default_pool(), threads, [&](unsigned t) {
+        for (std::size_t i = parallel::slice_begin(n, threads, t); i < parallel::slice_end(n, threads, t); ++i)
+            buckets[i] = hash_function(static_cast<const K&>((*items[i]).first));
+    });
+
+    reserve(sz + n);
+    migrate(old_cap);
+
+    // counts[t * threads + o]: pairs of input slice t that belong to bucket range o
+    auto owner = [this, threads](std::size_t b) { return static_cast<unsigned>(b * threads / cap); };
+    Vector<std::size_t> counts(static_cast<std::size_t>(threads) * threads, 0);
+    parallel::fork_join(parallel::default_pool(), threads, [&](unsigned t) {
+        for (std::size_t i = parallel::slice_begin(n, threads, t); i < parallel::slice_end(n, threads, t); ++i) {
+            buckets[i] = P::index(buckets[i], cap);
+            ++counts[t * threads + owner(buckets[i])];
+        }
+    });
+
+    Vector<std::size_t> range_begin(threads + 1, 0);
+    std::size_t pos {};
+    for (unsigned o = 0; o < threads; ++o) {
+        range_begin[o] = pos;
+        for (unsigned t = 0; t < threads; ++t) {
+            std::size_t c = counts[t * threads + o];
+            counts[t * threads + o] = pos;
+            pos += c;
+        }
+    }
+    range_begin[threads] = pos;
 
+    Vector<std::size_t> order(n, 0);
+    parallel::fork_join(parallel::default_pool(), threads, [&](unsigned t) {
+        for (std::size_t i = parallel::slice_begin(n, threads, t); i < parallel::slice_end(n, threads, t); ++i)
+            order[counts[t * threads + owner(buckets[i])]++] = i;
+    });
 
-// If the key exists in the map we return the value it maps to, otherwise 
-// we create a new std::pair<K,V> that maps the given key to a default value V.
-template <typename K, typename V, typename H>
-V& Map<K,V,H>::operator[](const K& key) {
+    Vector<std::size_t> added(threads, 0);
     try {
-        return get_value(key);  
+        parallel::fork_join(parallel::default_pool(), threads, [&](unsigned o) {
+            for (std::size_t k = range_begin[o]; k < range_begin[o + 1]; ++k) {
+                std::size_t i = order[k];
+                Bucket& b = array[buckets[i]];
+                const auto& e = *items[i];
+                std::size_t j {};
+                while (j < b.size() && !(b[j].first == e.first))
+                    ++j;
+                if (j < b.size())
+                    b[j].second = e.second;
+                else {
+                    b.emplace_back(e);
+                    ++added[o];
+                }
+            }
+        });
     }
-    catch (std::runtime_error& e) {
-        insert(key, V{});
-        return get_value(key);
+    catch (...) {
+        for (unsigned o = 0; o < threads; ++o)
+            sz += added[o];
+        throw;
     }
+    for (unsigned o = 0; o < threads; ++o)
+        sz += added[o];
 }
 
 
-template <typename K, typename V, typename H>
-const V& Map<K,V,H>::operator[](const K& key) const
-{
-    try {
-        return get_value(key);  
+// Const and non-const maps share this, M being Map or const Map. The ranges also cover
+// the buckets of a table that is still being rehashed.
+template <typename K, typename V, typename H, typename P, typename A>
+template <typename M, typename F>
+void Map<K,V,H,P,A>::p_parallel_for_each(M& map, F& fn, unsigned threads) {
+    std::size_t n = map.bucket_count();
+    if (threads == 0)
+        threads = 1;
+    if (threads > n)
+        threads = static_cast<unsigned>(n);
+
+    parallel::fork_join(parallel::default_pool(), threads, [&](unsigned t) {
+        for (std::size_t i = parallel::slice_begin(n, threads, t); i < parallel::slice_end(n, threads, t); ++i) {
+            auto& b = map.bucket(i);
+            for (std::size_t j = 0; j < b.size(); ++j)
+                fn(static_cast<const K&>(b[j].first), b[j].second);
+        }
+    });
+}
+
+
+template <typename K, typename V, typename H, typename P, typename A>
+template <typename F>
+void Map<K,V,H,P,A>::parallel_for_each(F fn, unsigned threads) {
+    p_parallel_for_each(*this, fn, threads);
+}
+
+
+template <typename K, typename V, typename H, typename P, typename A>
+template <typename F>
+void Map<K,V,H,P,A>::parallel_for_each(F fn, unsigned threads) const {
+    p_parallel_for_each(*this, fn, threads);
+}
+
+
+// Returns false if there was no such key
+template <typename K, typename V, typename H, typename P, typename A>
+template <typename Q>
+bool Map<K,V,H,P,A>::erase_key(const Q& key) {
+    migrate(drain_step());
+
+    std::size_t hash = hash_function(key);
+    Bucket* buckets[2] = { &array[P::index(hash, cap)], nullptr };
+    if (old_cap && P::index(hash, old_cap) >= migrate_pos)
+        buckets[1] = &old_array[P::index(hash, old_cap)];
+
+    for (auto b : buckets) {
+        if (!b)
+            continue;
+        for (auto iter = b->begin(); iter != b->end(); ++iter) {
+            if (iter->first == key) {
+                b->erase(iter);
+                --sz;
+                return true;
+            }
+        }
     }
-    catch (std::runtime_error& e) {
-        insert(key, V{});
-        return get_value(key);
-    }    
+    return false;
+}
+
+
+template <typename K, typename V, typename H, typename P, typename A>
+void Map<K,V,H,P,A>::remove(const K& key) {
+    if (!erase_key(key))
+        throw std::runtime_error("no such key in the map");
+}
+
+
+template <typename K, typename V, typename H, typename P, typename A>
+template <typename Q, typename>
+void Map<K,V,H,P,A>::remove(const Q& key) {
+    if (!erase_key(key))
+        throw std::runtime_error("no such key in the map");
+}
+
+
+template <typename K, typename V, typename H, typename P, typename A>
+void Map<K,V,H,P,A>::clear() {
+    for (std::size_t i = 0; i < cap; ++i)
+        array[i].clear();
+    Table(old_array.get_allocator()).swap(old_array);
+    old_cap = 0;
+    migrate_pos = 0;
+    sz = 0;
+}
+
+
+// If the key exists in the map we return the value it maps to, otherwise 
+// we create a new std::pair<K,V> that maps the given key to a value-initialized V.
+// Either way it takes a single hashed lookup.
+template <typename K, typename V, typename H, typename P, typename A>
+V& Map<K,V,H,P,A>::operator[](const K& key) {
+    migrate(drain_step());
+    if (std::pair<K,V>* p = counted_lookup(key))
+        return p->second;
+    return emplace_new(hash_function(key), key).second;
+}
+
+
+template <typename K, typename V, typename H, typename P, typename A>
+V& Map<K,V,H,P,A>::operator[](K&& key) {
+    migrate(drain_step());
+    if (std::pair<K,V>* p = counted_lookup(key))
+        return p->second;
+    std::size_t hash = hash_function(key);
+    return emplace_new(hash, std::move(key)).second;
 }
 
 
-// Because self assignment happens so rarely we don't check that this != &rhs
-template <typename K, typename V, typename H>
-Map<K,V,H>& Map<K,V,H>::operator=(const Map& rhs) {
-    Map temp{rhs};
+// A const map cannot insert, so a missing key is an error
+template <typename K, typename V, typename H, typename P, typename A>
+const V& Map<K,V,H,P,A>::operator[](const K& key) const {
+    const std::pair<K,V>* p = counted_lookup(key);
+    if (!p)
+        throw std::runtime_error("no such key in the map");
+    return p->second;
+}
+
+
+// The key is only converted to K if it has to be inserted
+template <typename K, typename V, typename H, typename P, typename A>
+template <typename Q, typename>
+V& Map<K,V,H,P,A>::operator[](const Q& key) {
+    migrate(drain_step());
+    if (std::pair<K,V>* p = counted_lookup(key))
+        return p->second;
+    return emplace_new(hash_function(key), key).second;
+}
+
+
+// Because self assignment happens so rarely we don't check that this != &rhs.
+// The copy is made with the allocator that *this will end up with, then the two are exchanged.
+template <typename K, typename V, typename H, typename P, typename A>
+Map<K,V,H,P,A>& Map<K,V,H,P,A>::operator=(const Map& rhs) {
+    Map temp(rhs, propagate_on_copy_v<A> && propagate_on_swap_v<A> ? rhs.get_allocator() : get_allocator());
     temp.swap(*this);
     return *this;
 }
 
 
-template <typename K, typename V, typename H>
-Map<K,V,H>& Map<K,V,H>::operator=(Map&& rhs) noexcept {
-    rhs.swap(*this);
+// An allocator that propagates on move assignment comes along with the tables of rhs. Otherwise
+// the buckets of rhs can only change owner if our allocator can free them, else they are copied.
+template <typename K, typename V, typename H, typename P, typename A>
+Map<K,V,H,P,A>& Map<K,V,H,P,A>::operator=(Map&& rhs) noexcept(propagate_on_move_v<A> || always_equal_v<A>) {
+    if constexpr (propagate_on_move_v<A>) {
+        Map temp{std::move(rhs)};
+        array = std::move(temp.array);  // the Vector move assignments take the allocator too
+        old_array = std::move(temp.old_array);
+        p_swap_fields(temp);
+    }
+    else if (always_equal_v<A> || get_allocator() == rhs.get_allocator())
+        rhs.swap(*this);
+    else {
+        *this = rhs;
+        rhs.clear();
+    }
     return *this;
 }
 
 
-template <typename K, typename V, typename H>
-bool operator==(const Map<K,V,H>& lhs, const Map<K,V,H>& rhs) {
+// Maps with the same elements can keep them in different orders (different table sizes, one
+// of them in the middle of a rehash), so every key of lhs is looked up in rhs
+template <typename K, typename V, typename H, typename P, typename A>
+bool operator==(const Map<K,V,H,P,A>& lhs, const Map<K,V,H,P,A>& rhs) {
     if (lhs.size() != rhs.size())
         return false;
 
-    auto lhs_iter {lhs.cbegin()};
-    auto rhs_iter {rhs.cbegin()};
-
-    while (lhs_iter != lhs.cend()) {
-        if ( (lhs_iter->first != rhs_iter->first) || (lhs_iter->second != rhs_iter->second) )
-            return false; 
-        ++lhs_iter;
-        ++rhs_iter;
-    }   
+    for (auto iter = lhs.cbegin(); iter != lhs.cend(); ++iter) {
+        const std::pair<K,V>* found = rhs.lookup(iter->first);
+        if (!found || found->second != iter->second)
+            return false;
+    }
     return true;    
 }
 
 
-template <typename K, typename V, typename H>
-bool operator!=(const Map<K,V,H>& lhs, const Map<K,V,H>& rhs) {
+template <typename K, typename V, typename H, typename P, typename A>
+bool operator!=(const Map<K,V,H,P,A>& lhs, const Map<K,V,H,P,A>& rhs) {
     return !(lhs == rhs);
 }
 
 
-template <typename K, typename V, typename H>
-typename Map<K,V,H>::iterator Map<K,V,H>::find(const K& key) {
-    for (iterator iter = begin(); iter != end(); ++iter)
-        if (iter->first == key)
-            return iter;
-    return end();
+template <typename K, typename V, typename H, typename P, typename A>
+typename Map<K,V,H,P,A>::iterator Map<K,V,H,P,A>::find(const K& key) {
+    migrate(drain_step());
+    return locate(key);
+}
+
+
+template <typename K, typename V, typename H, typename P, typename A>
+typename Map<K,V,H,P,A>::const_iterator Map<K,V,H,P,A>::find(const K& key) const {
+    std::size_t b {};
+    const std::pair<K,V>* p = counted_lookup(key, &b);
+    if (!p)
+        return cend();
+    return const_iterator{this, b, typename Bucket::const_iterator{const_cast<std::pair<K,V>*>(p)}};
+}
+
+
+template <typename K, typename V, typename H, typename P, typename A>
+template <typename Q, typename>
+typename Map<K,V,H,P,A>::iterator Map<K,V,H,P,A>::find(const Q& key) {
+    migrate(drain_step());
+    return locate(key);
+}
+
+
+// Calls found(i, pair) for every key, pair being nullptr if keys[i] is missing.
+// Each window goes through three passes: hash the keys and prefetch their bucket headers,
+// prefetch the elements of the buckets, and finally search them. While an incremental
+// rehash is in progress a key may be in either table, so we fall back to plain lookups.
+template <typename K, typename V, typename H, typename P, typename A>
+template <typename F>
+void Map<K,V,H,P,A>::p_find_batch(const K* keys, std::size_t n, F&& found) const {
+    if (old_cap) {
+        for (std::size_t i = 0; i < n; ++i)
+            found(i, counted_lookup(keys[i]));
+        return;
+    }
+
+    std::size_t buckets[batch_window];
+    for (std::size_t start = 0; start < n; start += batch_window) {
+        std::size_t m = n - start < batch_window ? n - start : batch_window;
+
+        for (std::size_t i = 0; i < m; ++i) {
+            buckets[i] = P::index(hash_function(keys[start + i]), cap);
+            simd::prefetch(&array[buckets[i]]);
+        }
+        for (std::size_t i = 0; i < m; ++i) {
+            const Bucket& b = array[buckets[i]];
+            if (!b.empty())
+                simd::prefetch(&b[0]);
+        }
+        for (std::size_t i = 0; i < m; ++i) {
+            const Bucket& b = array[buckets[i]];
+            const std::pair<K,V>* p {};
+            for (std::size_t j = 0; j < b.size(); ++j) {
+                if (b[j].first == keys[start + i]) {
+                    p = &b[j];
+                    break;
+                }
+            }
+            counters.record(p != nullptr);
+            found(start + i, p);
+        }
+    }
+}
+
+
+template <typename K, typename V, typename H, typename P, typename A>
+void Map<K,V,H,P,A>::find_batch(const K* keys, std::size_t n, V** out) {
+    migrate(drain_step());
+    p_find_batch(keys, n, [out](std::size_t i, const std::pair<K,V>* p) {
+        out[i] = p ? &const_cast<std::pair<K,V>*>(p)->second : nullptr;
+    });
+}
+
+
+template <typename K, typename V, typename H, typename P, typename A>
+void Map<K,V,H,P,A>::find_batch(const K* keys, std::size_t n, const V** out) const {
+    p_find_batch(keys, n, [out](std::size_t i, const std::pair<K,V>* p) {
+        out[i] = p ? &p->second : nullptr;
+    });
+}
+
+
+template <typename K, typename V, typename H, typename P, typename A>
+void Map<K,V,H,P,A>::contains_batch(const K* keys, std::size_t n, bool* out) const {
+    p_find_batch(keys, n, [out](std::size_t i, const std::pair<K,V>* p) {
+        out[i] = p != nullptr;
+    });
 }
 
 
-template <typename K, typename V, typename H>
-inline typename Map<K,V,H>::iterator Map<K,V,H>::begin() {
+template <typename K, typename V, typename H, typename P, typename A>
+Vector<V*> Map<K,V,H,P,A>::find_batch(const Vector<K>& keys) {
+    Vector<V*> out(keys.size(), nullptr);
+    if (!keys.empty())
+        find_batch(&keys[0], keys.size(), &out[0]);
+    return out;
+}
+
+
+template <typename K, typename V, typename H, typename P, typename A>
+Vector<bool> Map<K,V,H,P,A>::contains_batch(const Vector<K>& keys) const {
+    Vector<bool> out(keys.size(), false);
+    if (!keys.empty())
+        contains_batch(&keys[0], keys.size(), &out[0]);
+    return out;
+}
+
+
+template <typename K, typename V, typename H, typename P, typename A>
+inline typename Map<K,V,H,P,A>::iterator Map<K,V,H,P,A>::begin() {
     return iterator{this};
 }
    
     
-template <typename K, typename V, typename H>
-inline typename Map<K,V,H>::iterator Map<K,V,H>::end() {
-    return iterator{this, cap-1, array[cap-1].end()};
+template <typename K, typename V, typename H, typename P, typename A>
+inline typename Map<K,V,H,P,A>::iterator Map<K,V,H,P,A>::end() {
+    return iterator{this, bucket_count()-1, bucket(bucket_count()-1).end()};
 }
 
 
-template <typename K, typename V, typename H>
-inline typename Map<K,V,H>::const_iterator Map<K,V,H>::cbegin() const {
+template <typename K, typename V, typename H, typename P, typename A>
+inline typename Map<K,V,H,P,A>::const_iterator Map<K,V,H,P,A>::cbegin() const {
     return const_iterator{this};
 }
 
 
-template <typename K, typename V, typename H>
-inline typename Map<K,V,H>::const_iterator Map<K,V,H>::cend() const {
-    return const_iterator{this, cap-1, array[cap-1].cend()};
+template <typename K, typename V, typename H, typename P, typename A>
+inline typename Map<K,V,H,P,A>::const_iterator Map<K,V,H,P,A>::cend() const {
+    return const_iterator{this, bucket_count()-1, bucket(bucket_count()-1).cend()};
 }
 
 
-template <typename K, typename V, typename H>
+template <typename K, typename V, typename H, typename P, typename A>
 class Map_Iterator {
 private:
-    using vec_iter = typename Vector<std::pair<K,V>>::iterator;
+    using vec_iter = typename Map<K,V,H,P,A>::Bucket::iterator;
 
-    Map<K,V,H>* map;
+    Map<K,V,H,P,A>* map;
     std::size_t out_pos;    // used to iterate through the outer Vector
     vec_iter in_iter;       // used to iterate through the inner Vector 
-    std::pair<K,V> p;
 
     // Helping function
     void shift() {
         while (true) {
-            if (++in_iter != map->array[out_pos].end())
+            if (++in_iter != map->bucket(out_pos).end())
                 return;
 
             bool flag = false;
-            while (++out_pos < map->cap) {
-                if (map->array[out_pos].size()) {
-                    in_iter = map->array[out_pos].begin();
+            while (++out_pos < map->bucket_count()) {
+                if (map->bucket(out_pos).size()) {
+                    in_iter = map->bucket(out_pos).begin();
                     flag = true;
                     return;
                 }
@@ -346,8 +1107,8 @@ private:
             if (!flag) break;
         }
 
-        out_pos = map->cap - 1;
-        in_iter = map->array[out_pos].end();
+        out_pos = map->bucket_count() - 1;
+        in_iter = map->bucket(out_pos).end();
     }
 
 public:
@@ -359,12 +1120,12 @@ public:
 
     Map_Iterator() : map{} {}
 
-    Map_Iterator(Map<K,V,H>* in_map) 
+    Map_Iterator(Map<K,V,H,P,A>* in_map) 
         : map{in_map}
     {
         bool flag = false;
-        for (unsigned i = 0; i < map->cap; ++i) {
-            if (map->array[i].size()) {
+        for (std::size_t i = 0; i < map->bucket_count(); ++i) {
+            if (map->bucket(i).size()) {
                 out_pos = i;
                 flag = true;
                 break;
@@ -372,27 +1133,21 @@ public:
         }
 
         if (flag)
-            in_iter = map->array[out_pos].begin();
+            in_iter = map->bucket(out_pos).begin();
         else {
-            out_pos = map->cap - 1;
-            in_iter  = map->array[out_pos].end();
+            out_pos = map->bucket_count() - 1;
+            in_iter  = map->bucket(out_pos).end();
         }
     }
 
-    Map_Iterator(Map<K,V,H>* in_map, std::size_t in_out_pos, vec_iter in_in_iter)
+    Map_Iterator(Map<K,V,H,P,A>* in_map, std::size_t in_out_pos, vec_iter in_in_iter)
         : map{in_map}, out_pos{in_out_pos}, in_iter{in_in_iter} {}
     
-    reference operator*() {
-        p.first  = in_iter->first;
-        p.second = in_iter->second;
-        return p;
-    }
+    // Both hand out the pair stored in the bucket, so writes through the iterator update the map.
+    // The key must not be changed, since the pair would then sit in the wrong bucket.
+    reference operator*() const { return *in_iter; }
 
-    pointer operator->() {
-        p.first  = in_iter->first;
-        p.second = in_iter->second;
-        return &p;
-    }        
+    pointer operator->()  const { return &*in_iter; }
 
     Map_Iterator& operator++() {
         shift();
@@ -415,26 +1170,25 @@ public:
 };
 
 
-template <typename K, typename V, typename H>
+template <typename K, typename V, typename H, typename P, typename A>
 class Const_Map_Iterator {
 private:
-    using vec_iter = typename Vector<std::pair<K,V>>::const_iterator;
+    using vec_iter = typename Map<K,V,H,P,A>::Bucket::const_iterator;
 
-    const Map<K,V,H>* map;
+    const Map<K,V,H,P,A>* map;
     std::size_t out_pos;
     vec_iter in_iter;
-    std::pair<K,V> p;
 
     // Helping function
     void shift() {
         while (true) {
-            if (++in_iter != map->array[out_pos].cend())
+            if (++in_iter != map->bucket(out_pos).cend())
                 return;
 
             bool flag = false;
-            while (++out_pos < map->cap) {
-                if (map->array[out_pos].size()) {
-                    in_iter = map->array[out_pos].cbegin();
+            while (++out_pos < map->bucket_count()) {
+                if (map->bucket(out_pos).size()) {
+                    in_iter = map->bucket(out_pos).cbegin();
                     flag = true;
                     return;
                 }
@@ -443,8 +1197,8 @@ private:
             if (!flag) break;
         }
 
-        out_pos = map->cap - 1;
-        in_iter = map->array[out_pos].cend();
+        out_pos = map->bucket_count() - 1;
+        in_iter = map->bucket(out_pos).cend();
     }
 
 public:
@@ -456,12 +1210,12 @@ public:
 
     Const_Map_Iterator() : map{} {}
 
-    Const_Map_Iterator(const Map<K,V,H>* in_map) 
+    Const_Map_Iterator(const Map<K,V,H,P,A>* in_map) 
         : map{in_map}
     {
         bool flag = false;
-        for (unsigned i = 0; i < map->cap; ++i) {
-            if (map->array[i].size()) {
+        for (std::size_t i = 0; i < map->bucket_count(); ++i) {
+            if (map->bucket(i).size()) {
                 out_pos = i;
                 flag = true;
                 break;
@@ -469,27 +1223,19 @@ public:
         }
 
         if (flag)
-            in_iter = map->array[out_pos].cbegin();
+            in_iter = map->bucket(out_pos).cbegin();
         else {
-            out_pos = map->cap - 1;
-            in_iter  = map->array[out_pos].cend();
+            out_pos = map->bucket_count() - 1;
+            in_iter  = map->bucket(out_pos).cend();
         }
     }
 
-    Const_Map_Iterator(const Map<K,V,H>* in_map, std::size_t in_out_pos, vec_iter in_in_iter)
+    Const_Map_Iterator(const Map<K,V,H,P,A>* in_map, std::size_t in_out_pos, vec_iter in_in_iter)
         : map{in_map}, out_pos{in_out_pos}, in_iter{in_in_iter} {}
     
-    reference operator*() {
-        p.first  = in_iter->first;
-        p.second = in_iter->second;
-        return p;
-    }
+    reference operator*() const { return *in_iter; }
 
-    pointer operator->() {
-        p.first  = in_iter->first;
-        p.second = in_iter->second;
-        return &p;
-    }        
+    pointer operator->()  const { return &*in_iter; }
 
     Const_Map_Iterator& operator++() {
         shift();
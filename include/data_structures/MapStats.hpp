@@ -0,0 +1,80 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include "Vector.hpp"
+
+#ifdef DATA_STRUCTURES_MAP_COUNTERS
+#include <atomic>
+#endif
+
+namespace data_structures {
+
+// Snapshot of the shape of a hash map, as returned by stats().
+// For chained maps (Map) histogram[n] is the number of buckets holding n elements and
+// max_length the longest chain. For open addressing (FlatMap) histogram[n] is the number of
+// elements that a lookup finds in the n-th group it probes, and max_length the longest probe.
+// A long tail in the histogram at a low load factor usually means a poor hash function.
+struct MapStats {
+    std::size_t size {};
+    std::size_t buckets {};
+    double load_factor {};
+    Vector<std::size_t> histogram;
+    std::size_t max_length {};
+    std::size_t rehashes {};
+    std::chrono::nanoseconds rehash_time {};
+    std::size_t bytes_allocated {};
+
+    // Lookups through find/contains/count/operator[]; only counted when the library is
+    // compiled with DATA_STRUCTURES_MAP_COUNTERS defined, zero otherwise
+    std::size_t hits {};
+    std::size_t misses {};
+};
+
+
+// Adds the time between its construction and destruction to total
+class ScopedTimer {
+public:
+    explicit ScopedTimer(std::chrono::nanoseconds& in_total)
+        : total{in_total}, start{std::chrono::steady_clock::now()} {}
+    ScopedTimer(const ScopedTimer&) = delete;
+    ScopedTimer& operator=(const ScopedTimer&) = delete;
+    ~ScopedTimer() { total += std::chrono::steady_clock::now() - start; }
+
+private:
+    std::chrono::nanoseconds& total;
+    std::chrono::steady_clock::time_point start;
+};
+
+
+// Hit and miss counters of a map's lookups. Without DATA_STRUCTURES_MAP_COUNTERS the class is
+// empty and record() compiles to nothing. The counters are atomic because lookups may run
+// concurrently (e.g. under the shared lock of a ConcurrentMap shard). A copy starts from zero.
+class LookupCounters {
+public:
+#ifdef DATA_STRUCTURES_MAP_COUNTERS
+    LookupCounters() = default;
+    LookupCounters(const LookupCounters&) {}
+    LookupCounters& operator=(const LookupCounters&) { return *this; }
+
+    void record(bool hit) const { (hit ? hit_count : miss_count).fetch_add(1, std::memory_order_relaxed); }
+    std::size_t hits()    const { return hit_count.load(std::memory_order_relaxed);  }
+    std::size_t misses()  const { return miss_count.load(std::memory_order_relaxed); }
+
+    void swap(LookupCounters& rhs) noexcept {
+        hit_count.store(rhs.hit_count.exchange(hit_count.load()));
+        miss_count.store(rhs.miss_count.exchange(miss_count.load()));
+    }
+
+private:
+    mutable std::atomic<std::size_t> hit_count {};
+    mutable std::atomic<std::size_t> miss_count {};
+#else
+    void record(bool) const {}
+    std::size_t hits()   const { return 0; }
+    std::size_t misses() const { return 0; }
+    void swap(LookupCounters&) noexcept {}
+#endif
+};
+
+}
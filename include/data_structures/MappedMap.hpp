@@ -0,0 +1,338 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "Map.hpp"
+
+namespace data_structures {
+
+// On-disk snapshot of a hash map, meant to be mmap()ed and searched in place.
+// It has a header, the bucket offsets and then every entry sorted by bucket:
+// the entries of bucket b are entries[offsets[b]] .. entries[offsets[b + 1] - 1].
+// Only offsets are stored, no pointers, so the file can be mapped at any address.
+// Keys and values are written byte for byte, so both must be trivially copyable, and the
+// process that reads a snapshot must hash keys the same way as the one that wrote it.
+// The header records the size policy and the hash of the first stored key, so a snapshot
+// opened with a different policy or hash function (or hash seed) is rejected.
+struct SnapshotHeader {
+    char magic[8];
+    std::uint64_t key_size;
+    std::uint64_t value_size;
+    std::uint64_t entry_size;
+    std::uint64_t size;
+    std::uint64_t buckets;
+    std::uint64_t policy;
+    std::uint64_t hash_check;  // hash of the first entry's key, 0 if there are no entries
+};
+
+template <typename K, typename V>
+struct SnapshotEntry {
+    K key;
+    V value;
+};
+
+namespace snapshot {
+
+constexpr char magic[8] = {'D', 'S', 'M', 'A', 'P', '0', '0', '2'};
+constexpr std::size_t entries_alignment {64};
+
+inline std::uint64_t offsets_offset() { return sizeof(SnapshotHeader); }
+
+inline std::uint64_t entries_offset(std::uint64_t buckets) {
+    std::uint64_t end = offsets_offset() + (buckets + 1) * sizeof(std::uint64_t);
+    return (end + entries_alignment - 1) / entries_alignment * entries_alignment;
+}
+
+// Both set out and return false if the result does not fit in 64 bits
+inline bool checked_add(std::uint64_t a, std::uint64_t b, std::uint64_t& out) {
+    out = a + b;
+    return out >= a;
+}
+
+inline bool checked_mul(std::uint64_t a, std::uint64_t b, std::uint64_t& out) {
+    out = a * b;
+    return a == 0 || out / a == b;
+}
+
+// Whether the offsets and entries that header describes fit in a file of file_size bytes.
+// The header may come from a truncated or corrupt file, so no step is allowed to overflow.
+inline bool fits(const SnapshotHeader& header, std::uint64_t file_size) {
+    std::uint64_t count, offsets_bytes, end, entries_bytes;
+    if (!checked_add(header.buckets, 1, count)
+     || !checked_mul(count, sizeof(std::uint64_t), offsets_bytes)
+     || !checked_add(offsets_offset(), offsets_bytes, end)
+     || !checked_add(end, entries_alignment - 1, end))
+        return false;
+    end = end / entries_alignment * entries_alignment;  // entries_offset(header.buckets)
+    return checked_mul(header.size, header.entry_size, entries_bytes)
+        && checked_add(end, entries_bytes, end)
+        && end <= file_size;
+}
+
+// A bucket's offsets must not decrease or go past size, or a lookup would read past the entries.
+// Only the bucket being looked up is checked, so a huge file never has all its offsets read in.
+inline bool valid_bucket(const std::uint64_t* offsets, std::uint64_t b, std::uint64_t size) {
+    return offsets[b] <= offsets[b + 1] && offsets[b + 1] <= size;
+}
+
+// Orders the entries by bucket with a counting sort and writes the file. The data goes to a
+// temporary file that is then renamed over path, so a reader that still maps the old file
+// (even this process, when it saves over the snapshot it opened) keeps seeing it intact.
+template <typename K, typename V, typename H, typename P>
+void write(const std::string& path, const Vector<SnapshotEntry<K,V>>& entries, const H& hash_function) {
+    static_assert(std::is_trivially_copyable_v<K> && std::is_trivially_copyable_v<V>,
+                  "snapshots store keys and values byte for byte");
+
+    std::uint64_t buckets = P::next_size(entries.size() + 1);
+    Vector<std::uint64_t> offsets(buckets + 1, 0);
+    Vector<std::uint64_t> bucket_of(entries.size(), 0);
+    for (std::size_t i = 0; i < entries.size(); ++i) {
+        bucket_of[i] = P::index(hash_function(entries[i].key), buckets);
+        ++offsets[bucket_of[i] + 1];
+    }
+    for (std::uint64_t b = 0; b < buckets; ++b)
+        offsets[b + 1] += offsets[b];
+
+    Vector<std::uint64_t> next(offsets);
+    Vector<std::uint64_t> order(entries.size(), 0);
+    for (std::size_t i = 0; i < entries.size(); ++i)
+        order[next[bucket_of[i]]++] = i;
+
+    SnapshotHeader header {};
+    std::memcpy(header.magic, magic, sizeof(magic));
+    header.key_size = sizeof(K);
+    header.value_size = sizeof(V);
+    header.entry_size = sizeof(SnapshotEntry<K,V>);
+    header.size = entries.size();
+    header.buckets = buckets;
+    header.policy = P::id;
+    header.hash_check = order.empty() ? 0 : hash_function(entries[order[0]].key);
+
+    std::string tmp_path = path + ".tmp";
+    std::ofstream out{tmp_path, std::ios::binary | std::ios::trunc};
+    if (!out)
+        throw std::runtime_error("cannot open snapshot file");
+
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    out.write(reinterpret_cast<const char*>(&offsets[0]), (buckets + 1) * sizeof(std::uint64_t));
+    std::uint64_t padding = entries_offset(buckets) - offsets_offset() - (buckets + 1) * sizeof(std::uint64_t);
+    const char zeros[entries_alignment] {};
+    out.write(zeros, padding);
+    for (std::size_t i = 0; i < order.size(); ++i)
+        out.write(reinterpret_cast<const char*>(&entries[order[i]]), sizeof(SnapshotEntry<K,V>));
+
+    out.close();
+    if (!out || std::rename(tmp_path.c_str(), path.c_str()) != 0) {
+        std::remove(tmp_path.c_str());
+        throw std::runtime_error("cannot write snapshot file");
+    }
+}
+
+}
+
+
+// Writes the contents of map to a snapshot file that MappedMap can open
+template <typename K, typename V, typename H, typename P, typename A>
+void save_snapshot(const Map<K,V,H,P,A>& map, const std::string& path) {
+    Vector<SnapshotEntry<K,V>> entries;
+    entries.reserve(map.size());
+    for (auto iter = map.cbegin(); iter != map.cend(); ++iter)
+        entries.push_back(SnapshotEntry<K,V>{iter->first, iter->second});
+    snapshot::write<K,V,H,P>(path, entries, map.get_hasher());
+}
+
+
+// A map opened from a snapshot file. The file is mapped read-only and searched in place,
+// so opening it costs the mmap() call and a few checks of the header; the pages of the offsets
+// and the entries are read in as lookups touch them, and each bucket's offsets are validated then.
+// Changes do not touch the file: they go into an in-memory overlay that is searched first
+// and holds the new values as well as the keys removed from the snapshot.
+// save() writes the snapshot and the overlay together into a new file.
+template <typename K, typename V, typename H = std::hash<K>, typename P = PrimeSizePolicy>
+class MappedMap {
+public:
+    explicit MappedMap(const std::string& path, H in_hash = H());
+    MappedMap(const MappedMap&) = delete;
+    MappedMap& operator=(const MappedMap&) = delete;
+    MappedMap(MappedMap&& map) noexcept;
+    ~MappedMap();
+
+    // Returns a pointer to the value of key (into the mapping or the overlay) or nullptr if it is missing.
+    // Throws std::runtime_error if the offsets of the bucket key falls in are corrupt.
+    const V* find(const K& key) const;
+    bool contains(const K& key) const { return find(key) != nullptr; }
+
+    void insert(const K& key, const V& value);
+    bool remove(const K& key);
+
+    std::size_t size() const { return sz;      }
+    bool empty()       const { return sz == 0; }
+    bool modified()    const { return !overlay.empty(); }
+
+    void save(const std::string& path) const;
+
+    void swap(MappedMap& rhs) noexcept;
+
+private:
+    using Entry = SnapshotEntry<K,V>;
+
+    void* mapping {};
+    std::size_t mapping_size {};
+    const SnapshotHeader* header {};
+    const std::uint64_t* offsets {};
+    const Entry* entries {};
+
+    std::size_t sz {};
+    H hash_function;
+    Map<K, std::optional<V>, H> overlay;  // nullopt marks a key removed from the snapshot
+
+    const V* find_in_snapshot(const K& key) const;
+};
+
+
+template <typename K, typename V, typename H, typename P>
+MappedMap<K,V,H,P>::MappedMap(const std::string& path, H in_hash)
+    : hash_function{in_hash}, overlay{in_hash}
+{
+    static_assert(std::is_trivially_copyable_v<K> && std::is_trivially_copyable_v<V>,
+                  "snapshots store keys and values byte for byte");
+
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+        throw std::runtime_error("cannot open snapshot file");
+
+    struct stat st {};
+    if (::fstat(fd, &st) != 0 || static_cast<std::size_t>(st.st_size) < sizeof(SnapshotHeader)) {
+        ::close(fd);
+        throw std::runtime_error("invalid snapshot file");
+    }
+
+    mapping_size = static_cast<std::size_t>(st.st_size);
+    mapping = ::mmap(nullptr, mapping_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);  // the mapping keeps the file alive
+    if (mapping == MAP_FAILED) {
+        mapping = nullptr;
+        throw std::runtime_error("cannot map snapshot file");
+    }
+
+    const char* base = static_cast<const char*>(mapping);
+    header = reinterpret_cast<const SnapshotHeader*>(base);
+    bool valid = std::memcmp(header->magic, snapshot::magic, sizeof(snapshot::magic)) == 0
+              && header->key_size == sizeof(K) && header->value_size == sizeof(V)
+              && header->entry_size == sizeof(Entry) && header->policy == P::id
+              && header->buckets > 0 && P::next_size(header->buckets) == header->buckets
+              && snapshot::fits(*header, mapping_size);
+    if (valid) {
+        offsets = reinterpret_cast<const std::uint64_t*>(base + snapshot::offsets_offset());
+        entries = reinterpret_cast<const Entry*>(base + snapshot::entries_offset(header->buckets));
+        valid = offsets[0] == 0 && offsets[header->buckets] == header->size
+             && (header->size == 0 || hash_function(entries[0].key) == header->hash_check);
+    }
+    if (!valid) {
+        ::munmap(mapping, mapping_size);
+        throw std::runtime_error("invalid snapshot file");
+    }
+    sz = header->size;
+}
+
+
+template <typename K, typename V, typename H, typename P>
+MappedMap<K,V,H,P>::MappedMap(MappedMap&& map) noexcept
+    : hash_function{map.hash_function}
+{
+    map.swap(*this);
+}
+
+
+template <typename K, typename V, typename H, typename P>
+MappedMap<K,V,H,P>::~MappedMap() {
+    if (mapping)
+        ::munmap(mapping, mapping_size);
+}
+
+
+template <typename K, typename V, typename H, typename P>
+void MappedMap<K,V,H,P>::swap(MappedMap& rhs) noexcept {
+    std::swap(mapping, rhs.mapping);
+    std::swap(mapping_size, rhs.mapping_size);
+    std::swap(header, rhs.header);
+    std::swap(offsets, rhs.offsets);
+    std::swap(entries, rhs.entries);
+    std::swap(sz, rhs.sz);
+    std::swap(hash_function, rhs.hash_function);
+    overlay.swap(rhs.overlay);
+}
+
+
+template <typename K, typename V, typename H, typename P>
+const V* MappedMap<K,V,H,P>::find_in_snapshot(const K& key) const {
+    if (!header)
+        return nullptr;
+    std::uint64_t b = P::index(hash_function(key), header->buckets);
+    if (!snapshot::valid_bucket(offsets, b, header->size))
+        throw std::runtime_error("invalid snapshot file");
+    for (std::uint64_t i = offsets[b]; i < offsets[b + 1]; ++i)
+        if (entries[i].key == key)
+            return &entries[i].value;
+    return nullptr;
+}
+
+
+template <typename K, typename V, typename H, typename P>
+const V* MappedMap<K,V,H,P>::find(const K& key) const {
+    auto iter = overlay.find(key);
+    if (iter != overlay.cend())
+        return iter->second ? &*iter->second : nullptr;
+    return find_in_snapshot(key);
+}
+
+
+template <typename K, typename V, typename H, typename P>
+void MappedMap<K,V,H,P>::insert(const K& key, const V& value) {
+    if (!contains(key))
+        ++sz;
+    overlay.insert_or_assign(key, std::optional<V>{value});
+}
+
+
+// A key that is only in the overlay is dropped from it, one from the snapshot gets a tombstone
+template <typename K, typename V, typename H, typename P>
+bool MappedMap<K,V,H,P>::remove(const K& key) {
+    if (!contains(key))
+        return false;
+    if (find_in_snapshot(key))
+        overlay.insert_or_assign(key, std::optional<V>{});
+    else
+        overlay.remove(key);
+    --sz;
+    return true;
+}
+
+
+template <typename K, typename V, typename H, typename P>
+void MappedMap<K,V,H,P>::save(const std::string& path) const {
+    Vector<SnapshotEntry<K,V>> current;
+    current.reserve(sz);
+    if (header)
+        for (std::uint64_t i = 0; i < header->size; ++i)
+            if (!overlay.contains(entries[i].key))
+                current.push_back(entries[i]);
+    for (auto iter = overlay.cbegin(); iter != overlay.cend(); ++iter)
+        if (iter->second)
+            current.push_back(Entry{iter->first, *iter->second});
+    snapshot::write<K,V,H,P>(path, current, hash_function);
+}
+
+}
@@ -0,0 +1,133 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <utility>
+#include "Allocator.hpp"
+#include "Vector.hpp"
+
+namespace data_structures {
+
+// Allocator for fixed size nodes. Memory is taken from the system in slabs of many nodes
+// and a destroyed node goes onto a free list, from which the next create() takes it again.
+// A container that keeps inserting and removing elements therefore stops calling
+// its allocator once its pool has grown to the peak number of live nodes.
+// Slabs are only released by the destructor, so a node's address never changes.
+// The slabs come from A rebound to the slot type (see Allocator.hpp).
+template <typename T, typename A = std::allocator<T>>
+class NodePool {
+public:
+    NodePool() = default;
+    explicit NodePool(const A& in_alloc) : alloc{in_alloc}, slabs(in_alloc) {}
+    NodePool(const NodePool&) = delete;
+    NodePool& operator=(const NodePool&) = delete;
+    NodePool(NodePool&& pool) noexcept : alloc{pool.alloc}, slabs(pool.slabs.get_allocator()) { pool.swap(*this); }
+    ~NodePool();
+
+    A get_allocator() const { return alloc; }
+
+    // Constructs a T from args in a free node
+    template <typename... Args>
+    T* create(Args&&... args);
+
+    // Destroys the T and puts its node back on the free list
+    void destroy(T* p) noexcept;
+
+    void swap(NodePool& rhs) noexcept;
+
+private:
+    union Slot {
+        Slot* next;
+        alignas(T) unsigned char storage[sizeof(T)];
+    };
+
+    // Slabs double in size, from min_slab nodes up to max_slab
+    static constexpr std::size_t min_slab {32};
+    static constexpr std::size_t max_slab {4096};
+
+    using slab_allocator = rebind_alloc_t<A, Slot>;
+
+    DATA_STRUCTURES_NO_UNIQUE_ADDRESS A alloc;
+    Slot* free_list {};
+    Vector<Slot*, rebind_alloc_t<A, Slot*>> slabs;
+    std::size_t slab_size {min_slab};
+
+    void grow();
+};
+
+
+// Every node must have been destroyed before the pool is
+template <typename T, typename A>
+NodePool<T,A>::~NodePool() {
+    slab_allocator slab_alloc(alloc);
+    std::size_t size {min_slab};
+    for (std::size_t i = 0; i < slabs.size(); ++i) {
+        std::allocator_traits<slab_allocator>::deallocate(slab_alloc, slabs[i], size);
+        if (size < max_slab)
+            size *= 2;
+    }
+}
+
+
+template <typename T, typename A>
+void NodePool<T,A>::swap(NodePool& rhs) noexcept {
+    swap_allocators(alloc, rhs.alloc);
+    std::swap(free_list, rhs.free_list);
+    slabs.swap(rhs.slabs);
+    std::swap(slab_size, rhs.slab_size);
+}
+
+
+template <typename T, typename A>
+void NodePool<T,A>::grow() {
+    slab_allocator slab_alloc(alloc);
+    Slot* slab = std::allocator_traits<slab_allocator>::allocate(slab_alloc, slab_size);
+    try {
+        slabs.push_back(slab);
+    }
+    catch (...) {
+        std::allocator_traits<slab_allocator>::deallocate(slab_alloc, slab, slab_size);
+        throw;
+    }
+
+    for (std::size_t i = slab_size; i > 0; --i) {
+        slab[i - 1].next = free_list;
+        free_list = &slab[i - 1];
+    }
+
+    if (slab_size < max_slab)
+        slab_size *= 2;
+}
+
+
+template <typename T, typename A>
+template <typename... Args>
+T* NodePool<T,A>::create(Args&&... args) {
+    if (!free_list)
+        grow();
+
+    Slot* slot = free_list;
+    free_list = slot->next;
+    try {
+        T* p = reinterpret_cast<T*>(slot->storage);
+        std::allocator_traits<A>::construct(alloc, p, std::forward<Args>(args)...);
+        return p;
+    }
+    catch (...) {
+        slot->next = free_list;
+        free_list = slot;
+        throw;
+    }
+}
+
+
+template <typename T, typename A>
+void NodePool<T,A>::destroy(T* p) noexcept {
+    std::allocator_traits<A>::destroy(alloc, p);
+    Slot* slot = reinterpret_cast<Slot*>(p);
+    slot->next = free_list;
+    free_list = slot;
+}
+
+}
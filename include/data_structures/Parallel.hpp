@@ -0,0 +1,28 @@
+#pragma once
+
+#include <cstddef>
+#include <thread>
+
+namespace data_structures {
+
+namespace parallel {
+
+// Number of threads used when the caller does not ask for a specific number
+inline unsigned default_threads() {
+    unsigned n = std::thread::hardware_concurrency();
+    return n ? n : 1;
+}
+
+
+// The t-th of parts nearly equal slices of [0, n)
+inline std::size_t slice_begin(std::size_t n, unsigned parts, unsigned t) {
+    return n / parts * t + (t < n % parts ? t : n % parts);
+}
+
+inline std::size_t slice_end(std::size_t n, unsigned parts, unsigned t) {
+    return slice_begin(n, parts, t + 1);
+}
+
+}
+
+}
@@ -2,18 +2,24 @@
 
 #include "Vector.hpp"
 #include <functional>
+#include <memory>
 
 namespace data_structures {
 
-template <typename T, typename C = std::less<T>>  // Default version is a MaxPriorityQueue
+// Default version is a MaxPriorityQueue. A is the allocator of the underlying Vector.
+template <typename T, typename C = std::less<T>, typename A = std::allocator<T>>
 class PriorityQueue {
 public:
+    using allocator_type = A;
+
     PriorityQueue();
     explicit PriorityQueue(C in_comparator);
-    explicit PriorityQueue(Vector<T>& vec);
-    PriorityQueue(Vector<T>& vec, C in_comparator);
-    PriorityQueue(Vector<T>&& vec);
-    PriorityQueue(Vector<T>&& vec, C in_comparator);
+    explicit PriorityQueue(const A& alloc);
+    PriorityQueue(C in_comparator, const A& alloc);
+    explicit PriorityQueue(Vector<T,A>& vec);
+    PriorityQueue(Vector<T,A>& vec, C in_comparator);
+    PriorityQueue(Vector<T,A>&& vec);
+    PriorityQueue(Vector<T,A>&& vec, C in_comparator);
     explicit PriorityQueue(const std::initializer_list<T>& values);
     PriorityQueue(const std::initializer_list<T>& values, C in_comparator);
     PriorityQueue(const PriorityQueue& pq);
@@ -29,16 +35,18 @@ public:
     void swap(PriorityQueue& pq) noexcept;
 
     PriorityQueue&  operator=(const PriorityQueue& rhs);
-    PriorityQueue&  operator=(PriorityQueue&& rhs) noexcept;
+    PriorityQueue&  operator=(PriorityQueue&& rhs) noexcept(propagate_on_move_v<A> || always_equal_v<A>);
 
-    template <typename K, typename V>
-    friend bool operator==(const PriorityQueue<K,V>& lhs, const PriorityQueue<K,V>& rhs);
+    template <typename K, typename V, typename B>
+    friend bool operator==(const PriorityQueue<K,V,B>& lhs, const PriorityQueue<K,V,B>& rhs);
 
     std::size_t size() const { return sz;      }
     bool empty()       const { return sz == 0; }
 
+    A get_allocator() const { return data.get_allocator(); }
+
 private:
-    Vector<T> data;
+    Vector<T,A> data;
     C comparator;
     std::size_t sz;
 
@@ -50,8 +58,8 @@ private:
 
 
 // heapify_up - heapify_down restore the heap property after an insertion - removal
-template <typename T, typename C>
-void PriorityQueue<T,C>::heapify_up(std::size_t index) {
+template <typename T, typename C, typename A>
+void PriorityQueue<T,C,A>::heapify_up(std::size_t index) {
     if (index == 1)     // We reached the root
         return;
     int father = index / 2;
@@ -61,8 +69,8 @@ void PriorityQueue<T,C>::heapify_up(std::size_t index) {
     }
 }
 
-template <typename T, typename C>
-void PriorityQueue<T,C>::heapify_down(std::size_t index) {
+template <typename T, typename C, typename A>
+void PriorityQueue<T,C,A>::heapify_down(std::size_t index) {
     int left_child = 2 * index;
     int right_child = left_child + 1;
     if (left_child > sz)  // left_child is a leaf
@@ -78,8 +86,8 @@ void PriorityQueue<T,C>::heapify_down(std::size_t index) {
 
 
 // Restores the heap property in O(n)
-template <typename T, typename C>
-void PriorityQueue<T,C>::efficient_heapify() {
+template <typename T, typename C, typename A>
+void PriorityQueue<T,C,A>::efficient_heapify() {
     data.insert(data.begin(), T{});
     int node = sz / 2;
     while (node) {
@@ -90,101 +98,111 @@ void PriorityQueue<T,C>::efficient_heapify() {
 
 // We always use a dummy element at position 0 of the vector so the indexes arithmetic is simpler.
 // The dummy element does not affect the size of the pq.
-template <typename T, typename C>
-PriorityQueue<T,C>::PriorityQueue()
+template <typename T, typename C, typename A>
+PriorityQueue<T,C,A>::PriorityQueue()
     : data(1, T{}), comparator{C()}, sz{} {}
 
 
-template <typename T, typename C>
-PriorityQueue<T,C>::PriorityQueue(C in_comparator)
+template <typename T, typename C, typename A>
+PriorityQueue<T,C,A>::PriorityQueue(C in_comparator)
     : data(1, T{}), comparator{in_comparator}, sz{} {}    
 
 
-template <typename T, typename C>
-PriorityQueue<T,C>::PriorityQueue(Vector<T>& vec)
+template <typename T, typename C, typename A>
+PriorityQueue<T,C,A>::PriorityQueue(const A& alloc)
+    : data(1, T{}, alloc), comparator{C()}, sz{} {}
+
+
+template <typename T, typename C, typename A>
+PriorityQueue<T,C,A>::PriorityQueue(C in_comparator, const A& alloc)
+    : data(1, T{}, alloc), comparator{in_comparator}, sz{} {}
+
+
+template <typename T, typename C, typename A>
+PriorityQueue<T,C,A>::PriorityQueue(Vector<T,A>& vec)
     : data{vec}, comparator{C()}, sz{vec.size()}
 {   
     efficient_heapify();
 }
 
 
-template <typename T, typename C>
-PriorityQueue<T,C>::PriorityQueue(Vector<T>& vec, C in_comparator)
+template <typename T, typename C, typename A>
+PriorityQueue<T,C,A>::PriorityQueue(Vector<T,A>& vec, C in_comparator)
     : data{vec}, comparator{in_comparator}, sz{data.size()}
 {
     efficient_heapify();
 }
 
 
-template <typename T, typename C>
-PriorityQueue<T,C>::PriorityQueue(Vector<T>&& vec)
-    : data{std::forward<Vector<T>>(vec)}, comparator{C()}, sz{data.size()}
+template <typename T, typename C, typename A>
+PriorityQueue<T,C,A>::PriorityQueue(Vector<T,A>&& vec)
+    : data{std::forward<Vector<T,A>>(vec)}, comparator{C()}, sz{data.size()}
 {   
     efficient_heapify();
 }
 
 
-template <typename T, typename C>
-PriorityQueue<T,C>::PriorityQueue(Vector<T>&& vec, C in_comparator)
-    : data{std::forward<Vector<T>>(vec)}, comparator{in_comparator}, sz{data.size()}
+template <typename T, typename C, typename A>
+PriorityQueue<T,C,A>::PriorityQueue(Vector<T,A>&& vec, C in_comparator)
+    : data{std::forward<Vector<T,A>>(vec)}, comparator{in_comparator}, sz{data.size()}
 {   
     efficient_heapify();
 }
 
 
-template <typename T, typename C>
-PriorityQueue<T,C>::PriorityQueue(const std::initializer_list<T>& values)
+template <typename T, typename C, typename A>
+PriorityQueue<T,C,A>::PriorityQueue(const std::initializer_list<T>& values)
     : data{values}, comparator{C()}, sz{data.size()}
 {
     efficient_heapify();
 }
 
 
-template <typename T, typename C>
-PriorityQueue<T,C>::PriorityQueue(const std::initializer_list<T>& values, C in_comparator)
+template <typename T, typename C, typename A>
+PriorityQueue<T,C,A>::PriorityQueue(const std::initializer_list<T>& values, C in_comparator)
     : data{values}, comparator{in_comparator}, sz{data.size()}
 {
     efficient_heapify();
 }
 
 
-template <typename T, typename C>
-PriorityQueue<T,C>::PriorityQueue(const PriorityQueue<T,C>& pq) 
+template <typename T, typename C, typename A>
+PriorityQueue<T,C,A>::PriorityQueue(const PriorityQueue<T,C,A>& pq) 
     : data{pq.data}, comparator{pq.comparator}, sz{pq.sz} {}
 
 
-template <typename T, typename C>
-PriorityQueue<T,C>::PriorityQueue(PriorityQueue<T,C>&& pq) noexcept 
-    : data(1, T{}), comparator{C()}, sz{}
+template <typename T, typename C, typename A>
+PriorityQueue<T,C,A>::PriorityQueue(PriorityQueue<T,C,A>&& pq) noexcept 
+    : data(1, T{}, pq.data.get_allocator()), comparator{C()}, sz{}
 {
     pq.swap(*this);
 }
 
 
-template <typename T, typename C>
-void PriorityQueue<T,C>::insert(const T& value) {
+template <typename T, typename C, typename A>
+void PriorityQueue<T,C,A>::insert(const T& value) {
     data.push_back(value);
     heapify_up(++sz);
 }
 
 
-template <typename T, typename C>
-void PriorityQueue<T,C>::insert(T&& value) {
+template <typename T, typename C, typename A>
+void PriorityQueue<T,C,A>::insert(T&& value) {
     data.push_back(std::forward<T>(value));
     heapify_up(++sz);
 }
 
 
-template <typename T, typename C>
-T PriorityQueue<T,C>::top() {
+template <typename T, typename C, typename A>
+T PriorityQueue<T,C,A>::top() {
     if (!sz)
         throw std::runtime_error("pq is empty");
     return data[1];
 }    
 
 
-template <typename T, typename C>
-void PriorityQueue<T,C>::pop() {
+template <typename T, typename C, typename A>
+void PriorityQueue<T,C,A>::pop() {
     if (!sz)
         throw std::runtime_error("pq is empty");
     std::swap(data[1], data[sz--]);
@@ -193,45 +211,55 @@ void PriorityQueue<T,C>::pop() {
 }
 
 
-template <typename T, typename C>
-void PriorityQueue<T,C>::clear() {
+template <typename T, typename C, typename A>
+void PriorityQueue<T,C,A>::clear() {
     data.clear();
     sz = 0;
 }
 
 
-template <typename T, typename C>
-void PriorityQueue<T,C>::swap(PriorityQueue<T,C>& pq) noexcept {
+template <typename T, typename C, typename A>
+void PriorityQueue<T,C,A>::swap(PriorityQueue<T,C,A>& pq) noexcept {
     data.swap(pq.data);
     std::swap(comparator, pq.comparator);
     std::swap(sz, pq.sz);
 }
 
 
-template <typename T, typename C>
-void swap(PriorityQueue<T,C>& lhs, PriorityQueue<T,C>& rhs) {
+template <typename T, typename C, typename A>
+void swap(PriorityQueue<T,C,A>& lhs, PriorityQueue<T,C,A>& rhs) {
     lhs.swap(rhs);
 }
 
 
-// Because self assignment happens so rarely we don't check that this != &rhs
-template <typename T, typename C>
-PriorityQueue<T,C>& PriorityQueue<T,C>::operator=(const PriorityQueue<T,C>& rhs)  {
-    PriorityQueue<T,C> temp{rhs};    // Exceptions may occur at this state so we create a temp pq and then swap it with *this
-    temp.swap(*this);    
+// Because self assignment happens so rarely we don't check that this != &rhs.
+// The Vector assignment copies into a temp vector first, so an exception leaves *this as it was,
+// and it keeps the allocator of *this unless the allocator propagates on copy assignment.
+template <typename T, typename C, typename A>
+PriorityQueue<T,C,A>& PriorityQueue<T,C,A>::operator=(const PriorityQueue<T,C,A>& rhs)  {
+    data = rhs.data;
+    comparator = rhs.comparator;
+    sz = rhs.sz;
     return *this;    
 }
 
 
-template <typename T, typename C>
-PriorityQueue<T,C>& PriorityQueue<T,C>::operator=(PriorityQueue<T,C>&& rhs) noexcept {
-    rhs.swap(*this);
+// The Vector move assignment takes the buffer of rhs only if the allocators allow it and moves
+// the elements into memory of our own allocator otherwise, so no buffer changes allocators.
+template <typename T, typename C, typename A>
+PriorityQueue<T,C,A>& PriorityQueue<T,C,A>::operator=(PriorityQueue<T,C,A>&& rhs)
+    noexcept(propagate_on_move_v<A> || always_equal_v<A>)
+{
+    data = std::move(rhs.data);
+    comparator = std::move(rhs.comparator);
+    sz = rhs.sz;
+    rhs.sz = 0;
     return *this;    
 }
 
 
-template <typename T, typename C>
-bool operator==(const PriorityQueue<T,C>& lhs, const PriorityQueue<T,C>& rhs) {
+template <typename T, typename C, typename A>
+bool operator==(const PriorityQueue<T,C,A>& lhs, const PriorityQueue<T,C,A>& rhs) {
     if (lhs.sz != rhs.sz)
         return false;
 
@@ -243,8 +271,8 @@ bool operator==(const PriorityQueue<T,C>& lhs, const PriorityQueue<T,C>& rhs) {
 }
 
 
-template <typename T, typename C>
-bool operator!=(const PriorityQueue<T,C>& lhs, const PriorityQueue<T,C>& rhs) {
+template <typename T, typename C, typename A>
+bool operator!=(const PriorityQueue<T,C,A>& lhs, const PriorityQueue<T,C,A>& rhs) {
     return !(lhs == rhs);
 }
 
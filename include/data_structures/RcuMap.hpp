@@ -0,0 +1,329 @@
+#pragma once
+
+#include "Vector.hpp"
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <optional>
+#include <thread>
+
+namespace data_structures {
+
+// Epoch based reclamation for data that readers traverse without taking locks.
+// A reader announces itself in one of two counters, picked by the parity of the global epoch.
+// To free memory a writer first unlinks it, then flips the epoch and waits until the counter of
+// the previous parity drains: every reader that could still see the unlinked memory is gone then.
+// The counters are striped over cache lines so that readers on different threads do not
+// bounce a shared line between them.
+class EpochDomain {
+public:
+    class ReadGuard {
+    public:
+        explicit ReadGuard(const EpochDomain& domain) : counter{domain.enter()} {}
+        ReadGuard(const ReadGuard&) = delete;
+        ReadGuard& operator=(const ReadGuard&) = delete;
+        ~ReadGuard() { counter->fetch_sub(1, std::memory_order_release); }
+    private:
+        std::atomic<std::size_t>* counter;
+    };
+
+    // Blocks until every reader that entered before the call has left
+    void synchronize() {
+        std::size_t e = epoch.load();
+        epoch.store(e + 1);
+        for (auto& s : stripes)
+            while (s.active[e & 1].load() != 0)
+                std::this_thread::yield();
+    }
+
+private:
+    static constexpr std::size_t no_stripes {64};  // thread_stripe() takes the top 6 bits
+
+    struct alignas(64) Stripe {
+        std::atomic<std::size_t> active[2] {};
+    };
+
+    mutable Stripe stripes[no_stripes];
+    std::atomic<std::size_t> epoch {};
+
+    // Thread ids usually hash to aligned addresses, so the stripe comes from the high bits of a multiplicative hash
+    static std::size_t thread_stripe() {
+        static thread_local std::size_t stripe = static_cast<std::size_t>(
+            (static_cast<std::uint64_t>(std::hash<std::thread::id>{}(std::this_thread::get_id())) * 0x9E3779B97F4A7C15ULL) >> 58);
+        return stripe;
+    }
+
+    // If the epoch moves between reading it and registering, the writer may already have
+    // checked our counter, so we back off and register again under the new epoch.
+    std::atomic<std::size_t>* enter() const {
+        Stripe& s = stripes[thread_stripe()];
+        while (true) {
+            std::size_t e = epoch.load();
+            s.active[e & 1].fetch_add(1);
+            if (epoch.load() == e)
+                return &s.active[e & 1];
+            s.active[e & 1].fetch_sub(1);
+        }
+    }
+};
+
+
+// A hash map for read-mostly data whose readers never block.
+// Nodes are immutable once published. Writers are serialized by a mutex and publish changes with
+// a single atomic store: a new key is pushed in front of its bucket's chain, while updating or
+// removing a key copies the part of the chain before it. A rehash builds a whole new table and
+// swaps the table pointer. Unlinked nodes and tables are freed after an epoch grace period.
+template <typename K, typename V, typename H = std::hash<K>>
+class RcuMap {
+public:
+    RcuMap();
+    explicit RcuMap(H in_hash);
+    RcuMap(const RcuMap&) = delete;
+    RcuMap& operator=(const RcuMap&) = delete;
+    ~RcuMap();
+
+    void insert(const K& key, const V& value);
+    bool remove(const K& key);
+    void clear();
+
+    std::optional<V> find(const K& key) const;
+    bool contains(const K& key) const;
+
+    // Calls fn(const V&) on the value of key without copying it and returns whether key was found
+    template <typename F>
+    bool visit(const K& key, F fn) const;
+
+    std::size_t size()     const { return sz.load(std::memory_order_relaxed); }
+    bool empty()           const { return size() == 0; }
+    std::size_t capacity() const;
+
+private:
+    struct Node {
+        std::pair<K,V> data;
+        Node* next;
+    };
+
+    struct Table {
+        std::size_t cap;
+        std::atomic<Node*>* buckets;
+
+        explicit Table(std::size_t in_cap) : cap{in_cap}, buckets{new std::atomic<Node*>[in_cap]} {
+            for (std::size_t i = 0; i < cap; ++i)
+                buckets[i].store(nullptr, std::memory_order_relaxed);
+        }
+        ~Table() { delete[] buckets; }
+    };
+
+    static constexpr std::size_t min_cap {64};
+    static constexpr double max_load_factor {1.0};
+    static constexpr std::size_t reclaim_threshold {64};  // retired nodes that trigger a grace period
+
+    std::atomic<Table*> table;
+    std::atomic<std::size_t> sz {};
+    H hash_function;
+
+    std::mutex write_mutex;
+    mutable EpochDomain domain;
+    Vector<Node*> retired_nodes;
+    Vector<Table*> retired_tables;
+
+    const Node* lookup(const K& key) const;
+    void replace(std::atomic<Node*>& head, Node* target, Node* replacement);
+    void rehash();
+    void reclaim(bool force);
+};
+
+
+template <typename K, typename V, typename H>
+RcuMap<K,V,H>::RcuMap()
+    : table{new Table{min_cap}}, hash_function{H()} {}
+
+
+template <typename K, typename V, typename H>
+RcuMap<K,V,H>::RcuMap(H in_hash)
+    : table{new Table{min_cap}}, hash_function{in_hash} {}
+
+
+// No reader may be active while the map is destroyed
+template <typename K, typename V, typename H>
+RcuMap<K,V,H>::~RcuMap() {
+    reclaim(true);
+    Table* t = table.load();
+    for (std::size_t i = 0; i < t->cap; ++i) {
+        Node* n = t->buckets[i].load();
+        while (n) {
+            Node* next = n->next;
+            delete n;
+            n = next;
+        }
+    }
+    delete t;
+}
+
+
+template <typename K, typename V, typename H>
+std::size_t RcuMap<K,V,H>::capacity() const {
+    EpochDomain::ReadGuard guard{domain};
+    return table.load(std::memory_order_acquire)->cap;
+}
+
+
+// Must be called inside a read-side critical section
+template <typename K, typename V, typename H>
+const typename RcuMap<K,V,H>::Node* RcuMap<K,V,H>::lookup(const K& key) const {
+    const Table* t = table.load(std::memory_order_acquire);
+    const Node* n = t->buckets[hash_function(key) % t->cap].load(std::memory_order_acquire);
+    for (; n; n = n->next)
+        if (n->data.first == key)
+            return n;
+    return nullptr;
+}
+
+
+template <typename K, typename V, typename H>
+std::optional<V> RcuMap<K,V,H>::find(const K& key) const {
+    EpochDomain::ReadGuard guard{domain};
+    const Node* n = lookup(key);
+    if (!n)
+        return std::nullopt;
+    return n->data.second;
+}
+
+
+template <typename K, typename V, typename H>
+bool RcuMap<K,V,H>::contains(const K& key) const {
+    EpochDomain::ReadGuard guard{domain};
+    return lookup(key) != nullptr;
+}
+
+
+template <typename K, typename V, typename H>
+template <typename F>
+bool RcuMap<K,V,H>::visit(const K& key, F fn) const {
+    EpochDomain::ReadGuard guard{domain};
+    const Node* n = lookup(key);
+    if (!n)
+        return false;
+    fn(n->data.second);
+    return true;
+}
+
+
+// Publishes a copy of the chain of head in which target is replaced by the chain starting at
+// replacement. Only the nodes in front of target are copied, the ones after it are shared.
+template <typename K, typename V, typename H>
+void RcuMap<K,V,H>::replace(std::atomic<Node*>& head, Node* target, Node* replacement) {
+    Vector<Node*> prefix;
+    for (Node* n = head.load(std::memory_order_relaxed); n != target; n = n->next)
+        prefix.push_back(n);
+
+    Node* new_head = replacement;
+    for (std::size_t i = prefix.size(); i > 0; --i)
+        new_head = new Node{prefix[i - 1]->data, new_head};
+    head.store(new_head, std::memory_order_release);
+
+    for (std::size_t i = 0; i < prefix.size(); ++i)
+        retired_nodes.push_back(prefix[i]);
+    retired_nodes.push_back(target);
+}
+
+
+template <typename K, typename V, typename H>
+void RcuMap<K,V,H>::insert(const K& key, const V& value) {
+    std::lock_guard<std::mutex> lock{write_mutex};
+
+    Table* t = table.load(std::memory_order_relaxed);
+    std::atomic<Node*>& head = t->buckets[hash_function(key) % t->cap];
+
+    Node* n = head.load(std::memory_order_relaxed);
+    while (n && !(n->data.first == key))
+        n = n->next;
+
+    if (n)
+        replace(head, n, new Node{std::make_pair(key, value), n->next});
+    else {
+        head.store(new Node{std::make_pair(key, value), head.load(std::memory_order_relaxed)}, std::memory_order_release);
+        sz.fetch_add(1, std::memory_order_relaxed);
+        if (static_cast<double>(size()) / t->cap >= max_load_factor)
+            rehash();
+    }
+    reclaim(false);
+}
+
+
+template <typename K, typename V, typename H>
+bool RcuMap<K,V,H>::remove(const K& key) {
+    std::lock_guard<std::mutex> lock{write_mutex};
+
+    Table* t = table.load(std::memory_order_relaxed);
+    std::atomic<Node*>& head = t->buckets[hash_function(key) % t->cap];
+
+    Node* n = head.load(std::memory_order_relaxed);
+    while (n && !(n->data.first == key))
+        n = n->next;
+    if (!n)
+        return false;
+
+    replace(head, n, n->next);
+    sz.fetch_sub(1, std::memory_order_relaxed);
+    reclaim(false);
+    return true;
+}
+
+
+template <typename K, typename V, typename H>
+void RcuMap<K,V,H>::clear() {
+    std::lock_guard<std::mutex> lock{write_mutex};
+
+    Table* old_table = table.load(std::memory_order_relaxed);
+    table.store(new Table{min_cap}, std::memory_order_release);
+    sz.store(0, std::memory_order_relaxed);
+
+    for (std::size_t i = 0; i < old_table->cap; ++i)
+        for (Node* n = old_table->buckets[i].load(std::memory_order_relaxed); n; n = n->next)
+            retired_nodes.push_back(n);
+    retired_tables.push_back(old_table);
+    reclaim(true);
+}
+
+
+// Readers may still be walking the old chains, so every node is copied into the new table
+// instead of being relinked.
+template <typename K, typename V, typename H>
+void RcuMap<K,V,H>::rehash() {
+    Table* old_table = table.load(std::memory_order_relaxed);
+    Table* new_table = new Table{old_table->cap * 2};
+
+    for (std::size_t i = 0; i < old_table->cap; ++i) {
+        for (Node* n = old_table->buckets[i].load(std::memory_order_relaxed); n; n = n->next) {
+            std::atomic<Node*>& head = new_table->buckets[hash_function(n->data.first) % new_table->cap];
+            head.store(new Node{n->data, head.load(std::memory_order_relaxed)}, std::memory_order_relaxed);
+            retired_nodes.push_back(n);
+        }
+    }
+    table.store(new_table, std::memory_order_release);
+    retired_tables.push_back(old_table);
+}
+
+
+// Frees retired memory after a grace period. Grace periods cost the writer a wait for
+// the readers, so unless forced we batch them until enough nodes have been retired.
+template <typename K, typename V, typename H>
+void RcuMap<K,V,H>::reclaim(bool force) {
+    if (retired_nodes.empty() && retired_tables.empty())
+        return;
+    if (!force && retired_tables.empty() && retired_nodes.size() < reclaim_threshold)
+        return;
+
+    domain.synchronize();
+
+    for (std::size_t i = 0; i < retired_nodes.size(); ++i)
+        delete retired_nodes[i];
+    for (std::size_t i = 0; i < retired_tables.size(); ++i)
+        delete retired_tables[i];
+    retired_nodes.clear();
+    retired_tables.clear();
+}
+
+}
@@ -0,0 +1,889 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <type_traits>
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define DATA_STRUCTURES_X86 1
+#include <immintrin.h>
+#endif
+
+// Some compilers (MSVC) do not support per-function target attributes,
+// so there we only get the instruction sets enabled for the whole translation unit.
+#if defined(DATA_STRUCTURES_X86) && (defined(__GNUC__) || defined(__clang__))
+#define DATA_STRUCTURES_TARGET_DISPATCH 1
+#define DATA_STRUCTURES_TARGET(isa) __attribute__((target(isa)))
+#endif
+
+namespace data_structures {
+namespace simd {
+
+// Instruction sets above the x86-64 baseline are detected once at startup.
+// Until then the flag reads false, so code running from static initializers safely takes the SSE2 path.
+inline bool detect_avx2() {
+#if defined(__AVX2__)
+    return true;
+#elif defined(DATA_STRUCTURES_TARGET_DISPATCH)
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2");
+#else
+    return false;
+#endif
+}
+
+inline const bool has_avx2 = detect_avx2();
+
+
+// Only the foundation (F) and byte and word (BW) parts of AVX-512 are used
+inline bool detect_avx512() {
+#if defined(__AVX512F__) && defined(__AVX512BW__)
+    return true;
+#elif defined(DATA_STRUCTURES_TARGET_DISPATCH)
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512bw");
+#else
+    return false;
+#endif
+}
+
+inline const bool has_avx512 = detect_avx512();
+
+
+/// Group matching: 32 control bytes in, one bit per byte out. ///
+
+inline std::uint32_t match_byte_scalar(const signed char* group, signed char b) {
+    std::uint32_t mask {};
+    for (std::size_t i = 0; i < 32; ++i)
+        if (group[i] == b)
+            mask |= std::uint32_t{1} << i;
+    return mask;
+}
+
+
+inline std::uint32_t match_negative_scalar(const signed char* group) {
+    std::uint32_t mask {};
+    for (std::size_t i = 0; i < 32; ++i)
+        if (group[i] < 0)
+            mask |= std::uint32_t{1} << i;
+    return mask;
+}
+
+
+/// Key matching: a block of 32 bytes of 4 or 8 byte integer keys in, one bit per key out. ///
+/// The keys are compared as raw bits, so the signedness of the key type does not matter. ///
+
+inline std::uint32_t match_key32_scalar(const void* keys, std::uint32_t key) {
+    std::uint32_t mask {};
+    for (std::size_t i = 0; i < 8; ++i) {
+        std::uint32_t k;
+        std::memcpy(&k, static_cast<const char*>(keys) + i * sizeof(k), sizeof(k));
+        if (k == key)
+            mask |= std::uint32_t{1} << i;
+    }
+    return mask;
+}
+
+
+inline std::uint32_t match_key64_scalar(const void* keys, std::uint64_t key) {
+    std::uint32_t mask {};
+    for (std::size_t i = 0; i < 4; ++i) {
+        std::uint64_t k;
+        std::memcpy(&k, static_cast<const char*>(keys) + i * sizeof(k), sizeof(k));
+        if (k == key)
+            mask |= std::uint32_t{1} << i;
+    }
+    return mask;
+}
+
+
+#if defined(DATA_STRUCTURES_X86)
+
+// SSE2 is part of x86-64, so it needs no dispatch. A group takes two 16 byte compares.
+inline std::uint32_t match_byte_sse2(const signed char* group, signed char b) {
+    const __m128i needle = _mm_set1_epi8(b);
+    const __m128i lo = _mm_loadu_si128(reinterpret_cast<const __m128i*>(group));
+    const __m128i hi = _mm_loadu_si128(reinterpret_cast<const __m128i*>(group + 16));
+    std::uint32_t lo_mask = static_cast<std::uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(lo, needle)));
+    std::uint32_t hi_mask = static_cast<std::uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(hi, needle)));
+    return lo_mask | (hi_mask << 16);
+}
+
+
+// movemask collects the sign bits directly
+inline std::uint32_t match_negative_sse2(const signed char* group) {
+    const __m128i lo = _mm_loadu_si128(reinterpret_cast<const __m128i*>(group));
+    const __m128i hi = _mm_loadu_si128(reinterpret_cast<const __m128i*>(group + 16));
+    return static_cast<std::uint32_t>(_mm_movemask_epi8(lo)) |
+           (static_cast<std::uint32_t>(_mm_movemask_epi8(hi)) << 16);
+}
+
+inline std::uint32_t match_key32_sse2(const void* keys, std::uint32_t key) {
+    const __m128i needle = _mm_set1_epi32(static_cast<int>(key));
+    const __m128i lo = _mm_loadu_si128(static_cast<const __m128i*>(keys));
+    const __m128i hi = _mm_loadu_si128(static_cast<const __m128i*>(keys) + 1);
+    std::uint32_t lo_mask = static_cast<std::uint32_t>(_mm_movemask_ps(_mm_castsi128_ps(_mm_cmpeq_epi32(lo, needle))));
+    std::uint32_t hi_mask = static_cast<std::uint32_t>(_mm_movemask_ps(_mm_castsi128_ps(_mm_cmpeq_epi32(hi, needle))));
+    return lo_mask | (hi_mask << 4);
+}
+
+
+// SSE2 has no 64 bit compare: a key matches if both of its 32 bit halves do
+inline std::uint32_t match_key64_sse2(const void* keys, std::uint64_t key) {
+    const __m128i needle = _mm_set1_epi64x(static_cast<long long>(key));
+    std::uint32_t mask {};
+    for (int i = 0; i < 2; ++i) {
+        __m128i eq = _mm_cmpeq_epi32(_mm_loadu_si128(static_cast<const __m128i*>(keys) + i), needle);
+        eq = _mm_and_si128(eq, _mm_shuffle_epi32(eq, _MM_SHUFFLE(2, 3, 0, 1)));
+        mask |= static_cast<std::uint32_t>(_mm_movemask_pd(_mm_castsi128_pd(eq))) << (2 * i);
+    }
+    return mask;
+}
+
+#define DATA_STRUCTURES_HAS_SSE2 1
+#endif
+
+
+#if defined(__AVX2__) || defined(DATA_STRUCTURES_TARGET_DISPATCH)
+
+#if defined(__AVX2__)
+#define DATA_STRUCTURES_AVX2
+#else
+#define DATA_STRUCTURES_AVX2 DATA_STRUCTURES_TARGET("avx2")
+#endif
+
+DATA_STRUCTURES_AVX2
+inline std::uint32_t match_byte_avx2(const signed char* group, signed char b) {
+    const __m256i ctrl = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(group));
+    return static_cast<std::uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(ctrl, _mm256_set1_epi8(b))));
+}
+
+
+DATA_STRUCTURES_AVX2
+inline std::uint32_t match_negative_avx2(const signed char* group) {
+    const __m256i ctrl = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(group));
+    return static_cast<std::uint32_t>(_mm256_movemask_epi8(ctrl));
+}
+
+DATA_STRUCTURES_AVX2
+inline std::uint32_t match_key32_avx2(const void* keys, std::uint32_t key) {
+    const __m256i block = _mm256_loadu_si256(static_cast<const __m256i*>(keys));
+    const __m256i eq = _mm256_cmpeq_epi32(block, _mm256_set1_epi32(static_cast<int>(key)));
+    return static_cast<std::uint32_t>(_mm256_movemask_ps(_mm256_castsi256_ps(eq)));
+}
+
+
+DATA_STRUCTURES_AVX2
+inline std::uint32_t match_key64_avx2(const void* keys, std::uint64_t key) {
+    const __m256i block = _mm256_loadu_si256(static_cast<const __m256i*>(keys));
+    const __m256i eq = _mm256_cmpeq_epi64(block, _mm256_set1_epi64x(static_cast<long long>(key)));
+    return static_cast<std::uint32_t>(_mm256_movemask_pd(_mm256_castsi256_pd(eq)));
+}
+
+#define DATA_STRUCTURES_HAS_AVX2 1
+#endif
+
+
+// Bit i of the result is set if group[i] == b
+inline std::uint32_t match_byte(const signed char* group, signed char b) {
+#if defined(__AVX2__)
+    return match_byte_avx2(group, b);
+#elif defined(DATA_STRUCTURES_HAS_AVX2)
+    return has_avx2 ? match_byte_avx2(group, b) : match_byte_sse2(group, b);
+#elif defined(DATA_STRUCTURES_HAS_SSE2)
+    return match_byte_sse2(group, b);
+#else
+    return match_byte_scalar(group, b);
+#endif
+}
+
+
+// Bit i of the result is set if group[i] < 0
+inline std::uint32_t match_negative(const signed char* group) {
+#if defined(__AVX2__)
+    return match_negative_avx2(group);
+#elif defined(DATA_STRUCTURES_HAS_AVX2)
+    return has_avx2 ? match_negative_avx2(group) : match_negative_sse2(group);
+#elif defined(DATA_STRUCTURES_HAS_SSE2)
+    return match_negative_sse2(group);
+#else
+    return match_negative_scalar(group);
+#endif
+}
+
+
+// Bit i of the result is set if the i-th of the 8 keys equals key
+inline std::uint32_t match_key32(const void* keys, std::uint32_t key) {
+#if defined(__AVX2__)
+    return match_key32_avx2(keys, key);
+#elif defined(DATA_STRUCTURES_HAS_AVX2)
+    return has_avx2 ? match_key32_avx2(keys, key) : match_key32_sse2(keys, key);
+#elif defined(DATA_STRUCTURES_HAS_SSE2)
+    return match_key32_sse2(keys, key);
+#else
+    return match_key32_scalar(keys, key);
+#endif
+}
+
+
+// Bit i of the result is set if the i-th of the 4 keys equals key
+inline std::uint32_t match_key64(const void* keys, std::uint64_t key) {
+#if defined(__AVX2__)
+    return match_key64_avx2(keys, key);
+#elif defined(DATA_STRUCTURES_HAS_AVX2)
+    return has_avx2 ? match_key64_avx2(keys, key) : match_key64_sse2(keys, key);
+#elif defined(DATA_STRUCTURES_HAS_SSE2)
+    return match_key64_sse2(keys, key);
+#else
+    return match_key64_scalar(keys, key);
+#endif
+}
+
+
+// Hints that the cache line of p is about to be read
+inline void prefetch(const void* p) {
+#if defined(__GNUC__) || defined(__clang__)
+    __builtin_prefetch(p);
+#elif defined(DATA_STRUCTURES_X86)
+    _mm_prefetch(static_cast<const char*>(p), _MM_HINT_T0);
+#else
+    (void)p;
+#endif
+}
+
+
+// Index of the lowest set bit, mask must not be zero
+inline std::size_t first_bit(std::uint32_t mask) {
+#if defined(__GNUC__) || defined(__clang__)
+    return static_cast<std::size_t>(__builtin_ctz(mask));
+#else
+    std::size_t i {};
+    while (!(mask & 1)) {
+        mask >>= 1;
+        ++i;
+    }
+    return i;
+#endif
+}
+
+
+// Index of the lowest set bit of a 64 bit mask, mask must not be zero
+inline std::size_t first_bit64(std::uint64_t mask) {
+#if defined(__GNUC__) || defined(__clang__)
+    return static_cast<std::size_t>(__builtin_ctzll(mask));
+#else
+    std::size_t i {};
+    while (!(mask & 1)) {
+        mask >>= 1;
+        ++i;
+    }
+    return i;
+#endif
+}
+
+
+// Number of set bits
+inline std::size_t bit_count(std::uint64_t mask) {
+#if defined(__GNUC__) || defined(__clang__)
+    return static_cast<std::size_t>(__builtin_popcountll(mask));
+#else
+    std::size_t n {};
+    for (; mask; mask &= mask - 1)
+        ++n;
+    return n;
+#endif
+}
+
+
+/// Array kernels: find, count, compare and reduce whole arrays of numbers a register at a time. ///
+/// Elements compare as with their own operators, so a floating point NaN equals nothing and     ///
+/// -0.0 equals 0.0. Integer sums wrap around; floating point sums are added lane by lane and   ///
+/// may round differently than a left to right loop. Min and max of NaNs are unspecified.       ///
+
+// Integers of 1 to 8 bytes (not bool, whose sum is no bool), float and double
+template <typename T>
+constexpr bool is_vectorizable_v = (std::is_integral_v<T> && !std::is_same_v<T, bool>
+                                    && (sizeof(T) == 1 || sizeof(T) == 2 || sizeof(T) == 4 || sizeof(T) == 8))
+                                || std::is_same_v<T, float> || std::is_same_v<T, double>;
+
+enum class Reduction { min, max, sum };
+
+
+template <Reduction R, typename T>
+T combine_scalar(T a, T b) {
+    if constexpr (R == Reduction::min)
+        return b < a ? b : a;
+    else if constexpr (R == Reduction::max)
+        return a < b ? b : a;
+    else if constexpr (std::is_integral_v<T>) {
+        using U = std::make_unsigned_t<T>;  // signed overflow would be undefined
+        return static_cast<T>(static_cast<U>(a) + static_cast<U>(b));
+    }
+    else
+        return a + b;
+}
+
+
+template <typename T>
+std::size_t find_scalar(const T* p, std::size_t n, T value) {
+    for (std::size_t i = 0; i < n; ++i)
+        if (p[i] == value)
+            return i;
+    return n;
+}
+
+
+template <typename T>
+std::size_t count_scalar(const T* p, std::size_t n, T value) {
+    std::size_t found {};
+    for (std::size_t i = 0; i < n; ++i)
+        found += p[i] == value;
+    return found;
+}
+
+
+template <typename T>
+bool equal_scalar(const T* a, const T* b, std::size_t n) {
+    for (std::size_t i = 0; i < n; ++i)
+        if (a[i] != b[i])
+            return false;
+    return true;
+}
+
+
+template <Reduction R, typename T>
+T reduce_scalar(const T* p, std::size_t n) {
+    T result = p[0];
+    for (std::size_t i = 1; i < n; ++i)
+        result = combine_scalar<R>(result, p[i]);
+    return result;
+}
+
+
+#if defined(DATA_STRUCTURES_HAS_SSE2)
+
+template <typename T>
+inline __m128i broadcast_sse2(T value) {
+    if constexpr (std::is_same_v<T, float>)
+        return _mm_castps_si128(_mm_set1_ps(value));
+    else if constexpr (std::is_same_v<T, double>)
+        return _mm_castpd_si128(_mm_set1_pd(value));
+    else if constexpr (sizeof(T) == 1)
+        return _mm_set1_epi8(static_cast<char>(value));
+    else if constexpr (sizeof(T) == 2)
+        return _mm_set1_epi16(static_cast<short>(value));
+    else if constexpr (sizeof(T) == 4)
+        return _mm_set1_epi32(static_cast<int>(value));
+    else
+        return _mm_set1_epi64x(static_cast<long long>(value));
+}
+
+
+// One bit per byte, set for every byte of the lanes where a equals b
+template <typename T>
+inline std::uint32_t match_sse2(__m128i a, __m128i b) {
+    __m128i eq;
+    if constexpr (std::is_same_v<T, float>)
+        eq = _mm_castps_si128(_mm_cmpeq_ps(_mm_castsi128_ps(a), _mm_castsi128_ps(b)));
+    else if constexpr (std::is_same_v<T, double>)
+        eq = _mm_castpd_si128(_mm_cmpeq_pd(_mm_castsi128_pd(a), _mm_castsi128_pd(b)));
+    else if constexpr (sizeof(T) == 1)
+        eq = _mm_cmpeq_epi8(a, b);
+    else if constexpr (sizeof(T) == 2)
+        eq = _mm_cmpeq_epi16(a, b);
+    else if constexpr (sizeof(T) == 4)
+        eq = _mm_cmpeq_epi32(a, b);
+    else {
+        eq = _mm_cmpeq_epi32(a, b);
+        eq = _mm_and_si128(eq, _mm_shuffle_epi32(eq, _MM_SHUFFLE(2, 3, 0, 1)));
+    }
+    return static_cast<std::uint32_t>(_mm_movemask_epi8(eq));
+}
+
+
+// SSE2 only has the min and max of unsigned bytes, signed 16 bit integers and floating point lanes
+template <typename T>
+constexpr bool has_minmax_sse2_v = std::is_floating_point_v<T> || (sizeof(T) == 1 && std::is_unsigned_v<T>)
+                                || (sizeof(T) == 2 && std::is_signed_v<T>);
+
+template <Reduction R, typename T>
+inline __m128i combine_sse2(__m128i a, __m128i b) {
+    if constexpr (std::is_same_v<T, float>) {
+        __m128 x = _mm_castsi128_ps(a), y = _mm_castsi128_ps(b);
+        if constexpr (R == Reduction::sum)
+            return _mm_castps_si128(_mm_add_ps(x, y));
+        else
+            return _mm_castps_si128(R == Reduction::min ? _mm_min_ps(x, y) : _mm_max_ps(x, y));
+    }
+    else if constexpr (std::is_same_v<T, double>) {
+        __m128d x = _mm_castsi128_pd(a), y = _mm_castsi128_pd(b);
+        if constexpr (R == Reduction::sum)
+            return _mm_castpd_si128(_mm_add_pd(x, y));
+        else
+            return _mm_castpd_si128(R == Reduction::min ? _mm_min_pd(x, y) : _mm_max_pd(x, y));
+    }
+    else if constexpr (R == Reduction::sum) {
+        if constexpr (sizeof(T) == 1)
+            return _mm_add_epi8(a, b);
+        else if constexpr (sizeof(T) == 2)
+            return _mm_add_epi16(a, b);
+        else if constexpr (sizeof(T) == 4)
+            return _mm_add_epi32(a, b);
+        else
+            return _mm_add_epi64(a, b);
+    }
+    else if constexpr (sizeof(T) == 1)
+        return R == Reduction::min ? _mm_min_epu8(a, b) : _mm_max_epu8(a, b);
+    else
+        return R == Reduction::min ? _mm_min_epi16(a, b) : _mm_max_epi16(a, b);
+}
+
+
+template <typename T>
+std::size_t find_sse2(const T* p, std::size_t n, T value) {
+    constexpr std::size_t lanes = 16 / sizeof(T);
+    const __m128i needle = broadcast_sse2(value);
+    std::size_t i {};
+    for (; i + lanes <= n; i += lanes)
+        if (std::uint32_t m = match_sse2<T>(_mm_loadu_si128(reinterpret_cast<const __m128i*>(p + i)), needle))
+            return i + first_bit(m) / sizeof(T);
+    return i + find_scalar(p + i, n - i, value);
+}
+
+
+template <typename T>
+std::size_t count_sse2(const T* p, std::size_t n, T value) {
+    constexpr std::size_t lanes = 16 / sizeof(T);
+    const __m128i needle = broadcast_sse2(value);
+    std::size_t bits {};
+    std::size_t i {};
+    for (; i + lanes <= n; i += lanes)
+        bits += bit_count(match_sse2<T>(_mm_loadu_si128(reinterpret_cast<const __m128i*>(p + i)), needle));
+    return bits / sizeof(T) + count_scalar(p + i, n - i, value);
+}
+
+
+template <typename T>
+bool equal_sse2(const T* a, const T* b, std::size_t n) {
+    constexpr std::size_t lanes = 16 / sizeof(T);
+    std::size_t i {};
+    for (; i + lanes <= n; i += lanes)
+        if (match_sse2<T>(_mm_loadu_si128(reinterpret_cast<const __m128i*>(a + i)),
+                          _mm_loadu_si128(reinterpret_cast<const __m128i*>(b + i))) != 0xFFFF)
+            return false;
+    return equal_scalar(a + i, b + i, n - i);
+}
+
+
+// The lanes are combined separately and then with each other
+template <Reduction R, typename T>
+T reduce_sse2(const T* p, std::size_t n) {
+    constexpr std::size_t lanes = 16 / sizeof(T);
+    if (n < lanes)
+        return reduce_scalar<R>(p, n);
+
+    __m128i acc = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+    std::size_t i {lanes};
+    for (; i + lanes <= n; i += lanes)
+        acc = combine_sse2<R, T>(acc, _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + i)));
+
+    T partial[lanes];
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(partial), acc);
+    T result = reduce_scalar<R>(partial, lanes);
+    for (; i < n; ++i)
+        result = combine_scalar<R>(result, p[i]);
+    return result;
+}
+
+#endif
+
+
+#if defined(DATA_STRUCTURES_HAS_AVX2)
+
+template <typename T>
+DATA_STRUCTURES_AVX2 inline __m256i broadcast_avx2(T value) {
+    if constexpr (std::is_same_v<T, float>)
+        return _mm256_castps_si256(_mm256_set1_ps(value));
+    else if constexpr (std::is_same_v<T, double>)
+        return _mm256_castpd_si256(_mm256_set1_pd(value));
+    else if constexpr (sizeof(T) == 1)
+        return _mm256_set1_epi8(static_cast<char>(value));
+    else if constexpr (sizeof(T) == 2)
+        return _mm256_set1_epi16(static_cast<short>(value));
+    else if constexpr (sizeof(T) == 4)
+        return _mm256_set1_epi32(static_cast<int>(value));
+    else
+        return _mm256_set1_epi64x(static_cast<long long>(value));
+}
+
+
+// One bit per byte, set for every byte of the lanes where a equals b
+template <typename T>
+DATA_STRUCTURES_AVX2 inline std::uint32_t match_avx2(__m256i a, __m256i b) {
+    __m256i eq;
+    if constexpr (std::is_same_v<T, float>)
+        eq = _mm256_castps_si256(_mm256_cmp_ps(_mm256_castsi256_ps(a), _mm256_castsi256_ps(b), _CMP_EQ_OQ));
+    else if constexpr (std::is_same_v<T, double>)
+        eq = _mm256_castpd_si256(_mm256_cmp_pd(_mm256_castsi256_pd(a), _mm256_castsi256_pd(b), _CMP_EQ_OQ));
+    else if constexpr (sizeof(T) == 1)
+        eq = _mm256_cmpeq_epi8(a, b);
+    else if constexpr (sizeof(T) == 2)
+        eq = _mm256_cmpeq_epi16(a, b);
+    else if constexpr (sizeof(T) == 4)
+        eq = _mm256_cmpeq_epi32(a, b);
+    else
+        eq = _mm256_cmpeq_epi64(a, b);
+    return static_cast<std::uint32_t>(_mm256_movemask_epi8(eq));
+}
+
+
+template <Reduction R, typename T>
+DATA_STRUCTURES_AVX2 inline __m256i combine_avx2(__m256i a, __m256i b) {
+    constexpr bool min = R == Reduction::min;
+    if constexpr (std::is_same_v<T, float>) {
+        __m256 x = _mm256_castsi256_ps(a), y = _mm256_castsi256_ps(b);
+        if constexpr (R == Reduction::sum)
+            return _mm256_castps_si256(_mm256_add_ps(x, y));
+        else
+            return _mm256_castps_si256(min ? _mm256_min_ps(x, y) : _mm256_max_ps(x, y));
+    }
+    else if constexpr (std::is_same_v<T, double>) {
+        __m256d x = _mm256_castsi256_pd(a), y = _mm256_castsi256_pd(b);
+        if constexpr (R == Reduction::sum)
+            return _mm256_castpd_si256(_mm256_add_pd(x, y));
+        else
+            return _mm256_castpd_si256(min ? _mm256_min_pd(x, y) : _mm256_max_pd(x, y));
+    }
+    else if constexpr (R == Reduction::sum) {
+        if constexpr (sizeof(T) == 1)
+            return _mm256_add_epi8(a, b);
+        else if constexpr (sizeof(T) == 2)
+            return _mm256_add_epi16(a, b);
+        else if constexpr (sizeof(T) == 4)
+            return _mm256_add_epi32(a, b);
+        else
+            return _mm256_add_epi64(a, b);
+    }
+    else if constexpr (sizeof(T) == 1 && std::is_signed_v<T>)
+        return min ? _mm256_min_epi8(a, b) : _mm256_max_epi8(a, b);
+    else if constexpr (sizeof(T) == 1)
+        return min ? _mm256_min_epu8(a, b) : _mm256_max_epu8(a, b);
+    else if constexpr (sizeof(T) == 2 && std::is_signed_v<T>)
+        return min ? _mm256_min_epi16(a, b) : _mm256_max_epi16(a, b);
+    else if constexpr (sizeof(T) == 2)
+        return min ? _mm256_min_epu16(a, b) : _mm256_max_epu16(a, b);
+    else if constexpr (sizeof(T) == 4 && std::is_signed_v<T>)
+        return min ? _mm256_min_epi32(a, b) : _mm256_max_epi32(a, b);
+    else if constexpr (sizeof(T) == 4)
+        return min ? _mm256_min_epu32(a, b) : _mm256_max_epu32(a, b);
+    else {
+        // There is no 64 bit min or max: the lanes are compared as signed numbers,
+        // after flipping the sign bits of unsigned ones
+        __m256i x = a, y = b;
+        if constexpr (std::is_unsigned_v<T>) {
+            const __m256i sign = _mm256_set1_epi64x(std::numeric_limits<long long>::min());
+            x = _mm256_xor_si256(a, sign);
+            y = _mm256_xor_si256(b, sign);
+        }
+        __m256i a_greater = _mm256_cmpgt_epi64(x, y);
+        return min ? _mm256_blendv_epi8(a, b, a_greater) : _mm256_blendv_epi8(b, a, a_greater);
+    }
+}
+
+
+template <typename T>
+DATA_STRUCTURES_AVX2 std::size_t find_avx2(const T* p, std::size_t n, T value) {
+    constexpr std::size_t lanes = 32 / sizeof(T);
+    const __m256i needle = broadcast_avx2(value);
+    std::size_t i {};
+    for (; i + lanes <= n; i += lanes)
+        if (std::uint32_t m = match_avx2<T>(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + i)), needle))
+            return i + first_bit(m) / sizeof(T);
+    return i + find_scalar(p + i, n - i, value);
+}
+
+
+template <typename T>
+DATA_STRUCTURES_AVX2 std::size_t count_avx2(const T* p, std::size_t n, T value) {
+    constexpr std::size_t lanes = 32 / sizeof(T);
+    const __m256i needle = broadcast_avx2(value);
+    std::size_t bits {};
+    std::size_t i {};
+    for (; i + lanes <= n; i += lanes)
+        bits += bit_count(match_avx2<T>(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + i)), needle));
+    return bits / sizeof(T) + count_scalar(p + i, n - i, value);
+}
+
+
+template <typename T>
+DATA_STRUCTURES_AVX2 bool equal_avx2(const T* a, const T* b, std::size_t n) {
+    constexpr std::size_t lanes = 32 / sizeof(T);
+    std::size_t i {};
+    for (; i + lanes <= n; i += lanes)
+        if (match_avx2<T>(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(a + i)),
+                          _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b + i))) != 0xFFFFFFFFu)
+            return false;
+    return equal_scalar(a + i, b + i, n - i);
+}
+
+
+template <Reduction R, typename T>
+DATA_STRUCTURES_AVX2 T reduce_avx2(const T* p, std::size_t n) {
+    constexpr std::size_t lanes = 32 / sizeof(T);
+    if (n < lanes)
+        return reduce_scalar<R>(p, n);
+
+    __m256i acc = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+    std::size_t i {lanes};
+    for (; i + lanes <= n; i += lanes)
+        acc = combine_avx2<R, T>(acc, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + i)));
+
+    T partial[lanes];
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(partial), acc);
+    T result = reduce_scalar<R>(partial, lanes);
+    for (; i < n; ++i)
+        result = combine_scalar<R>(result, p[i]);
+    return result;
+}
+
+#endif
+
+
+// AVX-512 compares give one bit per lane rather than per byte
+#if defined(DATA_STRUCTURES_X86) && ((defined(__AVX512F__) && defined(__AVX512BW__)) || defined(DATA_STRUCTURES_TARGET_DISPATCH))
+
+#if defined(__AVX512F__) && defined(__AVX512BW__)
+#define DATA_STRUCTURES_AVX512
+#else
+#define DATA_STRUCTURES_AVX512 DATA_STRUCTURES_TARGET("avx512f,avx512bw")
+#endif
+
+template <typename T>
+DATA_STRUCTURES_AVX512 inline __m512i broadcast_avx512(T value) {
+    if constexpr (std::is_same_v<T, float>)
+        return _mm512_castps_si512(_mm512_set1_ps(value));
+    else if constexpr (std::is_same_v<T, double>)
+        return _mm512_castpd_si512(_mm512_set1_pd(value));
+    else if constexpr (sizeof(T) == 1)
+        return _mm512_set1_epi8(static_cast<char>(value));
+    else if constexpr (sizeof(T) == 2)
+        return _mm512_set1_epi16(static_cast<short>(value));
+    else if constexpr (sizeof(T) == 4)
+        return _mm512_set1_epi32(static_cast<int>(value));
+    else
+        return _mm512_set1_epi64(static_cast<long long>(value));
+}
+
+
+// One bit per lane, set where a equals b
+template <typename T>
+DATA_STRUCTURES_AVX512 inline std::uint64_t match_avx512(__m512i a, __m512i b) {
+    if constexpr (std::is_same_v<T, float>)
+        return _mm512_cmp_ps_mask(_mm512_castsi512_ps(a), _mm512_castsi512_ps(b), _CMP_EQ_OQ);
+    else if constexpr (std::is_same_v<T, double>)
+        return _mm512_cmp_pd_mask(_mm512_castsi512_pd(a), _mm512_castsi512_pd(b), _CMP_EQ_OQ);
+    else if constexpr (sizeof(T) == 1)
+        return _mm512_cmpeq_epi8_mask(a, b);
+    else if constexpr (sizeof(T) == 2)
+        return _mm512_cmpeq_epi16_mask(a, b);
+    else if constexpr (sizeof(T) == 4)
+        return _mm512_cmpeq_epi32_mask(a, b);
+    else
+        return _mm512_cmpeq_epi64_mask(a, b);
+}
+
+
+// The unmasked 32 and 64 bit min and max intrinsics of GCC pass _mm512_undefined_*() as the merge
+// source, which GCC 12 then reports as maybe uninitialized, so the masked forms are used instead
+// with every lane selected and a as the merge source, which is never read.
+template <Reduction R, typename T>
+DATA_STRUCTURES_AVX512 inline __m512i combine_avx512(__m512i a, __m512i b) {
+    constexpr bool min = R == Reduction::min;
+    constexpr __mmask8 all8 = 0xFF;
+    constexpr __mmask16 all16 = 0xFFFF;
+    if constexpr (std::is_same_v<T, float>) {
+        __m512 x = _mm512_castsi512_ps(a), y = _mm512_castsi512_ps(b);
+        if constexpr (R == Reduction::sum)
+            return _mm512_castps_si512(_mm512_add_ps(x, y));
+        else
+            return _mm512_castps_si512(min ? _mm512_mask_min_ps(x, all16, x, y) : _mm512_mask_max_ps(x, all16, x, y));
+    }
+    else if constexpr (std::is_same_v<T, double>) {
+        __m512d x = _mm512_castsi512_pd(a), y = _mm512_castsi512_pd(b);
+        if constexpr (R == Reduction::sum)
+            return _mm512_castpd_si512(_mm512_add_pd(x, y));
+        else
+            return _mm512_castpd_si512(min ? _mm512_mask_min_pd(x, all8, x, y) : _mm512_mask_max_pd(x, all8, x, y));
+    }
+    else if constexpr (R == Reduction::sum) {
+        if constexpr (sizeof(T) == 1)
+            return _mm512_add_epi8(a, b);
+        else if constexpr (sizeof(T) == 2)
+            return _mm512_add_epi16(a, b);
+        else if constexpr (sizeof(T) == 4)
+            return _mm512_add_epi32(a, b);
+        else
+            return _mm512_add_epi64(a, b);
+    }
+    else if constexpr (sizeof(T) == 1 && std::is_signed_v<T>)
+        return min ? _mm512_min_epi8(a, b) : _mm512_max_epi8(a, b);
+    else if constexpr (sizeof(T) == 1)
+        return min ? _mm512_min_epu8(a, b) : _mm512_max_epu8(a, b);
+    else if constexpr (sizeof(T) == 2 && std::is_signed_v<T>)
+        return min ? _mm512_min_epi16(a, b) : _mm512_max_epi16(a, b);
+    else if constexpr (sizeof(T) == 2)
+        return min ? _mm512_min_epu16(a, b) : _mm512_max_epu16(a, b);
+    else if constexpr (sizeof(T) == 4 && std::is_signed_v<T>)
+        return min ? _mm512_mask_min_epi32(a, all16, a, b) : _mm512_mask_max_epi32(a, all16, a, b);
+    else if constexpr (sizeof(T) == 4)
+        return min ? _mm512_mask_min_epu32(a, all16, a, b) : _mm512_mask_max_epu32(a, all16, a, b);
+    else if constexpr (std::is_signed_v<T>)
+        return min ? _mm512_mask_min_epi64(a, all8, a, b) : _mm512_mask_max_epi64(a, all8, a, b);
+    else
+        return min ? _mm512_mask_min_epu64(a, all8, a, b) : _mm512_mask_max_epu64(a, all8, a, b);
+}
+
+
+template <typename T>
+DATA_STRUCTURES_AVX512 std::size_t find_avx512(const T* p, std::size_t n, T value) {
+    constexpr std::size_t lanes = 64 / sizeof(T);
+    const __m512i needle = broadcast_avx512(value);
+    std::size_t i {};
+    for (; i + lanes <= n; i += lanes)
+        if (std::uint64_t m = match_avx512<T>(_mm512_loadu_si512(p + i), needle))
+            return i + first_bit64(m);
+    return i + find_scalar(p + i, n - i, value);
+}
+
+
+template <typename T>
+DATA_STRUCTURES_AVX512 std::size_t count_avx512(const T* p, std::size_t n, T value) {
+    constexpr std::size_t lanes = 64 / sizeof(T);
+    const __m512i needle = broadcast_avx512(value);
+    std::size_t found {};
+    std::size_t i {};
+    for (; i + lanes <= n; i += lanes)
+        found += bit_count(match_avx512<T>(_mm512_loadu_si512(p + i), needle));
+    return found + count_scalar(p + i, n - i, value);
+}
+
+
+template <typename T>
+DATA_STRUCTURES_AVX512 bool equal_avx512(const T* a, const T* b, std::size_t n) {
+    constexpr std::size_t lanes = 64 / sizeof(T);
+    constexpr std::uint64_t all = lanes == 64 ? ~std::uint64_t{} : (std::uint64_t{1} << lanes) - 1;
+    std::size_t i {};
+    for (; i + lanes <= n; i += lanes)
+        if (match_avx512<T>(_mm512_loadu_si512(a + i), _mm512_loadu_si512(b + i)) != all)
+            return false;
+    return equal_scalar(a + i, b + i, n - i);
+}
+
+
+template <Reduction R, typename T>
+DATA_STRUCTURES_AVX512 T reduce_avx512(const T* p, std::size_t n) {
+    constexpr std::size_t lanes = 64 / sizeof(T);
+    if (n < lanes)
+        return reduce_scalar<R>(p, n);
+
+    __m512i acc = _mm512_loadu_si512(p);
+    std::size_t i {lanes};
+    for (; i + lanes <= n; i += lanes)
+        acc = combine_avx512<R, T>(acc, _mm512_loadu_si512(p + i));
+
+    T partial[lanes];
+    _mm512_storeu_si512(partial, acc);
+    T result = reduce_scalar<R>(partial, lanes);
+    for (; i < n; ++i)
+        result = combine_scalar<R>(result, p[i]);
+    return result;
+}
+
+#define DATA_STRUCTURES_HAS_AVX512 1
+#endif
+
+
+// Each call runs on the widest instruction set the CPU has
+
+// Index of the first of the n elements at p that equals value, n if none does
+template <typename T>
+std::size_t find(const T* p, std::size_t n, T value) {
+#if defined(DATA_STRUCTURES_HAS_AVX512)
+    if (has_avx512)
+        return find_avx512(p, n, value);
+#endif
+#if defined(DATA_STRUCTURES_HAS_AVX2)
+    if (has_avx2)
+        return find_avx2(p, n, value);
+#endif
+#if defined(DATA_STRUCTURES_HAS_SSE2)
+    return find_sse2(p, n, value);
+#else
+    return find_scalar(p, n, value);
+#endif
+}
+
+
+// Number of the n elements at p that equal value
+template <typename T>
+std::size_t count(const T* p, std::size_t n, T value) {
+#if defined(DATA_STRUCTURES_HAS_AVX512)
+    if (has_avx512)
+        return count_avx512(p, n, value);
+#endif
+#if defined(DATA_STRUCTURES_HAS_AVX2)
+    if (has_avx2)
+        return count_avx2(p, n, value);
+#endif
+#if defined(DATA_STRUCTURES_HAS_SSE2)
+    return count_sse2(p, n, value);
+#else
+    return count_scalar(p, n, value);
+#endif
+}
+
+
+// Whether a[i] == b[i] for each of the n elements
+template <typename T>
+bool equal(const T* a, const T* b, std::size_t n) {
+#if defined(DATA_STRUCTURES_HAS_AVX512)
+    if (has_avx512)
+        return equal_avx512(a, b, n);
+#endif
+#if defined(DATA_STRUCTURES_HAS_AVX2)
+    if (has_avx2)
+        return equal_avx2(a, b, n);
+#endif
+#if defined(DATA_STRUCTURES_HAS_SSE2)
+    return equal_sse2(a, b, n);
+#else
+    return equal_scalar(a, b, n);
+#endif
+}
+
+
+// Min, max or sum of the n elements at p, n must not be zero
+template <Reduction R, typename T>
+T reduce(const T* p, std::size_t n) {
+#if defined(DATA_STRUCTURES_HAS_AVX512)
+    if (has_avx512)
+        return reduce_avx512<R>(p, n);
+#endif
+#if defined(DATA_STRUCTURES_HAS_AVX2)
+    if (has_avx2)
+        return reduce_avx2<R>(p, n);
+#endif
+#if defined(DATA_STRUCTURES_HAS_SSE2)
+    if constexpr (R == Reduction::sum || has_minmax_sse2_v<T>)
+        return reduce_sse2<R>(p, n);
+    else
+        return reduce_scalar<R>(p, n);
+#else
+    return reduce_scalar<R>(p, n);
+#endif
+}
+
+}
+}
@@ -0,0 +1,498 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <initializer_list>
+#include <memory>
+#include <new>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+#include "Allocator.hpp"
+#include "Vector.hpp"
+
+namespace data_structures {
+
+// A Vector that keeps its first N elements inside the object itself and only allocates
+// memory once it grows past them. It has the interface (and the iterators) of Vector, so
+// it can replace one wherever most instances are known to stay small, like the buckets
+// of a hash map or the edge lists of a graph, saving an allocation per instance.
+// Moving a SmallVector whose elements are inline moves the elements one by one.
+// A is the allocator of the heap buffer (see Allocator.hpp).
+template <typename T, std::size_t N, typename A = std::allocator<T>>
+class SmallVector {
+    static_assert(N > 0, "a SmallVector needs room for at least one inline element");
+    using alloc_traits = std::allocator_traits<A>;
+
+public:
+    using iterator = Vector_Iterator<T>;
+    using const_iterator = Const_Vector_Iterator<T>;
+    using allocator_type = A;
+
+    static constexpr std::size_t inline_capacity {N};
+
+    SmallVector() noexcept(noexcept(A()));
+    explicit SmallVector(const A& in_alloc) noexcept;
+    explicit SmallVector(std::size_t size, const A& in_alloc = A());
+    SmallVector(std::size_t size, const T& value, const A& in_alloc = A());
+    explicit SmallVector(const std::initializer_list<T>& values, const A& in_alloc = A());
+    SmallVector(const SmallVector& vec);
+    SmallVector(const SmallVector& vec, const A& in_alloc);
+    SmallVector(SmallVector&& vec) noexcept(std::is_nothrow_move_constructible_v<T>);
+    SmallVector(SmallVector&& vec, const A& in_alloc);
+    ~SmallVector();
+
+    A get_allocator() const { return alloc; }
+
+    void push_back(const T& value);
+    void push_back(T&& value);
+    void pop_back();
+
+    template <typename ... Args>
+    T& emplace_back(Args&& ... args);
+
+    iterator erase(iterator pos);
+    iterator insert(iterator pos, const T& value);
+    iterator find(const T& key);
+
+    T& front();
+    T& back();
+    T& at(std::size_t index);
+
+    std::size_t size()      const  { return sz;      }
+    std::size_t capacity()  const  { return cap;     }
+    bool empty()            const  { return sz == 0; }
+    bool inlined()          const  { return data == inline_data(); }  // no memory allocated
+
+    void resize(std::size_t n);
+    void resize(std::size_t n, const T& val);
+    void reserve(std::size_t n);
+
+    void clear();
+    void swap(SmallVector& vec) noexcept(std::is_nothrow_move_constructible_v<T>);
+
+    T&       operator[] (std::size_t index)       { return data[index]; }
+    const T& operator[] (std::size_t index) const { return data[index]; }
+    SmallVector& operator= (const SmallVector& rhs);
+    SmallVector& operator= (SmallVector&& rhs) noexcept(std::is_nothrow_move_constructible_v<T>
+                                                         && (propagate_on_move_v<A> || always_equal_v<A>));
+
+    iterator begin() { return iterator{data};      }
+    iterator end()   { return iterator{data + sz}; }
+
+    const_iterator cbegin() const { return const_iterator{data};      }
+    const_iterator cend()   const { return const_iterator{data + sz}; }
+
+private:
+    T* data;
+    std::size_t sz;
+    std::size_t cap;
+    alignas(T) unsigned char buffer[N * sizeof(T)];
+    DATA_STRUCTURES_NO_UNIQUE_ADDRESS A alloc;
+    static constexpr short capacity_factor {2};
+
+    T* inline_data() const { return reinterpret_cast<T*>(const_cast<unsigned char*>(buffer)); }
+    void p_realloc(std::size_t n);
+    void p_release();
+    void p_take(SmallVector& vec);
+
+    template <typename ... Args>
+    void p_construct(T* p, Args&& ... args) { alloc_traits::construct(alloc, p, std::forward<Args>(args)...); }
+    void p_destroy(T* p) { alloc_traits::destroy(alloc, p); }
+    template <typename ... Args>
+    T& p_grow_and_emplace(Args&& ... args);
+};
+
+
+template <typename T, std::size_t N, typename A>
+SmallVector<T,N,A>::SmallVector() noexcept(noexcept(A()))
+    : data{inline_data()}, sz{}, cap{N}, alloc{} {}
+
+
+template <typename T, std::size_t N, typename A>
+SmallVector<T,N,A>::SmallVector(const A& in_alloc) noexcept
+    : data{inline_data()}, sz{}, cap{N}, alloc{in_alloc} {}
+
+
+template <typename T, std::size_t N, typename A>
+SmallVector<T,N,A>::SmallVector(std::size_t size, const A& in_alloc)
+    : SmallVector(in_alloc)
+{
+    resize(size);
+}
+
+
+template <typename T, std::size_t N, typename A>
+SmallVector<T,N,A>::SmallVector(std::size_t size, const T& value, const A& in_alloc)
+    : SmallVector(in_alloc)
+{
+    resize(size, value);
+}
+
+
+template <typename T, std::size_t N, typename A>
+SmallVector<T,N,A>::SmallVector(const std::initializer_list<T>& values, const A& in_alloc)
+    : SmallVector(in_alloc)
+{
+    reserve(values.size());
+    for (const T& v : values)
+        p_construct(&data[sz++], v);
+}
+
+
+template <typename T, std::size_t N, typename A>
+SmallVector<T,N,A>::SmallVector(const SmallVector& vec)
+    : SmallVector(vec, alloc_traits::select_on_container_copy_construction(vec.alloc)) {}
+
+
+template <typename T, std::size_t N, typename A>
+SmallVector<T,N,A>::SmallVector(const SmallVector& vec, const A& in_alloc)
+    : SmallVector(in_alloc)
+{
+    reserve(vec.sz);
+    for (; sz < vec.sz; ++sz)
+        p_construct(&data[sz], vec[sz]);
+}
+
+
+// A heap buffer is stolen, inline elements have to be moved over
+template <typename T, std::size_t N, typename A>
+SmallVector<T,N,A>::SmallVector(SmallVector&& vec) noexcept(std::is_nothrow_move_constructible_v<T>)
+    : SmallVector(vec.alloc)
+{
+    p_take(vec);
+}
+
+
+// The heap buffer of vec can only be stolen if in_alloc can free it
+template <typename T, std::size_t N, typename A>
+SmallVector<T,N,A>::SmallVector(SmallVector&& vec, const A& in_alloc)
+    : SmallVector(in_alloc)
+{
+    if (alloc == vec.alloc)
+        p_take(vec);
+    else {
+        reserve(vec.sz);
+        for (; sz < vec.sz; ++sz)
+            p_construct(&data[sz], std::move(vec.data[sz]));
+        vec.clear();
+    }
+}
+
+
+template <typename T, std::size_t N, typename A>
+SmallVector<T,N,A>::~SmallVector() {
+    clear();
+    p_release();
+}
+
+
+// Frees the heap buffer, if any, and goes back to the inline one. The vector must be empty.
+template <typename T, std::size_t N, typename A>
+void SmallVector<T,N,A>::p_release() {
+    if (!inlined())
+        alloc_traits::deallocate(alloc, data, cap);
+    data = inline_data();
+    cap = N;
+}
+
+
+// Moves the contents of vec, whose heap buffer our allocator can free, into *this, which must be empty
+template <typename T, std::size_t N, typename A>
+void SmallVector<T,N,A>::p_take(SmallVector& vec) {
+    if (vec.inlined()) {
+        for (; sz < vec.sz; ++sz)
+            p_construct(&data[sz], std::move(vec.data[sz]));
+        vec.clear();
+        return;
+    }
+    p_release();
+    data = vec.data;
+    sz = vec.sz;
+    cap = vec.cap;
+    vec.data = vec.inline_data();
+    vec.sz = 0;
+    vec.cap = N;
+}
+
+
+template <typename T, std::size_t N, typename A>
+void SmallVector<T,N,A>::p_realloc(std::size_t n) {
+    T* new_data = alloc_traits::allocate(alloc, n);
+
+    for (std::size_t i = 0; i < sz; ++i)
+        p_construct(&new_data[i], std::move(data[i]));
+    for (std::size_t i = 0; i < sz; ++i)
+        p_destroy(&data[i]);
+
+    if (!inlined())
+        alloc_traits::deallocate(alloc, data, cap);
+    data = new_data;
+    cap = n;
+}
+
+
+// The new element is constructed before the old ones are moved, since args may refer to one of them
+template <typename T, std::size_t N, typename A>
+template <typename ... Args>
+T& SmallVector<T,N,A>::p_grow_and_emplace(Args&& ... args) {
+    std::size_t new_cap = cap * capacity_factor;
+    T* new_data = alloc_traits::allocate(alloc, new_cap);
+    try {
+        p_construct(&new_data[sz], std::forward<Args>(args)...);
+    }
+    catch (...) {
+        alloc_traits::deallocate(alloc, new_data, new_cap);
+        throw;
+    }
+
+    for (std::size_t i = 0; i < sz; ++i)
+        p_construct(&new_data[i], std::move(data[i]));
+    for (std::size_t i = 0; i < sz; ++i)
+        p_destroy(&data[i]);
+
+    if (!inlined())
+        alloc_traits::deallocate(alloc, data, cap);
+    data = new_data;
+    cap = new_cap;
+    return data[sz++];
+}
+
+
+template <typename T, std::size_t N, typename A>
+void SmallVector<T,N,A>::push_back(const T& value) {
+    emplace_back(value);
+}
+
+
+template <typename T, std::size_t N, typename A>
+void SmallVector<T,N,A>::push_back(T&& value) {
+    emplace_back(std::move(value));
+}
+
+
+template <typename T, std::size_t N, typename A>
+void SmallVector<T,N,A>::pop_back() {
+    if (sz > 0) {
+        --sz;
+        p_destroy(&data[sz]);
+    }
+}
+
+
+template <typename T, std::size_t N, typename A>
+template <typename ... Args>
+T& SmallVector<T,N,A>::emplace_back(Args&& ... args) {
+    if (sz >= cap)
+        return p_grow_and_emplace(std::forward<Args>(args)...);
+    p_construct(&data[sz], std::forward<Args>(args)...);
+    return data[sz++];
+}
+
+
+// Returns an iterator to the element that followed the erased one
+template <typename T, std::size_t N, typename A>
+typename SmallVector<T,N,A>::iterator SmallVector<T,N,A>::erase(iterator pos) {
+    if (pos == end())
+        throw std::invalid_argument("invalid position");
+
+    std::size_t index = pos.operator->() - data;
+    std::move(data + index + 1, data + sz, data + index);
+    --sz;
+    p_destroy(&data[sz]);
+    return iterator{data + index};
+}
+
+
+// Unlike Vector::insert, pos may be end()
+template <typename T, std::size_t N, typename A>
+typename SmallVector<T,N,A>::iterator SmallVector<T,N,A>::insert(iterator pos, const T& value) {
+    std::size_t index = pos.operator->() - data;
+    if (index > sz)
+        throw std::invalid_argument("invalid position");
+    if (index == sz) {
+        emplace_back(value);
+        return iterator{data + index};
+    }
+
+    T copy(value);  // value may be one of the elements that are about to move
+    if (sz >= cap)
+        p_realloc(cap * capacity_factor);
+    p_construct(&data[sz], std::move(data[sz - 1]));
+    std::move_backward(data + index, data + sz - 1, data + sz);
+    data[index] = std::move(copy);
+    ++sz;
+    return iterator{data + index};
+}
+
+
+template <typename T, std::size_t N, typename A>
+typename SmallVector<T,N,A>::iterator SmallVector<T,N,A>::find(const T& key) {
+    for (auto iter = begin(); iter != end(); ++iter)
+        if (*iter == key)
+            return iter;
+    return end();
+}
+
+
+template <typename T, std::size_t N, typename A>
+T& SmallVector<T,N,A>::front() {
+    if (!sz)
+        throw std::runtime_error("vector is empty");
+    return data[0];
+}
+
+
+template <typename T, std::size_t N, typename A>
+T& SmallVector<T,N,A>::back() {
+    if (!sz)
+        throw std::runtime_error("vector is empty");
+    return data[sz - 1];
+}
+
+
+template <typename T, std::size_t N, typename A>
+T& SmallVector<T,N,A>::at(std::size_t index) {
+    if (!sz)
+        throw std::runtime_error("vector is empty");
+    else if (index >= sz)
+        throw std::invalid_argument("invalid index");
+    return data[index];
+}
+
+
+template <typename T, std::size_t N, typename A>
+void SmallVector<T,N,A>::resize(std::size_t n) {
+    if (n < sz) {
+        for (std::size_t i = n; i < sz; ++i)
+            p_destroy(&data[i]);
+        sz = n;
+        return;
+    }
+    reserve(n);
+    for (; sz < n; ++sz)
+        p_construct(&data[sz]);
+}
+
+
+template <typename T, std::size_t N, typename A>
+void SmallVector<T,N,A>::resize(std::size_t n, const T& val) {
+    if (n < sz) {
+        for (std::size_t i = n; i < sz; ++i)
+            p_destroy(&data[i]);
+        sz = n;
+        return;
+    }
+    if (n > cap) {
+        T copy(val);  // val may be one of the elements
+        p_realloc(n);
+        for (; sz < n; ++sz)
+            p_construct(&data[sz], copy);
+        return;
+    }
+    for (; sz < n; ++sz)
+        p_construct(&data[sz], val);
+}
+
+
+// Requests that the vector capacity be at least enough to contain n elements
+template <typename T, std::size_t N, typename A>
+void SmallVector<T,N,A>::reserve(std::size_t n) {
+    if (n > cap)
+        p_realloc(n);
+}
+
+
+template <typename T, std::size_t N, typename A>
+void SmallVector<T,N,A>::clear() {
+    for (std::size_t i = 0; i < sz; ++i)
+        p_destroy(&data[i]);
+    sz = 0;
+}
+
+
+template <typename T, std::size_t N, typename A>
+SmallVector<T,N,A>& SmallVector<T,N,A>::operator=(const SmallVector& rhs) {
+    if (this == &rhs)
+        return *this;
+
+    clear();
+    if constexpr (propagate_on_copy_v<A>) {
+        if (alloc != rhs.alloc)
+            p_release();
+        alloc = rhs.alloc;
+    }
+    reserve(rhs.sz);
+    for (; sz < rhs.sz; ++sz)
+        p_construct(&data[sz], rhs[sz]);
+    return *this;
+}
+
+
+// Keeps the heap buffer of *this when the elements of rhs are inline, since they fit in it.
+// The heap buffer of rhs is only stolen if our allocator can free it.
+template <typename T, std::size_t N, typename A>
+SmallVector<T,N,A>& SmallVector<T,N,A>::operator=(SmallVector&& rhs) noexcept(std::is_nothrow_move_constructible_v<T>
+                                                                           && (propagate_on_move_v<A> || always_equal_v<A>)) {
+    if (this == &rhs)
+        return *this;
+
+    clear();
+    if constexpr (propagate_on_move_v<A>) {
+        if (alloc != rhs.alloc)
+            p_release();
+        alloc = std::move(rhs.alloc);
+    }
+    else if (alloc != rhs.alloc) {
+        reserve(rhs.sz);
+        for (; sz < rhs.sz; ++sz)
+            p_construct(&data[sz], std::move(rhs.data[sz]));
+        rhs.clear();
+        return *this;
+    }
+    p_take(rhs);
+    return *this;
+}
+
+
+// Two heap buffers are swapped like in Vector; otherwise the elements have to move
+template <typename T, std::size_t N, typename A>
+void SmallVector<T,N,A>::swap(SmallVector& vec) noexcept(std::is_nothrow_move_constructible_v<T>) {
+    if (!inlined() && !vec.inlined()) {
+        swap_allocators(alloc, vec.alloc);
+        std::swap(data, vec.data);
+        std::swap(sz, vec.sz);
+        std::swap(cap, vec.cap);
+        return;
+    }
+    SmallVector temp{std::move(vec)};
+    vec = std::move(*this);
+    *this = std::move(temp);
+}
+
+
+template <typename T, std::size_t N, typename A>
+void swap(SmallVector<T,N,A>& lhs, SmallVector<T,N,A>& rhs) {
+    lhs.swap(rhs);
+}
+
+
+template <typename T, std::size_t N, typename A>
+bool operator==(const SmallVector<T,N,A>& lhs, const SmallVector<T,N,A>& rhs) {
+    if (lhs.size() != rhs.size())
+        return false;
+
+    for (std::size_t i = 0; i < lhs.size(); ++i)
+        if (lhs[i] != rhs[i])
+            return false;
+
+    return true;
+}
+
+
+template <typename T, std::size_t N, typename A>
+bool operator!=(const SmallVector<T,N,A>& lhs, const SmallVector<T,N,A>& rhs) {
+    return !(lhs == rhs);
+}
+
+}
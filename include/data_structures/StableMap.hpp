@@ -0,0 +1,468 @@
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <initializer_list>
+#include <iterator>
+#include <memory>
+#include <stdexcept>
+#include <tuple>
+#include <utility>
+#include "Allocator.hpp"
+#include "HashPolicy.hpp"
+#include "NodePool.hpp"
+#include "Vector.hpp"
+
+namespace data_structures {
+
+template <typename K, typename V, typename H, typename P, typename A> class Stable_Map_Iterator;
+template <typename K, typename V, typename H, typename P, typename A> class Const_Stable_Map_Iterator;
+
+// Hash map whose elements never move once inserted: pointers and references to keys and
+// values stay valid until the element is removed, across any number of inserts and rehashes.
+// Every element lives in its own node, chained into its bucket. Nodes come from a NodePool,
+// so removing an element and inserting another reuses the memory instead of freeing it.
+// The pool and the bucket array take their memory from A (see Allocator.hpp).
+template <typename K, typename V, typename H = std::hash<K>, typename P = PrimeSizePolicy,
+          typename A = std::allocator<std::pair<K,V>>>
+class StableMap {
+public:
+    using iterator = Stable_Map_Iterator<K,V,H,P,A>;
+    using const_iterator = Const_Stable_Map_Iterator<K,V,H,P,A>;
+    using allocator_type = A;
+
+    StableMap();
+    explicit StableMap(const A& in_alloc);
+    explicit StableMap(H in_hash, const A& in_alloc = A());
+    explicit StableMap(const std::initializer_list<std::pair<K,V>>& list, const A& in_alloc = A());
+    StableMap(const StableMap& map);
+    StableMap(const StableMap& map, const A& in_alloc);
+    StableMap(StableMap&& map) noexcept;
+    ~StableMap();
+
+    A get_allocator() const { return A(pool.get_allocator()); }
+
+    void insert(const K& key, const V& value);
+    void remove(const K& key);
+
+    // Constructs the value from args, unless key is already in the map. Returns the element
+    // with key and whether it was inserted.
+    template <typename... Args>
+    std::pair<iterator, bool> try_emplace(const K& key, Args&&... args);
+
+    std::size_t size()     const { return sz;      }
+    std::size_t capacity() const { return cap;     }  // number of buckets
+    bool empty()           const { return sz == 0; }
+
+    // Makes room for n elements in total, so that inserting them will not trigger a rehash
+    void reserve(std::size_t n);
+
+    void clear();
+    void swap(StableMap& rhs) noexcept;
+
+    V& operator[](const K& key);
+    const V& operator[](const K& key) const;
+    StableMap& operator=(const StableMap& rhs);
+    StableMap& operator=(StableMap&& rhs) noexcept(always_equal_v<A>);
+
+    iterator find(const K& key);
+    const_iterator find(const K& key) const;
+    bool contains(const K& key) const { return lookup(key) != nullptr; }
+    std::size_t count(const K& key) const { return contains(key) ? 1 : 0; }
+
+    iterator begin() { return iterator{this, first_bucket(), nullptr};       }
+    iterator end()   { return iterator{this, cap, nullptr};                  }
+
+    const_iterator cbegin() const { return const_iterator{this, first_bucket(), nullptr}; }
+    const_iterator cend()   const { return const_iterator{this, cap, nullptr};            }
+
+private:
+    friend class Stable_Map_Iterator<K,V,H,P,A>;
+    friend class Const_Stable_Map_Iterator<K,V,H,P,A>;
+
+    // The hash is kept in the node, so that a rehash relinks nodes without hashing their keys again
+    struct Node {
+        std::pair<K,V> data;
+        std::size_t hash;
+        Node* next;
+
+        template <typename... Args>
+        Node(std::size_t in_hash, Node* in_next, const K& key, Args&&... args)
+            : data(std::piecewise_construct, std::forward_as_tuple(key), std::forward_as_tuple(std::forward<Args>(args)...)),
+              hash{in_hash}, next{in_next} {}
+    };
+
+    static constexpr double max_load_factor {0.9};
+
+    std::size_t sz {};
+    std::size_t cap {P::min_size()};
+
+    H hash_function;
+    Vector<Node*, rebind_alloc_t<A, Node*>> buckets;
+    NodePool<Node, rebind_alloc_t<A, Node>> pool;
+
+    Node* lookup(const K& key) const;
+    template <typename... Args>
+    Node* insert_new(std::size_t hash, const K& key, Args&&... args);
+    void rehash(std::size_t new_cap);
+    std::size_t first_bucket() const;
+};
+
+
+template <typename K, typename V, typename H, typename P, typename A>
+StableMap<K,V,H,P,A>::StableMap()
+    : StableMap(A()) {}
+
+
+template <typename K, typename V, typename H, typename P, typename A>
+StableMap<K,V,H,P,A>::StableMap(const A& in_alloc)
+    : StableMap(H(), in_alloc) {}
+
+
+template <typename K, typename V, typename H, typename P, typename A>
+StableMap<K,V,H,P,A>::StableMap(H in_hash, const A& in_alloc)
+    : hash_function{in_hash}, buckets(cap, nullptr, in_alloc), pool(in_alloc) {}
+
+
+template <typename K, typename V, typename H, typename P, typename A>
+StableMap<K,V,H,P,A>::StableMap(const std::initializer_list<std::pair<K,V>>& list, const A& in_alloc)
+    : StableMap(in_alloc)
+{
+    for (auto& e : list)
+        insert(e.first, e.second);
+}
+
+
+template <typename K, typename V, typename H, typename P, typename A>
+StableMap<K,V,H,P,A>::StableMap(const StableMap& map)
+    : StableMap(map, std::allocator_traits<A>::select_on_container_copy_construction(map.get_allocator())) {}
+
+
+// The copy gets its own nodes, laid out for its own table
+template <typename K, typename V, typename H, typename P, typename A>
+StableMap<K,V,H,P,A>::StableMap(const StableMap& map, const A& in_alloc)
+    : StableMap(map.hash_function, in_alloc)
+{
+    reserve(map.sz);
+    for (auto iter = map.cbegin(); iter != map.cend(); ++iter)
+        insert(iter->first, iter->second);
+}
+
+
+// The nodes (and the pool they come from) change owner, so pointers into map stay valid
+template <typename K, typename V, typename H, typename P, typename A>
+StableMap<K,V,H,P,A>::StableMap(StableMap&& map) noexcept
+    : StableMap(map.get_allocator())
+{
+    map.swap(*this);
+}
+
+
+template <typename K, typename V, typename H, typename P, typename A>
+StableMap<K,V,H,P,A>::~StableMap() {
+    clear();
+}
+
+
+template <typename K, typename V, typename H, typename P, typename A>
+void StableMap<K,V,H,P,A>::swap(StableMap& rhs) noexcept {
+    std::swap(sz, rhs.sz);
+    std::swap(cap, rhs.cap);
+    std::swap(hash_function, rhs.hash_function);
+    buckets.swap(rhs.buckets);
+    pool.swap(rhs.pool);
+}
+
+
+template <typename K, typename V, typename H, typename P, typename A>
+typename StableMap<K,V,H,P,A>::Node* StableMap<K,V,H,P,A>::lookup(const K& key) const {
+    std::size_t hash = hash_function(key);
+    for (Node* n = buckets[P::index(hash, cap)]; n; n = n->next)
+        if (n->hash == hash && n->data.first == key)
+            return n;
+    return nullptr;
+}
+
+
+template <typename K, typename V, typename H, typename P, typename A>
+std::size_t StableMap<K,V,H,P,A>::first_bucket() const {
+    std::size_t b {};
+    while (b < cap && !buckets[b])
+        ++b;
+    return b;
+}
+
+
+// Relinks every node into a table of new_cap buckets. Only the bucket array is reallocated.
+template <typename K, typename V, typename H, typename P, typename A>
+void StableMap<K,V,H,P,A>::rehash(std::size_t new_cap) {
+    Vector<Node*, rebind_alloc_t<A, Node*>> new_buckets(new_cap, nullptr, buckets.get_allocator());
+    for (std::size_t b = 0; b < cap; ++b) {
+        Node* n = buckets[b];
+        while (n) {
+            Node* next = n->next;
+            Node*& head = new_buckets[P::index(n->hash, new_cap)];
+            n->next = head;
+            head = n;
+            n = next;
+        }
+    }
+    buckets.swap(new_buckets);
+    cap = new_cap;
+}
+
+
+template <typename K, typename V, typename H, typename P, typename A>
+void StableMap<K,V,H,P,A>::reserve(std::size_t n) {
+    std::size_t needed = static_cast<std::size_t>(n / max_load_factor) + 1;
+    if (needed > cap)
+        rehash(P::next_size(needed));
+}
+
+
+// Inserts a key that is known to be missing, with a value constructed from args
+template <typename K, typename V, typename H, typename P, typename A>
+template <typename... Args>
+typename StableMap<K,V,H,P,A>::Node* StableMap<K,V,H,P,A>::insert_new(std::size_t hash, const K& key, Args&&... args) {
+    double load_factor = static_cast<double>(sz + 1) / cap;
+    if (load_factor >= max_load_factor)
+        rehash(P::next_size(cap + 1));
+
+    Node*& head = buckets[P::index(hash, cap)];
+    head = pool.create(hash, head, key, std::forward<Args>(args)...);
+    ++sz;
+    return head;
+}
+
+
+// If the key already exists, its value gets updated
+template <typename K, typename V, typename H, typename P, typename A>
+void StableMap<K,V,H,P,A>::insert(const K& key, const V& value) {
+    if (Node* n = lookup(key))
+        n->data.second = value;
+    else
+        insert_new(hash_function(key), key, value);
+}
+
+
+template <typename K, typename V, typename H, typename P, typename A>
+template <typename... Args>
+std::pair<typename StableMap<K,V,H,P,A>::iterator, bool> StableMap<K,V,H,P,A>::try_emplace(const K& key, Args&&... args) {
+    if (Node* n = lookup(key))
+        return {iterator{this, P::index(n->hash, cap), n}, false};
+    Node* n = insert_new(hash_function(key), key, std::forward<Args>(args)...);
+    return {iterator{this, P::index(n->hash, cap), n}, true};
+}
+
+
+template <typename K, typename V, typename H, typename P, typename A>
+void StableMap<K,V,H,P,A>::remove(const K& key) {
+    std::size_t hash = hash_function(key);
+    for (Node** link = &buckets[P::index(hash, cap)]; *link; link = &(*link)->next) {
+        Node* n = *link;
+        if (n->hash == hash && n->data.first == key) {
+            *link = n->next;
+            pool.destroy(n);
+            --sz;
+            return;
+        }
+    }
+    throw std::runtime_error("no such key in the map");
+}
+
+
+// The nodes go back to the pool, which keeps its memory for the next inserts
+template <typename K, typename V, typename H, typename P, typename A>
+void StableMap<K,V,H,P,A>::clear() {
+    for (std::size_t b = 0; b < cap; ++b) {
+        Node* n = buckets[b];
+        while (n) {
+            Node* next = n->next;
+            pool.destroy(n);
+            n = next;
+        }
+        buckets[b] = nullptr;
+    }
+    sz = 0;
+}
+
+
+template <typename K, typename V, typename H, typename P, typename A>
+V& StableMap<K,V,H,P,A>::operator[](const K& key) {
+    if (Node* n = lookup(key))
+        return n->data.second;
+    return insert_new(hash_function(key), key)->data.second;
+}
+
+
+template <typename K, typename V, typename H, typename P, typename A>
+const V& StableMap<K,V,H,P,A>::operator[](const K& key) const {
+    if (Node* n = lookup(key))
+        return n->data.second;
+    throw std::runtime_error("no such key in the map");
+}
+
+
+// The copy is made with the allocator that *this will end up with, then the two are exchanged
+template <typename K, typename V, typename H, typename P, typename A>
+StableMap<K,V,H,P,A>& StableMap<K,V,H,P,A>::operator=(const StableMap& rhs) {
+    if (this != &rhs) {
+        StableMap temp(rhs, propagate_on_copy_v<A> && propagate_on_swap_v<A> ? rhs.get_allocator() : get_allocator());
+        temp.swap(*this);
+    }
+    return *this;
+}
+
+
+// The nodes of rhs can only change owner if our allocator can free them, otherwise they are copied
+template <typename K, typename V, typename H, typename P, typename A>
+StableMap<K,V,H,P,A>& StableMap<K,V,H,P,A>::operator=(StableMap&& rhs) noexcept(always_equal_v<A>) {
+    if (always_equal_v<A> || get_allocator() == rhs.get_allocator())
+        rhs.swap(*this);
+    else {
+        *this = rhs;
+        rhs.clear();
+    }
+    return *this;
+}
+
+
+template <typename K, typename V, typename H, typename P, typename A>
+typename StableMap<K,V,H,P,A>::iterator StableMap<K,V,H,P,A>::find(const K& key) {
+    Node* n = lookup(key);
+    return n ? iterator{this, P::index(n->hash, cap), n} : end();
+}
+
+
+template <typename K, typename V, typename H, typename P, typename A>
+typename StableMap<K,V,H,P,A>::const_iterator StableMap<K,V,H,P,A>::find(const K& key) const {
+    Node* n = lookup(key);
+    return n ? const_iterator{this, P::index(n->hash, cap), n} : cend();
+}
+
+
+template <typename K, typename V, typename H, typename P, typename A>
+bool operator==(const StableMap<K,V,H,P,A>& lhs, const StableMap<K,V,H,P,A>& rhs) {
+    if (lhs.size() != rhs.size())
+        return false;
+
+    for (auto iter = lhs.cbegin(); iter != lhs.cend(); ++iter) {
+        auto found = rhs.find(iter->first);
+        if (found == rhs.cend() || found->second != iter->second)
+            return false;
+    }
+    return true;
+}
+
+
+template <typename K, typename V, typename H, typename P, typename A>
+bool operator!=(const StableMap<K,V,H,P,A>& lhs, const StableMap<K,V,H,P,A>& rhs) {
+    return !(lhs == rhs);
+}
+
+
+// A null node stands for the first node of bucket pos; at pos == cap the iterator is end()
+template <typename K, typename V, typename H, typename P, typename A>
+class Stable_Map_Iterator {
+private:
+    using Node = typename StableMap<K,V,H,P,A>::Node;
+
+    StableMap<K,V,H,P,A>* map;
+    std::size_t pos;
+    Node* node;
+
+public:
+    using iterator_category = std::forward_iterator_tag;
+    using difference_type = std::ptrdiff_t;
+    using value_type = std::pair<K, V>;
+    using pointer = value_type*;
+    using reference = value_type&;
+
+    Stable_Map_Iterator() : map{}, pos{}, node{} {}
+
+    Stable_Map_Iterator(StableMap<K,V,H,P,A>* in_map, std::size_t in_pos, Node* in_node)
+        : map{in_map}, pos{in_pos}, node{in_node}
+    {
+        if (!node && pos < map->cap)
+            node = map->buckets[pos];
+    }
+
+    reference operator*() const { return node->data;  }
+
+    pointer operator->()  const { return &node->data; }
+
+    Stable_Map_Iterator& operator++() {
+        node = node->next;
+        while (!node && ++pos < map->cap)
+            node = map->buckets[pos];
+        return *this;
+    }
+
+    Stable_Map_Iterator operator++(int) {
+        Stable_Map_Iterator temp = *this;
+        operator++();
+        return temp;
+    }
+
+    bool operator==(const Stable_Map_Iterator& rhs) const {
+        return map == rhs.map && pos == rhs.pos && node == rhs.node;
+    }
+
+    bool operator!=(const Stable_Map_Iterator& rhs) const {
+        return !operator==(rhs);
+    }
+};
+
+
+template <typename K, typename V, typename H, typename P, typename A>
+class Const_Stable_Map_Iterator {
+private:
+    using Node = typename StableMap<K,V,H,P,A>::Node;
+
+    const StableMap<K,V,H,P,A>* map;
+    std::size_t pos;
+    const Node* node;
+
+public:
+    using iterator_category = std::forward_iterator_tag;
+    using difference_type = std::ptrdiff_t;
+    using value_type = const std::pair<K, V>;
+    using pointer = value_type*;
+    using reference = value_type&;
+
+    Const_Stable_Map_Iterator() : map{}, pos{}, node{} {}
+
+    Const_Stable_Map_Iterator(const StableMap<K,V,H,P,A>* in_map, std::size_t in_pos, const Node* in_node)
+        : map{in_map}, pos{in_pos}, node{in_node}
+    {
+        if (!node && pos < map->cap)
+            node = map->buckets[pos];
+    }
+
+    reference operator*() const { return node->data;  }
+
+    pointer operator->()  const { return &node->data; }
+
+    Const_Stable_Map_Iterator& operator++() {
+        node = node->next;
+        while (!node && ++pos < map->cap)
+            node = map->buckets[pos];
+        return *this;
+    }
+
+    Const_Stable_Map_Iterator operator++(int) {
+        Const_Stable_Map_Iterator temp = *this;
+        operator++();
+        return temp;
+    }
+
+    bool operator==(const Const_Stable_Map_Iterator& rhs) const {
+        return map == rhs.map && pos == rhs.pos && node == rhs.node;
+    }
+
+    bool operator!=(const Const_Stable_Map_Iterator& rhs) const {
+        return !operator==(rhs);
+    }
+};
+
+}
@@ -0,0 +1,365 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include "Parallel.hpp"
+#include "Vector.hpp"
+
+namespace data_structures {
+
+namespace parallel {
+
+// A fixed set of worker threads that share out tasks by work stealing. Every worker has a queue
+// of its own: the tasks it spawns go to the back of it and it takes its next task from the back
+// too, so it goes on with the work it split last, while idle workers steal from the front of the
+// others' queues, where the oldest and largest pieces of work are. Threads that are not workers
+// of the pool share queue 0. A thread that waits for its tasks runs tasks in the meantime, so
+// tasks can split their work and wait for the parts without tying up the pool.
+class ThreadPool {
+public:
+    // threads counts the calling thread, which works while it waits, so threads - 1 workers are started
+    explicit ThreadPool(unsigned threads = default_threads());
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    unsigned size() const { return no_queues; }
+
+    // Calls f(begin, end) on pieces of [0, n) of at most grain indices and returns once every call
+    // has returned. The range is halved lazily, only as other threads come to steal part of it.
+    template <typename F>
+    void for_range(std::size_t n, std::size_t grain, F&& f);
+
+    // Calls f() and g(), possibly at the same time, and returns once both have returned
+    template <typename F, typename G>
+    void invoke(F&& f, G&& g);
+
+    // Both rethrow the first exception one of the calls threw, after all of them are done
+
+private:
+    // The tasks a for_range() or invoke() spawned and are not done yet
+    struct Group {
+        std::atomic<std::size_t> pending {};
+        std::atomic<bool> failed {};
+        std::mutex error_lock;
+        std::exception_ptr error;
+    };
+
+    struct Task {
+        Group* group;
+        explicit Task(Group& in_group) : group{&in_group} {}
+        virtual ~Task() = default;
+        virtual void run() = 0;
+    };
+
+    template <typename F> struct RangeTask;
+    template <typename G> struct CallTask;
+
+    // tasks[head, size) are queued, the ones before head have been stolen
+    struct Queue {
+        std::mutex lock;
+        Vector<Task*> tasks;
+        std::size_t head {};
+    };
+
+    struct Worker {
+        ThreadPool* pool;
+        unsigned index;
+    };
+
+    std::unique_ptr<Queue[]> queues;
+    unsigned no_queues;
+    Vector<std::thread> workers;
+
+    std::atomic<std::size_t> queued {};
+    std::atomic<unsigned> sleeping {};
+    bool stopping {};
+    std::mutex sleep_lock;
+    std::condition_variable wake;
+
+    static Worker& p_current() {
+        static thread_local Worker current {};
+        return current;
+    }
+    unsigned p_queue_index() const { return p_current().pool == this ? p_current().index : 0; }
+
+    void p_work(unsigned index);
+    void p_spawn(Task* task);
+    Task* p_take(unsigned index);
+    static Task* p_pop(Queue& queue);
+    static Task* p_steal(Queue& queue);
+    void p_execute(Task* task);
+    static void p_fail(Group& group);
+    void p_wait(Group& group);
+
+    template <typename F>
+    void p_run_range(Group& group, F& f, std::size_t begin, std::size_t end, std::size_t grain);
+};
+
+
+template <typename F>
+struct ThreadPool::RangeTask : Task {
+    ThreadPool* pool;
+    F* f;
+    std::size_t begin;
+    std::size_t end;
+    std::size_t grain;
+
+    RangeTask(Group& in_group, ThreadPool* in_pool, F* in_f, std::size_t in_begin, std::size_t in_end, std::size_t in_grain)
+        : Task(in_group), pool{in_pool}, f{in_f}, begin{in_begin}, end{in_end}, grain{in_grain} {}
+
+    void run() override { pool->p_run_range(*group, *f, begin, end, grain); }
+};
+
+
+template <typename G>
+struct ThreadPool::CallTask : Task {
+    G* g;
+
+    CallTask(Group& in_group, G* in_g) : Task(in_group), g{in_g} {}
+
+    void run() override { (*g)(); }
+};
+
+
+inline ThreadPool::ThreadPool(unsigned threads)
+    : queues{new Queue[threads ? threads : 1]}, no_queues{threads ? threads : 1}
+{
+    workers.reserve(no_queues - 1);
+    try {
+        for (unsigned i = 1; i < no_queues; ++i)
+            workers.push_back(std::thread{[this, i] { p_work(i); }});
+    }
+    catch (...) {
+        {
+            std::lock_guard<std::mutex> guard(sleep_lock);
+            stopping = true;
+        }
+        wake.notify_all();
+        for (std::size_t i = 0; i < workers.size(); ++i)
+            workers[i].join();
+        throw;
+    }
+}
+
+
+// Every for_range() and invoke() has returned by now, so there is nothing left to run
+inline ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> guard(sleep_lock);
+        stopping = true;
+    }
+    wake.notify_all();
+    for (std::size_t i = 0; i < workers.size(); ++i)
+        workers[i].join();
+}
+
+
+// A worker that finds nothing to run sleeps until a task is spawned. It counts itself as sleeping
+// before it checks for tasks one last time, and p_spawn() queues a task before it checks for
+// sleepers, so one of the two always sees the other.
+inline void ThreadPool::p_work(unsigned index) {
+    p_current() = Worker{this, index};
+    while (true) {
+        if (Task* task = p_take(index)) {
+            p_execute(task);
+            continue;
+        }
+
+        std::unique_lock<std::mutex> guard(sleep_lock);
+        ++sleeping;
+        wake.wait(guard, [this] { return queued.load() > 0 || stopping; });
+        --sleeping;
+        if (stopping)
+            return;
+    }
+}
+
+
+// The task is counted in its group before it can be run, so a waiting thread cannot miss it
+inline void ThreadPool::p_spawn(Task* task) {
+    task->group->pending.fetch_add(1);
+    Queue& queue = queues[p_queue_index()];
+    {
+        std::lock_guard<std::mutex> guard(queue.lock);
+        try {
+            queue.tasks.push_back(task);
+        }
+        catch (...) {
+            task->group->pending.fetch_sub(1);
+            delete task;
+            throw;
+        }
+    }
+    ++queued;
+    if (sleeping.load() > 0) {
+        std::lock_guard<std::mutex> guard(sleep_lock);
+        wake.notify_one();
+    }
+}
+
+
+// The thread's own queue first, then the others, starting from the next one so that thieves spread out
+inline ThreadPool::Task* ThreadPool::p_take(unsigned index) {
+    if (queued.load() == 0)
+        return nullptr;
+    if (Task* task = p_pop(queues[index]))
+        return task;
+    for (unsigned i = 1; i < no_queues; ++i)
+        if (Task* task = p_steal(queues[(index + i) % no_queues]))
+            return task;
+    return nullptr;
+}
+
+
+inline ThreadPool::Task* ThreadPool::p_pop(Queue& queue) {
+    std::lock_guard<std::mutex> guard(queue.lock);
+    if (queue.tasks.size() == queue.head)
+        return nullptr;
+
+    Task* task = queue.tasks.back();
+    queue.tasks.pop_back();
+    if (queue.tasks.size() == queue.head) {
+        queue.tasks.clear();
+        queue.head = 0;
+    }
+    return task;
+}
+
+
+inline ThreadPool::Task* ThreadPool::p_steal(Queue& queue) {
+    std::lock_guard<std::mutex> guard(queue.lock);
+    if (queue.tasks.size() == queue.head)
+        return nullptr;
+
+    Task* task = queue.tasks[queue.head++];
+    if (queue.tasks.size() == queue.head) {
+        queue.tasks.clear();
+        queue.head = 0;
+    }
+    return task;
+}
+
+
+// The group may be gone as soon as its last task is counted out, so that comes last
+inline void ThreadPool::p_execute(Task* task) {
+    --queued;
+    Group* group = task->group;
+    try {
+        task->run();
+    }
+    catch (...) {
+        p_fail(*group);
+    }
+    delete task;
+    group->pending.fetch_sub(1);
+}
+
+
+inline void ThreadPool::p_fail(Group& group) {
+    std::lock_guard<std::mutex> guard(group.error_lock);
+    if (!group.error)
+        group.error = std::current_exception();
+    group.failed = true;
+}
+
+
+inline void ThreadPool::p_wait(Group& group) {
+    unsigned index = p_queue_index();
+    while (group.pending.load() > 0) {
+        if (Task* task = p_take(index))
+            p_execute(task);
+        else
+            std::this_thread::yield();
+    }
+    if (group.error)
+        std::rethrow_exception(group.error);
+}
+
+
+// Runs the first half of the range itself and leaves the second one to be stolen, until the
+// piece left is small enough. Once a call has failed the pieces not started yet are skipped.
+template <typename F>
+void ThreadPool::p_run_range(Group& group, F& f, std::size_t begin, std::size_t end, std::size_t grain) {
+    while (end - begin > grain) {
+        std::size_t mid = begin + (end - begin) / 2;
+        p_spawn(new RangeTask<F>{group, this, &f, mid, end, grain});
+        end = mid;
+    }
+    if (!group.failed)
+        f(begin, end);
+}
+
+
+template <typename F>
+void ThreadPool::for_range(std::size_t n, std::size_t grain, F&& f) {
+    if (grain == 0)
+        grain = 1;
+    if (no_queues == 1 || n <= grain) {
+        for (std::size_t begin = 0; begin < n; begin += grain)
+            f(begin, n - begin > grain ? begin + grain : n);
+        return;
+    }
+
+    using Fn = std::remove_reference_t<F>;
+    Group group;
+    try {
+        p_run_range<Fn>(group, f, 0, n, grain);
+    }
+    catch (...) {
+        p_fail(group);
+    }
+    p_wait(group);
+}
+
+
+template <typename F, typename G>
+void ThreadPool::invoke(F&& f, G&& g) {
+    if (no_queues == 1) {
+        f();
+        g();
+        return;
+    }
+
+    using Gn = std::remove_reference_t<G>;
+    Group group;
+    try {
+        p_spawn(new CallTask<Gn>{group, &g});
+        f();
+    }
+    catch (...) {
+        p_fail(group);
+    }
+    p_wait(group);
+}
+
+
+// The pool the parallel algorithms run on unless they are given another, with default_threads() threads
+inline ThreadPool& default_pool() {
+    static ThreadPool pool;
+    return pool;
+}
+
+
+// Calls task(t) for every t in [0, parts) on pool and returns once all the calls have returned.
+// The parts are taken by whichever threads of the pool are free, the calling thread among them.
+// If tasks throw, the first exception is rethrown after the others are done; the parts that had
+// not started by then are skipped.
+template <typename F>
+void fork_join(ThreadPool& pool, unsigned parts, F&& task) {
+    pool.for_range(parts, 1, [&task](std::size_t begin, std::size_t end) {
+        for (std::size_t t = begin; t < end; ++t)
+            task(static_cast<unsigned>(t));
+    });
+}
+
+}
+
+}
@@ -2,14 +2,23 @@
 
 #include <string>
 #include <initializer_list>
+#include <memory>
+#include "Allocator.hpp"
 
 namespace data_structures {
 
-class Trie {
+// The nodes come from A rebound to the node type (see Allocator.hpp)
+template <typename A = std::allocator<char>>
+class BasicTrie {
 public:
-	Trie();
-	explicit Trie(const std::initializer_list<std::string>& words);
-	~Trie();
+	using allocator_type = A;
+
+	BasicTrie();
+	explicit BasicTrie(const A& in_alloc);
+	explicit BasicTrie(const std::initializer_list<std::string>& words, const A& in_alloc = A());
+	~BasicTrie();
+
+	A get_allocator() const { return A(alloc); }
 	
 	void insert(const std::string& word);
 	void remove(const std::string& word);
@@ -22,17 +31,20 @@ public:
 	
 private:
 	struct TrieNode;
+	using node_allocator = rebind_alloc_t<A, TrieNode>;
 
+	DATA_STRUCTURES_NO_UNIQUE_ADDRESS node_allocator alloc;
 	TrieNode* root;
 	std::size_t sz;
 
 	TrieNode* get_TrieNode(const std::string& word);
 	void destroy(TrieNode* node);
-	TrieNode* p_remove(TrieNode* node, const std::string& word, int depth);
+	TrieNode* p_remove(TrieNode* node, const std::string& word, int depth = 0);
 };
 
 
-struct Trie::TrieNode {
+template <typename A>
+struct BasicTrie<A>::TrieNode {
 	char c;
 	TrieNode* children[26] = { nullptr };
 	bool isWord;
@@ -48,25 +60,34 @@ struct Trie::TrieNode {
 };
 
 
-Trie::Trie() 
-	: root{new TrieNode{'\0'}}, sz{} {}
+template <typename A>
+BasicTrie<A>::BasicTrie() 
+	: BasicTrie(A()) {}
+
+
+template <typename A>
+BasicTrie<A>::BasicTrie(const A& in_alloc) 
+	: alloc{in_alloc}, root{create_node(alloc, '\0')}, sz{} {}
 	
 
-Trie::Trie(const std::initializer_list<std::string>& words) 
-	: root{new TrieNode{'\0'}}, sz{}
+template <typename A>
+BasicTrie<A>::BasicTrie(const std::initializer_list<std::string>& words, const A& in_alloc) 
+	: BasicTrie(in_alloc)
 {
 	for (auto& w : words)
 		insert(w);		
 }
 
 
-Trie::~Trie() {
+template <typename A>
+BasicTrie<A>::~BasicTrie() {
 	destroy(root);
 	sz = 0;
 }
 
 
-Trie::TrieNode* Trie::get_TrieNode(const std::string& word) {
+template <typename A>
+typename BasicTrie<A>::TrieNode* BasicTrie<A>::get_TrieNode(const std::string& word) {
 	TrieNode* current = root;
 	for (char c : word) {
 		if (!current->children[c - 'a'])	
@@ -77,15 +98,17 @@ Trie::TrieNode* Trie::get_TrieNode(const std::string& word) {
 }
 
 
-void Trie::destroy(TrieNode* node) {
+template <typename A>
+void BasicTrie<A>::destroy(TrieNode* node) {
 	for (TrieNode* n : node->children)
 		if (n) 
 			destroy(n);
-	delete node;
+	destroy_node(alloc, node);
 }
 
 
-Trie::TrieNode* Trie::p_remove(TrieNode* node, const std::string& word, int depth = 0) {
+template <typename A>
+typename BasicTrie<A>::TrieNode* BasicTrie<A>::p_remove(TrieNode* node, const std::string& word, int depth) {
     if (!node)
         return nullptr;
  
@@ -99,7 +122,7 @@ Trie::TrieNode* Trie::p_remove(TrieNode* node, const std::string& word, int dept
  
         // If given is not prefix of any other word
         if (node->is_leaf()) {
-            delete node;
+            destroy_node(alloc, node);
             node = nullptr;
         }
 
@@ -114,7 +137,7 @@ Trie::TrieNode* Trie::p_remove(TrieNode* node, const std::string& word, int dept
     // If node does not have any child (its only child got
     // deleted), and it is not end of another word.
     if (node->is_leaf() && node->isWord == false) {
-        delete node;
+        destroy_node(alloc, node);
         node = nullptr;
     }
  
@@ -122,14 +145,15 @@ Trie::TrieNode* Trie::p_remove(TrieNode* node, const std::string& word, int dept
 }
 
 
-void Trie::insert(const std::string& word) {
+template <typename A>
+void BasicTrie<A>::insert(const std::string& word) {
 	if (search(word))  // To ensure the same word did not already exist in the Trie
 		return;
 	
 	TrieNode* current = root;
 	for (char c : word) {
 		if (!current->children[c - 'a']) 
-			current->children[c - 'a'] = new TrieNode{c};
+			current->children[c - 'a'] = create_node(alloc, c);
 		current = current->children[c - 'a'];
 	}
 
@@ -138,24 +162,30 @@ void Trie::insert(const std::string& word) {
 }
 
 
-void Trie::remove(const std::string& word) {
+template <typename A>
+void BasicTrie<A>::remove(const std::string& word) {
 	if (!search(word))
 		return;
 	p_remove(root, word);
 }
 
 
-bool Trie::search(const std::string& word) {
+template <typename A>
+bool BasicTrie<A>::search(const std::string& word) {
 	TrieNode* n = get_TrieNode(word);
 	return n != nullptr && n->isWord;
 }
 
 
-bool Trie::starts_with(const std::string& word) {
+template <typename A>
+bool BasicTrie<A>::starts_with(const std::string& word) {
 	TrieNode* n = get_TrieNode(word);
 	return n != nullptr;
 }
 
+
+using Trie = BasicTrie<>;
+
 }
 
 
@@ -2,31 +2,46 @@
 
 #include <algorithm>
 #include <cstddef>
+#include <cstdlib>
+#include <cstring>
 #include <initializer_list>
 #include <iterator>
+#include <memory>
 #include <new>
 #include <stdexcept>
+#include <type_traits>
 #include <utility>
+#include "Allocator.hpp"
+#include "Simd.hpp"
 
 namespace data_structures {
 
 template <typename T> class Vector_Iterator;
 template <typename T> class Const_Vector_Iterator;
 
-template <typename T>
+// A is the allocator of the elements (see Allocator.hpp)
+template <typename T, typename A = std::allocator<T>>
 class Vector {
+    using alloc_traits = std::allocator_traits<A>;
+
 public:
     using iterator = Vector_Iterator<T>;
     using const_iterator = Const_Vector_Iterator<T>;
+    using allocator_type = A;
 
-    Vector();
-    explicit Vector(std::size_t size);
-    Vector(std::size_t size, const T& value);
-    explicit Vector(const std::initializer_list<T>& values);
+    Vector() noexcept(noexcept(A()));
+    explicit Vector(const A& in_alloc) noexcept;
+    explicit Vector(std::size_t size, const A& in_alloc = A());
+    Vector(std::size_t size, const T& value, const A& in_alloc = A());
+    explicit Vector(const std::initializer_list<T>& values, const A& in_alloc = A());
     Vector(const Vector& vec);
+    Vector(const Vector& vec, const A& in_alloc);
     Vector(Vector&& vec) noexcept;
+    Vector(Vector&& vec, const A& in_alloc);
     ~Vector();
 
+    A get_allocator() const { return alloc; }
+
     void push_back(const T& value);
     void push_back(T&& value);
     void pop_back();
@@ -34,9 +49,30 @@ public:
     template <typename ... Args>
     T& emplace_back(Args&& ... args);
 
+    // Both return an iterator to the element that follows the erased ones
     iterator erase(iterator pos);
+    iterator erase(iterator first, iterator last);
+
+    // These return an iterator to the first inserted element. pos may be end().
+    // The elements after pos are shifted once per call, however many are inserted,
+    // and trivially copyable ones are shifted with a single memmove().
     iterator insert(iterator pos, const T& value);
+    iterator insert(iterator pos, T&& value);
+    template <typename InputIt, typename = typename std::iterator_traits<InputIt>::iterator_category>
+    iterator insert(iterator pos, InputIt first, InputIt last);
+
+    // Appends every element of range (anything std::begin/std::end accept)
+    template <typename Range>
+    void append_range(const Range& range);
+
+    // For numbers these run on SIMD instructions (see Simd.hpp), for other types they compare
+    // with operator== and operator<. min() and max() throw if the vector is empty.
     iterator find(const T& key);
+    const_iterator find(const T& key) const;
+    std::size_t count(const T& key) const;
+    T min() const;
+    T max() const;
+    T sum() const;
 
     T& front();
     T& back();
@@ -56,11 +92,14 @@ public:
     T&       operator[] (std::size_t index);
     const T& operator[] (std::size_t index) const;
     Vector&  operator=  (const Vector& rhs);
-    Vector&  operator=  (Vector&& rhs) noexcept;
+    Vector&  operator=  (Vector&& rhs) noexcept(propagate_on_move_v<A> || always_equal_v<A>);
 
     iterator begin() { return iterator{data};      }
     iterator end()   { return iterator{data + sz}; }
 
+    const_iterator begin() const { return const_iterator{data};      }
+    const_iterator end()   const { return const_iterator{data + sz}; }
+
     const_iterator cbegin() const { return const_iterator{data};      }
     const_iterator cend()   const { return const_iterator{data + sz}; }
 
@@ -68,217 +107,422 @@ private:
     T* data;
     std::size_t sz;
     std::size_t cap;
+    DATA_STRUCTURES_NO_UNIQUE_ADDRESS A alloc;
     static constexpr short min_cap {10};
     static constexpr short capacity_factor {2};
+
+    // Trivially copyable elements can be moved around as raw bytes, with memmove()
+    static constexpr bool relocatable = std::is_trivially_copyable_v<T>;
+
+    // With the default allocator their buffers also come from malloc() and grow with realloc(),
+    // which may extend a block in place and (in glibc) moves the large, mmap()ed blocks by
+    // remapping their pages with mremap() rather than copying them.
+    static constexpr bool reallocatable = relocatable && std::is_same_v<A, std::allocator<T>>
+                                       && alignof(T) <= alignof(std::max_align_t);
+
+    // Other allocators may know how to resize a buffer without copying it (see has_reallocate_v)
+    static constexpr bool allocator_reallocates = relocatable && has_reallocate_v<A>;
+
     void p_realloc(std::size_t n);
+    std::size_t p_grown_capacity() const { return cap ? cap * capacity_factor : min_cap; }
+    T* p_allocate(std::size_t n);
+    void p_free(T* p, std::size_t n);
+    void p_deallocate() { p_free(data, cap); }
+
+    template <typename ... Args>
+    void p_construct(T* p, Args&& ... args) { alloc_traits::construct(alloc, p, std::forward<Args>(args)...); }
+    void p_destroy(T* p) { alloc_traits::destroy(alloc, p); }
+    void p_swap_storage(Vector& vec) noexcept;
+
+    std::size_t p_index(iterator pos) const;
+    iterator p_insert_at(std::size_t index, T&& value);
+    void p_open_gap(std::size_t index, std::size_t count);
+    void p_close_gap(std::size_t index, std::size_t count);
 };
 
 
-template <typename T>
-Vector<T>::Vector() 
-    : sz{}, cap{min_cap}
+template <typename T, typename A>
+T* Vector<T,A>::p_allocate(std::size_t n) {
+    if (!n)
+        return nullptr;
+    if constexpr (reallocatable) {
+        void* p = std::malloc(n * sizeof(T));
+        if (!p)
+            throw std::bad_alloc();
+        return static_cast<T*>(p);
+    }
+    else
+        return alloc_traits::allocate(alloc, n);
+}
+
+
+// Releases a buffer of n elements that came from p_allocate
+template <typename T, typename A>
+void Vector<T,A>::p_free(T* p, std::size_t n) {
+    if (!p)
+        return;
+    if constexpr (reallocatable)
+        std::free(p);
+    else
+        alloc_traits::deallocate(alloc, p, n);
+}
+
+
+// Memory is only allocated once the first element is inserted (or reserved),
+// so empty vectors are cheap to create and destroy
+template <typename T, typename A>
+Vector<T,A>::Vector() noexcept(noexcept(A()))
+    : data{}, sz{}, cap{}, alloc{} {}
+
+
+template <typename T, typename A>
+Vector<T,A>::Vector(const A& in_alloc) noexcept
+    : data{}, sz{}, cap{}, alloc{in_alloc} {}
+
+
+// The elements are value-initialized
+template <typename T, typename A>
+Vector<T,A>::Vector(std::size_t size, const A& in_alloc)
+    : Vector(in_alloc)
 {
-    data = (T*)::operator new(cap * sizeof(T));
+    resize(size);
 }
 
 
-template <typename T>
-Vector<T>::Vector(std::size_t size)
-    : sz{size}, cap{ size < min_cap ? min_cap : size }
+template <typename T, typename A>
+Vector<T,A>::Vector(std::size_t size, const T& value, const A& in_alloc)
+    : Vector(in_alloc)
 {
-    data = (T*)::operator new(cap * sizeof(T));
+    resize(size, value);
 }
 
 
-template <typename T>
-Vector<T>::Vector(std::size_t size, const T& value)
-    : sz{size}, cap{ sz < min_cap ? min_cap : sz }
+template <typename T, typename A>
+Vector<T,A>::Vector(const std::initializer_list<T>& values, const A& in_alloc)
+    : Vector(in_alloc)
 {
-    data = (T*)::operator new(cap * sizeof(T));
-    for (std::size_t i = 0; i < sz; ++i)
-        new (&data[i]) T(value);
+    reserve(values.size() < min_cap ? min_cap : values.size());
+    for (const T& v : values)
+        p_construct(&data[sz++], v);
 }
 
 
-template <typename T>
-Vector<T>::Vector(const std::initializer_list<T>& values)
-    : sz{values.size()}, cap{ sz < min_cap ? min_cap : sz }
+template <typename T, typename A>
+Vector<T,A>::Vector(const Vector& vec)
+    : Vector(vec, alloc_traits::select_on_container_copy_construction(vec.alloc)) {}
+
+
+template <typename T, typename A>
+Vector<T,A>::Vector(const Vector& vec, const A& in_alloc)
+    : Vector(in_alloc)
 {
-    data = (T*)::operator new(cap * sizeof(T));
-    std::size_t i {};
-    for (auto v : values)
-        new (&data[i++]) T(v);
+    reserve(vec.sz ? vec.cap : 0);
+    for (; sz < vec.sz; ++sz)
+        p_construct(&data[sz], vec[sz]);
 }
 
 
-template <typename T>
-Vector<T>::Vector(const Vector& vec) 
-    : sz{vec.sz}, cap{vec.cap}
+// Steals the buffer of vec, which is left empty and without memory
+template <typename T, typename A>
+Vector<T,A>::Vector(Vector&& vec) noexcept
+    : data{vec.data}, sz{vec.sz}, cap{vec.cap}, alloc{std::move(vec.alloc)}
 {
-    data = (T*)::operator new(cap * sizeof(T));
-    for (std::size_t i = 0; i < sz; ++i)
-        new (&data[i]) T(vec[i]);
+    vec.data = nullptr;
+    vec.sz = 0;
+    vec.cap = 0;
 }
 
 
-template <typename T>
-Vector<T>::Vector(Vector&& vec) noexcept
-    : data{}, sz{}, cap{min_cap}
+// The buffer of vec can only be taken over if in_alloc can free it, otherwise the elements are moved one by one
+template <typename T, typename A>
+Vector<T,A>::Vector(Vector&& vec, const A& in_alloc)
+    : Vector(in_alloc)
 {
-    vec.swap(*this);
+    if (alloc == vec.alloc)
+        p_swap_storage(vec);
+    else {
+        reserve(vec.sz);
+        for (; sz < vec.sz; ++sz)
+            p_construct(&data[sz], std::move(vec[sz]));
+        vec.clear();
+    }
 }
 
 
-template <typename T>
-Vector<T>::~Vector() {
+template <typename T, typename A>
+Vector<T,A>::~Vector() {
     clear();
-    ::operator delete(data, cap * sizeof(T));
+    p_deallocate();
 }
 
 
-template <typename T>
-void Vector<T>::p_realloc(std::size_t n) {
-    T* new_data = (T*)::operator new(n * sizeof(T));
+// Other elements are moved to the new buffer one by one, or copied if their move constructor
+// may throw, so that an exception leaves the vector as it was.
+template <typename T, typename A>
+void Vector<T,A>::p_realloc(std::size_t n) {
+    if constexpr (reallocatable) {
+        if (n) {
+            void* p = std::realloc(data, n * sizeof(T));
+            if (!p)
+                throw std::bad_alloc();
+            data = static_cast<T*>(p);
+            if (n < sz)
+                sz = n;
+            cap = n;
+            return;
+        }
+    }
+    else if constexpr (allocator_reallocates) {
+        if (n && data) {
+            data = alloc.reallocate(data, cap, n);
+            if (n < sz)
+                sz = n;
+            cap = n;
+            return;
+        }
+    }
+
+    T* new_data = p_allocate(n);
 
     std::size_t old_sz = sz;
-    if (n < sz)
-        sz = n;
+    std::size_t new_sz = n < sz ? n : sz;
 
-    for (std::size_t i = 0; i < sz; ++i) 
-        new (&new_data[i]) T(std::move(data[i]));
+    std::size_t i {};
+    try {
+        for (; i < new_sz; ++i)
+            p_construct(&new_data[i], std::move_if_noexcept(data[i]));
+    }
+    catch (...) {
+        for (std::size_t j = 0; j < i; ++j)
+            p_destroy(&new_data[j]);
+        p_free(new_data, n);
+        throw;
+    }
 
     for (std::size_t i = 0; i < old_sz; ++i)
-        data[i].~T();
+        p_destroy(&data[i]);
 
-    ::operator delete(data, cap * sizeof(T));
+    p_deallocate();
     data = new_data;
+    sz = new_sz;
     cap = n;
 }
 
 
-template <typename T>
-void Vector<T>::push_back(const T& value) {
+template <typename T, typename A>
+void Vector<T,A>::push_back(const T& value) {
     if (sz >= cap)
-        p_realloc(cap * capacity_factor);
-    new (&data[sz]) T(value);
+        p_realloc(p_grown_capacity());
+    p_construct(&data[sz], value);
     ++sz;
 }
 
 
-template <typename T>
-void Vector<T>::push_back(T&& value) {
+template <typename T, typename A>
+void Vector<T,A>::push_back(T&& value) {
     if (sz >= cap)
-        p_realloc(cap * capacity_factor);
-    new (&data[sz]) T(std::move(value));
+        p_realloc(p_grown_capacity());
+    p_construct(&data[sz], std::move(value));
     ++sz;
 }
 
 
-template <typename T>
-void Vector<T>::pop_back() {
+template <typename T, typename A>
+void Vector<T,A>::pop_back() {
     if (sz > 0) {
         --sz;
-        data[sz].~T();
+        p_destroy(&data[sz]);
     }
 }
 
 
-template<typename T>
+template <typename T, typename A>
 template<typename ... Args>
-T& Vector<T>::emplace_back(Args&& ... args) {
+T& Vector<T,A>::emplace_back(Args&& ... args) {
     if (sz >= cap)
-        p_realloc(cap * capacity_factor);
-    new (&data[sz]) T(std::forward<Args>(args)...);
+        p_realloc(p_grown_capacity());
+    p_construct(&data[sz], std::forward<Args>(args)...);
     return data[sz++];
 }
 
 
-template<typename T>
-typename Vector<T>::iterator Vector<T>::erase(iterator pos) {
-    if (pos == end())
+// Index of pos, which must point into [begin(), end()]
+template <typename T, typename A>
+std::size_t Vector<T,A>::p_index(iterator pos) const {
+    T* p = pos.operator->();
+    if (p < data || p > data + sz)
         throw std::invalid_argument("invalid position");
+    return p - data;
+}
 
-    std::size_t i {};
 
-    for (auto iter = begin(); iter != pos; ++iter, ++i);
-    
-    std::size_t index {i};
+template <typename T, typename A>
+typename Vector<T,A>::iterator Vector<T,A>::erase(iterator pos) {
+    if (pos == end())
+        throw std::invalid_argument("invalid position");
+    return erase(pos, pos + 1);
+}
 
-    for (auto iter = pos + 1; iter != end(); ++iter, ++i)
-        data[i] = data[i + 1];
 
-    --sz;
-    data[sz].~T();
+template <typename T, typename A>
+typename Vector<T,A>::iterator Vector<T,A>::erase(iterator first, iterator last) {
+    std::size_t index = p_index(first);
+    std::size_t last_index = p_index(last);
+    if (last_index < index)
+        throw std::invalid_argument("invalid position");
 
-    if (index >= sz)
-        index = 0;
+    std::size_t count = last_index - index;
+    if (!count)
+        return first;
 
+    if constexpr (relocatable)
+        std::memmove(data + index, data + last_index, (sz - last_index) * sizeof(T));
+    else {
+        std::move(data + last_index, data + sz, data + index);
+        for (std::size_t i = sz - count; i < sz; ++i)
+            p_destroy(&data[i]);
+    }
+    sz -= count;
     return iterator{data + index};
 }
 
 
-template<typename T>
-typename Vector<T>::iterator Vector<T>::insert(iterator pos, const T& value){
-    if (pos == end())
-        throw std::invalid_argument("invalid position");
+// Makes room for count elements at index, moving the ones from there on count places to the right
+// and leaving the gap as raw memory. Only for relocatable types; capacity must suffice.
+template <typename T, typename A>
+void Vector<T,A>::p_open_gap(std::size_t index, std::size_t count) {
+    std::memmove(data + index + count, data + index, (sz - index) * sizeof(T));
+}
 
-    if (sz >= cap) {
-        std::size_t i {};
-        cap *= capacity_factor;
-        
-        T* temp = (T*)::operator new(cap * sizeof(T));
 
-        for (auto iter = begin(); iter != pos; ++iter, ++i)
-            new (&temp[i])  T(std::move(data[i]));
-        new (&temp[i]) T(value);
+// Undoes p_open_gap(index, count) when the gap could not be filled
+template <typename T, typename A>
+void Vector<T,A>::p_close_gap(std::size_t index, std::size_t count) {
+    std::memmove(data + index, data + index + count, (sz - index) * sizeof(T));
+}
 
-        std::size_t index {i++};
-        
-        for (std::size_t j = 0; j < sz - index; ++j, ++i)
-            new (&temp[i]) T(std::move(data[i - 1]));
 
+// value must not be an element of the vector, since they move
+template <typename T, typename A>
+typename Vector<T,A>::iterator Vector<T,A>::p_insert_at(std::size_t index, T&& value) {
+    if (sz >= cap)
+        p_realloc(p_grown_capacity());
+
+    if constexpr (relocatable) {
+        p_open_gap(index, 1);
+        try {
+            p_construct(&data[index], std::move(value));
+        }
+        catch (...) {
+            p_close_gap(index, 1);
+            throw;
+        }
+        ++sz;
+    }
+    else if (index == sz)
+        p_construct(&data[sz++], std::move(value));
+    else {
+        // The last element moves into the raw slot past the end and is counted right away,
+        // so if one of the moves after it throws every slot up to sz still holds an element
+        p_construct(&data[sz], std::move(data[sz - 1]));
+        ++sz;
+        std::move_backward(data + index, data + sz - 2, data + sz - 1);
+        data[index] = std::move(value);
+    }
+    return iterator{data + index};
+}
 
-        for (std::size_t i = 0; i < sz; ++i)
-            data[i].~T();
 
-        ::operator delete(data, cap * sizeof(T));
-        data = temp;
-        ++sz;
+template <typename T, typename A>
+typename Vector<T,A>::iterator Vector<T,A>::insert(iterator pos, const T& value) {
+    std::size_t index = p_index(pos);
+    T copy(value);  // value may be an element of the vector
+    return p_insert_at(index, std::move(copy));
+}
 
-        return iterator{data + index};
-    }
 
-    new (&data[sz]) T(std::move(data[sz - 1]));
+template <typename T, typename A>
+typename Vector<T,A>::iterator Vector<T,A>::insert(iterator pos, T&& value) {
+    std::size_t index = p_index(pos);
+    T temp(std::move(value));
+    return p_insert_at(index, std::move(temp));
+}
 
-    std::size_t i {1};
-    for(auto iter = end() - 1; iter != pos; --iter, ++i)
-        data[sz - i] = std::move(data[sz - i - 1]);
 
-    *pos = value;
-    ++sz;
+// A forward range is counted first, so that the vector grows at most once. Relocatable elements
+// are constructed straight into a gap opened with memmove, which is closed again if a copy throws.
+// Other elements, and those of a single pass range, are appended and then rotated into place:
+// a throwing copy then only has to destroy the new elements, and sz covers every element
+// while they rotate. The range must not come from the vector itself.
+template <typename T, typename A>
+template <typename InputIt, typename>
+typename Vector<T,A>::iterator Vector<T,A>::insert(iterator pos, InputIt first, InputIt last) {
+    std::size_t index = p_index(pos);
+
+    if constexpr (!std::is_base_of_v<std::forward_iterator_tag, typename std::iterator_traits<InputIt>::iterator_category>) {
+        std::size_t old_sz = sz;
+        for (; first != last; ++first)
+            emplace_back(*first);
+        std::rotate(data + index, data + old_sz, data + sz);
+    }
+    else {
+        std::size_t count = static_cast<std::size_t>(std::distance(first, last));
+        if (!count)
+            return iterator{data + index};
+
+        if (sz + count > cap) {
+            std::size_t grown = p_grown_capacity();
+            p_realloc(sz + count > grown ? sz + count : grown);
+        }
+
+        std::size_t at = relocatable ? index : sz;
+        if constexpr (relocatable)
+            p_open_gap(index, count);
+        std::size_t i = 0;
+        try {
+            for (; i < count; ++i, ++first)
+                p_construct(&data[at + i], *first);
+        }
+        catch (...) {
+            for (std::size_t j = 0; j < i; ++j)
+                p_destroy(&data[at + j]);
+            if constexpr (relocatable)
+                p_close_gap(index, count);
+            throw;
+        }
+        sz += count;
+        if constexpr (!relocatable)
+            std::rotate(data + index, data + sz - count, data + sz);
+    }
+    return iterator{data + index};
+}
 
-    return pos;
+
+template <typename T, typename A>
+template <typename Range>
+void Vector<T,A>::append_range(const Range& range) {
+    insert(end(), std::begin(range), std::end(range));
 }
 
 
-template <typename T>
-T& Vector<T>::front() {
+template <typename T, typename A>
+T& Vector<T,A>::front() {
     if (!sz)
         throw std::runtime_error("vector is empty");
     return data[0];
 }
 
 
-template <typename T>
-T& Vector<T>::back() {
+template <typename T, typename A>
+T& Vector<T,A>::back() {
     if (!sz)
         throw std::runtime_error("vector is empty");
     return data[sz - 1];
 }
 
 
-template <typename T>
-T& Vector<T>::at(std::size_t index) {
+template <typename T, typename A>
+T& Vector<T,A>::at(std::size_t index) {
     if (!sz)
         throw std::runtime_error("vector is empty");
     else if (index >= sz)
@@ -289,120 +533,158 @@ T& Vector<T>::at(std::size_t index) {
 
 // operator[] overloadata_structures do not check that index is not >= sz.
 // If the user wants an exception to be thrown if the index is invalid he should use at(std::size_t).
-template <typename T>
-T& Vector<T>::operator[] (std::size_t index) {
+template <typename T, typename A>
+T& Vector<T,A>::operator[] (std::size_t index) {
     return data[index];    
 }
 
 
-template <typename T>
-const T& Vector<T>::operator[] (std::size_t index) const {
+template <typename T, typename A>
+const T& Vector<T,A>::operator[] (std::size_t index) const {
     return data[index];    
 }
 
 
-// Because self assignment happens so rarely we don't check that this != &rhs
-template <typename T>
-Vector<T>& Vector<T>::operator=(const Vector& rhs) {
-    Vector temp{rhs};    // Exceptions may occur at this state so we create a temp vector and then swap it with *this
-    temp.swap(*this);    
+// Because self assignment happens so rarely we don't check that this != &rhs.
+// The copy is made with the allocator that *this will end up with, then the two are exchanged.
+template <typename T, typename A>
+Vector<T,A>& Vector<T,A>::operator=(const Vector& rhs) {
+    // Exceptions may occur at this state so we create a temp vector and then swap it with *this
+    if constexpr (propagate_on_copy_v<A>) {
+        Vector temp(rhs, rhs.alloc);
+        p_swap_storage(temp);
+        std::swap(alloc, temp.alloc);
+    }
+    else {
+        Vector temp(rhs, alloc);
+        p_swap_storage(temp);
+    }
     return *this;
 }
 
 
-template <typename T>
-Vector<T>& Vector<T>::operator=(Vector&& rhs) noexcept {
-    rhs.swap(*this);
+// The buffer of rhs is taken over if the allocator goes with it or is equal to ours,
+// otherwise its elements are moved into memory from our own allocator.
+template <typename T, typename A>
+Vector<T,A>& Vector<T,A>::operator=(Vector&& rhs) noexcept(propagate_on_move_v<A> || always_equal_v<A>) {
+    if constexpr (propagate_on_move_v<A>) {
+        Vector temp{std::move(rhs)};
+        p_swap_storage(temp);
+        std::swap(alloc, temp.alloc);
+    }
+    else {
+        Vector temp(std::move(rhs), alloc);
+        p_swap_storage(temp);
+    }
     return *this;
 }
 
 
-template <typename T>
-bool operator==(const Vector<T>& lhs, const Vector<T>& rhs) {
+// Integers, enums and pointers are equal exactly when their bytes are, so they are compared with memcmp()
+template <typename T, typename A>
+bool operator==(const Vector<T,A>& lhs, const Vector<T,A>& rhs) {
     if (lhs.size() != rhs.size())
         return false;
+    if (lhs.empty())
+        return true;
 
-    for (std::size_t i = 0; i < lhs.size(); ++i)
-        if (lhs[i] != rhs[i])
-            return false;
-        
-    return true;   
+    if constexpr (std::is_integral_v<T> || std::is_enum_v<T> || std::is_pointer_v<T>)
+        return std::memcmp(&lhs[0], &rhs[0], lhs.size() * sizeof(T)) == 0;
+    else if constexpr (simd::is_vectorizable_v<T>)
+        return simd::equal(&lhs[0], &rhs[0], lhs.size());
+    else {
+        for (std::size_t i = 0; i < lhs.size(); ++i)
+            if (lhs[i] != rhs[i])
+                return false;
+        return true;
+    }
 }
 
 
-template <typename T>
-bool operator!=(const Vector<T>& lhs, const Vector<T>& rhs) {
+template <typename T, typename A>
+bool operator!=(const Vector<T,A>& lhs, const Vector<T,A>& rhs) {
     return !(lhs == rhs);
 }
 
 
-template <typename T>
-void Vector<T>::clear() {
+template <typename T, typename A>
+void Vector<T,A>::clear() {
     for (std::size_t i = 0; i < sz; ++i)
-        data[i].~T();
+        p_destroy(&data[i]);
     sz = 0;
 }
 
 
-// Resizes the container so that it contains n elements
-template<typename T>
-void Vector<T>::resize(std::size_t n) {
+// Resizes the container so that it contains n elements, value-initializing the new ones
+template <typename T, typename A>
+void Vector<T,A>::resize(std::size_t n) {
     if (n < sz) {
         for (std::size_t i = n; i < sz; ++i)
-            data[i].~T();
+            p_destroy(&data[i]);
         sz = n;
+        return;
     }
-    else if (n > cap)
-        p_realloc(n);
-    else {
-        std::size_t diff {n - sz};
-        for (std::size_t i = 0; i < diff; ++i)
-            push_back(T{});
-    }
+    if (n > cap)
+        p_realloc(n < min_cap ? min_cap : n);
+    for (; sz < n; ++sz)
+        p_construct(&data[sz]);
 }
 
 
-template<typename T>
-void Vector<T>::resize(std::size_t n, const T& val) {
+template <typename T, typename A>
+void Vector<T,A>::resize(std::size_t n, const T& val) {
     if (n < sz) {
         for (std::size_t i = n; i < sz; ++i)
-            data[i].~T();
+            p_destroy(&data[i]);
         sz = n;
+        return;
     }
-    else if (n > cap)
-        p_realloc(n);
-    else {
-        std::size_t diff {n - sz};
-        for (std::size_t i = 0; i < diff; ++i)
-            push_back(val);
+    if (n > cap) {
+        T copy(val);  // val may be one of the elements
+        p_realloc(n < min_cap ? min_cap : n);
+        for (; sz < n; ++sz)
+            p_construct(&data[sz], copy);
+        return;
     }
+    for (; sz < n; ++sz)
+        p_construct(&data[sz], val);
 }
 
 
 // Requests that the vector capacity be at least enough to contain n elements
-template<typename T>
-void Vector<T>::reserve(std::size_t n) {
+template <typename T, typename A>
+void Vector<T,A>::reserve(std::size_t n) {
     if (n > cap)
         p_realloc(n);
 }
 
 
-template <typename T>
-void Vector<T>::swap(Vector<T>& vec) noexcept {
+template <typename T, typename A>
+void Vector<T,A>::p_swap_storage(Vector& vec) noexcept {
     std::swap(sz,   vec.sz);
     std::swap(cap,  vec.cap);
     std::swap(data, vec.data);
 }
 
 
-template <typename T>
-void swap(Vector<T>& lhs, Vector<T>& rhs) {
+template <typename T, typename A>
+void Vector<T,A>::swap(Vector<T,A>& vec) noexcept {
+    swap_allocators(alloc, vec.alloc);
+    p_swap_storage(vec);
+}
+
+
+template <typename T, typename A>
+void swap(Vector<T,A>& lhs, Vector<T,A>& rhs) {
     lhs.swap(rhs);
 }
 
 
-template <typename T>
-typename Vector<T>::iterator Vector<T>::find(const T& key) {
+template <typename T, typename A>
+typename Vector<T,A>::iterator Vector<T,A>::find(const T& key) {
+    if constexpr (simd::is_vectorizable_v<T>)
+        return iterator{data + simd::find(data, sz, key)};
+
     for (auto iter = begin(); iter != end(); ++iter)
         if (*iter == key)
             return iter;
@@ -410,11 +692,82 @@ typename Vector<T>::iterator Vector<T>::find(const T& key) {
 }
 
 
+template <typename T, typename A>
+typename Vector<T,A>::const_iterator Vector<T,A>::find(const T& key) const {
+    if constexpr (simd::is_vectorizable_v<T>)
+        return const_iterator{data + simd::find(data, sz, key)};
+
+    for (auto iter = begin(); iter != end(); ++iter)
+        if (*iter == key)
+            return iter;
+    return end();
+}
+
+
+template <typename T, typename A>
+std::size_t Vector<T,A>::count(const T& key) const {
+    if constexpr (simd::is_vectorizable_v<T>)
+        return simd::count(data, sz, key);
+
+    std::size_t found {};
+    for (std::size_t i = 0; i < sz; ++i)
+        if (data[i] == key)
+            ++found;
+    return found;
+}
+
+
+// The first of the smallest elements
+template <typename T, typename A>
+T Vector<T,A>::min() const {
+    if (!sz)
+        throw std::runtime_error("vector is empty");
+    if constexpr (simd::is_vectorizable_v<T>)
+        return simd::reduce<simd::Reduction::min>(data, sz);
+
+    const T* smallest = data;
+    for (std::size_t i = 1; i < sz; ++i)
+        if (data[i] < *smallest)
+            smallest = &data[i];
+    return *smallest;
+}
+
+
+// The first of the largest elements
+template <typename T, typename A>
+T Vector<T,A>::max() const {
+    if (!sz)
+        throw std::runtime_error("vector is empty");
+    if constexpr (simd::is_vectorizable_v<T>)
+        return simd::reduce<simd::Reduction::max>(data, sz);
+
+    const T* largest = data;
+    for (std::size_t i = 1; i < sz; ++i)
+        if (*largest < data[i])
+            largest = &data[i];
+    return *largest;
+}
+
+
+// Adds the elements to T{} with operator+=. Integer sums wrap around rather than overflow and
+// floating point ones may round differently than adding the elements in order would.
+template <typename T, typename A>
+T Vector<T,A>::sum() const {
+    if constexpr (simd::is_vectorizable_v<T>)
+        return sz ? simd::reduce<simd::Reduction::sum>(data, sz) : T{};
+
+    T total {};
+    for (std::size_t i = 0; i < sz; ++i)
+        total += data[i];
+    return total;
+}
+
+
 template <typename T>
 class Vector_Iterator {
 private:
     T* data_ptr;
-    friend class Vector<T>;
+    template <typename, typename> friend class Vector;
 public:
     using iterator_category = std::random_access_iterator_tag;
     using difference_type = std::ptrdiff_t;
@@ -444,9 +797,12 @@ public:
         return *this;
     }
 
-    Vector_Iterator operator+(const difference_type& d) {
-        data_ptr += d;
-        return *this;
+    Vector_Iterator operator+(const difference_type& d) const {
+        return Vector_Iterator{data_ptr + d};
+    }
+
+    friend Vector_Iterator operator+(const difference_type& d, const Vector_Iterator& iter) {
+        return iter + d;
     }
 
     Vector_Iterator& operator--() {
@@ -465,15 +821,21 @@ public:
         return *this;
     }
 
-    Vector_Iterator operator-(const difference_type& d) {
-        data_ptr -= d;
-        return *this;
+    Vector_Iterator operator-(const difference_type& d) const {
+        return Vector_Iterator{data_ptr - d};
     }
 
+    difference_type operator-(const Vector_Iterator& rhs) const { return data_ptr - rhs.data_ptr; }
+
     bool operator==(const Vector_Iterator& rhs) const { return data_ptr == rhs.data_ptr; }
     bool operator!=(const Vector_Iterator& rhs) const { return data_ptr != rhs.data_ptr; }
+    bool operator< (const Vector_Iterator& rhs) const { return data_ptr <  rhs.data_ptr; }
+    bool operator> (const Vector_Iterator& rhs) const { return data_ptr >  rhs.data_ptr; }
+    bool operator<=(const Vector_Iterator& rhs) const { return data_ptr <= rhs.data_ptr; }
+    bool operator>=(const Vector_Iterator& rhs) const { return data_ptr >= rhs.data_ptr; }
 
     reference operator*() const { return *data_ptr; }
+    reference operator[](const difference_type& d) const { return data_ptr[d]; }
 
     pointer operator->()  const { return data_ptr;  }
 
@@ -485,7 +847,7 @@ template <typename T>
 class Const_Vector_Iterator {
 private:
     T* data_ptr;
-    friend class Vector<T>;
+    template <typename, typename> friend class Vector;
 public:
     using iterator_category = std::random_access_iterator_tag;
     using difference_type = std::ptrdiff_t;
@@ -515,9 +877,12 @@ public:
         return *this;
     }
 
-    Const_Vector_Iterator operator+(const difference_type& d) {
-        data_ptr += d;
-        return *this;
+    Const_Vector_Iterator operator+(const difference_type& d) const {
+        return Const_Vector_Iterator{data_ptr + d};
+    }
+
+    friend Const_Vector_Iterator operator+(const difference_type& d, const Const_Vector_Iterator& iter) {
+        return iter + d;
     }
 
     Const_Vector_Iterator& operator--() {
@@ -536,15 +901,21 @@ public:
         return *this;
     }
     
-    Const_Vector_Iterator operator-(const difference_type& d) {
-        data_ptr -= d;
-        return *this;
+    Const_Vector_Iterator operator-(const difference_type& d) const {
+        return Const_Vector_Iterator{data_ptr - d};
     }
 
+    difference_type operator-(const Const_Vector_Iterator& rhs) const { return data_ptr - rhs.data_ptr; }
+
     bool operator==(const Const_Vector_Iterator& rhs) const { return data_ptr == rhs.data_ptr; }
     bool operator!=(const Const_Vector_Iterator& rhs) const { return data_ptr != rhs.data_ptr; }
+    bool operator< (const Const_Vector_Iterator& rhs) const { return data_ptr <  rhs.data_ptr; }
+    bool operator> (const Const_Vector_Iterator& rhs) const { return data_ptr >  rhs.data_ptr; }
+    bool operator<=(const Const_Vector_Iterator& rhs) const { return data_ptr <= rhs.data_ptr; }
+    bool operator>=(const Const_Vector_Iterator& rhs) const { return data_ptr >= rhs.data_ptr; }
 
     reference operator*() const { return *data_ptr; }
+    reference operator[](const difference_type& d) const { return data_ptr[d]; }
 
     pointer operator->()  const { return data_ptr;  }
 };
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <cstddef>
+#include <memory_resource>
+
+// Installs a default memory resource for the lifetime of the guard and restores the previous one
+// on destruction, so a failing ASSERT or an exception cannot leave it installed for later tests.
+// With the default std::pmr::null_memory_resource(), any allocation that does not go through the
+// resource a container was given throws std::bad_alloc.
+class DefaultResourceGuard {
+public:
+    explicit DefaultResourceGuard(std::pmr::memory_resource* resource = std::pmr::null_memory_resource())
+        : old_default{std::pmr::set_default_resource(resource)} {}
+    DefaultResourceGuard(const DefaultResourceGuard&) = delete;
+    DefaultResourceGuard& operator=(const DefaultResourceGuard&) = delete;
+    ~DefaultResourceGuard() { std::pmr::set_default_resource(old_default); }
+
+private:
+    std::pmr::memory_resource* old_default;
+};
+
+
+// Forwards to new_delete_resource() and keeps the number of bytes it has handed out and not got back.
+// Two of them never compare equal, so containers using them have unequal allocators.
+class TrackingResource : public std::pmr::memory_resource {
+public:
+    long live() const { return live_bytes; }
+
+private:
+    long live_bytes {};
+
+    void* do_allocate(std::size_t bytes, std::size_t alignment) override {
+        void* p = std::pmr::new_delete_resource()->allocate(bytes, alignment);
+        live_bytes += static_cast<long>(bytes);
+        return p;
+    }
+
+    void do_deallocate(void* p, std::size_t bytes, std::size_t alignment) override {
+        live_bytes -= static_cast<long>(bytes);
+        std::pmr::new_delete_resource()->deallocate(p, bytes, alignment);
+    }
+
+    bool do_is_equal(const std::pmr::memory_resource& rhs) const noexcept override { return this == &rhs; }
+};
@@ -0,0 +1,159 @@
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <numeric>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <gtest/gtest.h>
+#include "data_structures.hpp"
+
+using namespace data_structures;
+
+// Deterministic pseudo random numbers, with many repeats
+static Vector<std::uint32_t> random_numbers(std::size_t n, std::uint32_t range) {
+    Vector<std::uint32_t> vec;
+    vec.reserve(n);
+    std::uint64_t x {88172645463325252ull};
+    for (std::size_t i = 0; i < n; ++i) {
+        x ^= x << 13;
+        x ^= x >> 7;
+        x ^= x << 17;
+        vec.push_back(static_cast<std::uint32_t>(x % range));
+    }
+    return vec;
+}
+
+TEST(ThreadPool, for_range) {
+    parallel::ThreadPool pool(4);
+    EXPECT_EQ(pool.size(), 4);
+
+    std::vector<std::atomic<int>> hits(100000);
+    pool.for_range(hits.size(), 1000, [&](std::size_t begin, std::size_t end) {
+        EXPECT_LE(end - begin, 1000);
+        for (std::size_t i = begin; i < end; ++i)
+            ++hits[i];
+    });
+    for (auto& h : hits)
+        EXPECT_EQ(h.load(), 1);
+
+    // Tasks that split their own work and wait for it
+    std::atomic<long> total {};
+    pool.for_range(64, 1, [&](std::size_t begin, std::size_t end) {
+        for (std::size_t i = begin; i < end; ++i)
+            pool.for_range(1000, 10, [&](std::size_t b, std::size_t e) { total += static_cast<long>(e - b); });
+    });
+    EXPECT_EQ(total.load(), 64000);
+
+    int left {}, right {};
+    pool.invoke([&] { left = 1; }, [&] { right = 2; });
+    EXPECT_EQ(left + right, 3);
+
+    pool.for_range(0, 10, [&](std::size_t, std::size_t) { FAIL(); });
+}
+
+TEST(ThreadPool, exceptions) {
+    parallel::ThreadPool pool(3);
+    try {
+        pool.for_range(1000, 1, [](std::size_t begin, std::size_t) {
+            if (begin == 500)
+                throw std::runtime_error("piece failed");
+        });
+        FAIL();
+    }
+    catch (const std::runtime_error& e) {
+        std::string msg = e.what();
+        EXPECT_TRUE(msg == "piece failed");
+    }
+
+    EXPECT_THROW(pool.invoke([] {}, [] { throw std::logic_error("g"); }), std::logic_error);
+
+    // The pool still works afterwards
+    std::atomic<int> calls {};
+    pool.for_range(100, 1, [&](std::size_t, std::size_t) { ++calls; });
+    EXPECT_EQ(calls.load(), 100);
+
+    parallel::ThreadPool single(1);
+    EXPECT_THROW(single.for_range(10, 1, [](std::size_t, std::size_t) { throw std::runtime_error("x"); }), std::runtime_error);
+}
+
+TEST(Algorithms, sort) {
+    parallel::ThreadPool pool(4);
+    for (std::size_t n : {0, 1, 100, 5000, 100000, 1000003}) {
+        Vector<std::uint32_t> vec = random_numbers(n, n < 1000 ? 10 : 1000000);
+        std::vector<std::uint32_t> expected(vec.begin(), vec.end());
+        std::sort(expected.begin(), expected.end());
+
+        parallel::sort(pool, vec.begin(), vec.end());
+        ASSERT_EQ(vec.size(), expected.size());
+        EXPECT_TRUE(std::equal(vec.begin(), vec.end(), expected.begin()));
+    }
+
+    Vector<std::uint32_t> numbers = random_numbers(300000, 100);
+    Vector<std::string> words;
+    for (std::uint32_t x : numbers)
+        words.push_back(std::to_string(x));
+    parallel::sort(pool, words.begin(), words.end(), std::greater<>());
+    EXPECT_TRUE(std::is_sorted(words.begin(), words.end(), std::greater<>()));
+    EXPECT_EQ(words.front(), "99");
+    EXPECT_EQ(words.count("0"), numbers.count(0));
+
+    // The default pool
+    parallel::sort(numbers.begin(), numbers.end());
+    EXPECT_TRUE(std::is_sorted(numbers.begin(), numbers.end()));
+}
+
+TEST(Algorithms, transform_for_each) {
+    parallel::ThreadPool pool(4);
+    const Vector<std::uint32_t> input = random_numbers(200000, 1000);
+    Vector<std::uint64_t> output(input.size());
+
+    auto end = parallel::transform(pool, input.begin(), input.end(), output.begin(),
+                                   [](std::uint32_t x) { return std::uint64_t{x} * x; });
+    EXPECT_EQ(end, output.end());
+    for (std::size_t i = 0; i < input.size(); i += 997)
+        EXPECT_EQ(output[i], std::uint64_t{input[i]} * input[i]);
+
+    parallel::for_each(pool, output.begin(), output.end(), [](std::uint64_t& x) { x += 1; });
+    for (std::size_t i = 0; i < input.size(); i += 997)
+        EXPECT_EQ(output[i], std::uint64_t{input[i]} * input[i] + 1);
+
+    Vector<int> small {1, 2, 3};
+    parallel::transform(small.begin(), small.end(), small.begin(), [](int x) { return -x; });
+    EXPECT_TRUE(small == (Vector<int>{-1, -2, -3}));
+}
+
+TEST(Algorithms, reduce_scan) {
+    parallel::ThreadPool pool(4);
+    const Vector<std::uint32_t> input = random_numbers(500000, 1000);
+    std::uint64_t expected = std::accumulate(input.begin(), input.end(), std::uint64_t{5});
+
+    EXPECT_EQ(parallel::reduce(pool, input.begin(), input.end(), std::uint64_t{5}), expected);
+    EXPECT_EQ(parallel::reduce(input.begin(), input.end(), std::uint64_t{5}), expected);
+    EXPECT_EQ(parallel::reduce(pool, input.begin(), input.end(), std::uint32_t{0},
+                               [](std::uint32_t a, std::uint32_t b) { return a > b ? a : b; }), input.max());
+    EXPECT_EQ(parallel::reduce(pool, input.begin(), input.begin(), 7), 7);
+
+    Vector<std::uint64_t> wide(input.size());
+    parallel::transform(pool, input.begin(), input.end(), wide.begin(), [](std::uint32_t x) { return std::uint64_t{x}; });
+    std::vector<std::uint64_t> prefix(wide.size());
+    std::partial_sum(wide.begin(), wide.end(), prefix.begin());
+
+    Vector<std::uint64_t> scanned(wide.size());
+    auto end = parallel::inclusive_scan(pool, wide.begin(), wide.end(), scanned.begin());
+    EXPECT_EQ(end, scanned.end());
+    EXPECT_TRUE(std::equal(scanned.begin(), scanned.end(), prefix.begin()));
+
+    // In place, and with another operation
+    parallel::inclusive_scan(pool, wide.begin(), wide.end(), wide.begin());
+    EXPECT_TRUE(wide == scanned);
+
+    Vector<std::string> letters {"a", "b", "c"};
+    parallel::inclusive_scan(letters.begin(), letters.end(), letters.begin());
+    EXPECT_EQ(letters[2], "abc");
+}
+
+int main(int argc, char** argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
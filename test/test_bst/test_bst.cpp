@@ -1,6 +1,8 @@
+#include <memory_resource>
 #include <string>
 #include <gtest/gtest.h>
 #include "data_structures.hpp"
+#include "TestResources.hpp"
 
 using namespace data_structures;
 
@@ -79,6 +81,20 @@ TEST(BST, removals) {
     EXPECT_EQ(bst.size(), 0);
 }
 
+TEST(BST, allocators) {
+    std::pmr::monotonic_buffer_resource arena;
+    {
+        DefaultResourceGuard guard;
+        BST<int, std::pmr::polymorphic_allocator<int>> bst{std::pmr::polymorphic_allocator<int>{&arena}};
+        for (int i : {50, 20, 70, 10, 30, 60, 80})
+            bst.insert(i);
+        bst.remove(20);
+        EXPECT_EQ(bst.size(), 6);
+        EXPECT_TRUE(bst.search(30));
+        EXPECT_EQ(bst.get_allocator().resource(), &arena);
+    }
+}
+
 TEST(BST, search) {
     BST<int> bst {10, 4, 2, 8, 15, 11, 12, 20};
     EXPECT_EQ(bst.search(11), true);
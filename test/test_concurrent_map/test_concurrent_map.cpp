@@ -0,0 +1,83 @@
+#include <string>
+#include <thread>
+#include <vector>
+#include <gtest/gtest.h>
+#include "data_structures.hpp"
+
+using namespace data_structures;
+
+TEST(ConcurrentMap, constructors) {
+    ConcurrentMap<int, std::string> default_map;
+    EXPECT_EQ(default_map.size(), 0);
+    EXPECT_EQ(default_map.empty(), true);
+    EXPECT_EQ(default_map.shard_count(), 64);
+
+    ConcurrentMap<int, std::string> sharded_map(10);
+    EXPECT_EQ(sharded_map.shard_count(), 16);
+
+    ConcurrentMap<int, std::string> single_map(1);
+    EXPECT_EQ(single_map.shard_count(), 1);
+    single_map.insert(1, "Bob");
+    EXPECT_EQ(single_map.find(1).value(), "Bob");
+}
+
+TEST(ConcurrentMap, operations) {
+    ConcurrentMap<int, std::string> map;
+
+    map.insert(1, "Bob");
+    map.insert(2, "Alice");
+    EXPECT_EQ(map.size(), 2);
+    EXPECT_TRUE(map.contains(1));
+    EXPECT_EQ(map.find(2).value(), "Alice");
+    EXPECT_FALSE(map.find(3).has_value());
+
+    map.upsert(3, [](std::string& v) { v += "John"; });
+    map.upsert(3, [](std::string& v) { v += "!"; });
+    EXPECT_EQ(map.find(3).value(), "John!");
+
+    bool visited = map.visit(1, [](std::string& v) { v = "New Bob"; });
+    EXPECT_TRUE(visited);
+    EXPECT_EQ(map.find(1).value(), "New Bob");
+
+    const auto& const_map = map;
+    std::string seen;
+    EXPECT_TRUE(const_map.visit(2, [&](const std::string& v) { seen = v; }));
+    EXPECT_EQ(seen, "Alice");
+    EXPECT_FALSE(const_map.visit(4, [&](const std::string& v) { seen = v; }));
+
+    EXPECT_TRUE(map.remove(1));
+    EXPECT_FALSE(map.remove(1));
+    EXPECT_EQ(map.size(), 2);
+
+    map.clear();
+    EXPECT_EQ(map.empty(), true);
+}
+
+TEST(ConcurrentMap, threads) {
+    ConcurrentMap<int, int> map;
+    const int no_threads = 8;
+    const int per_thread = 5000;
+
+    std::vector<std::thread> threads;
+    for (int t = 0; t < no_threads; ++t) {
+        threads.emplace_back([&map, t] {
+            for (int i = 0; i < per_thread; ++i) {
+                map.insert(t * per_thread + i, i);
+                map.upsert(-1, [](int& v) { ++v; });
+                map.find(i);
+            }
+        });
+    }
+    for (auto& t : threads)
+        t.join();
+
+    EXPECT_EQ(map.size(), no_threads * per_thread + 1);
+    EXPECT_EQ(map.find(-1).value(), no_threads * per_thread);
+    for (int i = 0; i < no_threads * per_thread; ++i)
+        EXPECT_EQ(map.find(i).value(), i % per_thread);
+}
+
+int main(int argc, char** argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,245 @@
+#include <string>
+#include <gtest/gtest.h>
+#include "data_structures.hpp"
+
+using namespace data_structures;
+
+TEST(FlatMap, constructors) {
+    FlatMap<int, std::string> default_map;
+    EXPECT_EQ(default_map.size(), 0);
+    EXPECT_EQ(default_map.empty(), true);
+    EXPECT_EQ(default_map.capacity(), 0);
+    EXPECT_EQ(default_map.begin(), default_map.end());
+
+    FlatMap<int, std::string> initializer_map {{1, "Bob"},  {2, "Alice"}};
+    EXPECT_EQ(initializer_map.size(), 2);
+    EXPECT_EQ(initializer_map.empty(), false);
+    EXPECT_EQ(initializer_map[1], "Bob");
+    EXPECT_EQ(initializer_map[2], "Alice");
+
+    FlatMap<int, std::string> copy_map(initializer_map);
+    EXPECT_EQ(copy_map.size(), 2);
+    EXPECT_TRUE(copy_map == initializer_map);
+
+    FlatMap<int, std::string> move_map(std::move(initializer_map));
+    EXPECT_EQ(move_map.size(), 2);
+    EXPECT_EQ(initializer_map.empty(), true);
+    EXPECT_EQ(move_map[1], "Bob");
+    EXPECT_EQ(move_map[2], "Alice");
+
+    initializer_map.insert(3, "John");
+    EXPECT_EQ(initializer_map.size(), 1);
+    EXPECT_EQ(initializer_map[3], "John");
+}
+
+TEST(FlatMap, rehash) {
+    FlatMap<int, int> map;
+    for (int i = 0; i < 10000; ++i)
+        map.insert(i, i);
+
+    EXPECT_EQ(map.size(), 10000);
+    EXPECT_GE(map.capacity(), 10000);
+    for (int i = 0; i < 10000; ++i)
+        EXPECT_EQ(map[i], i);
+    EXPECT_EQ(map.size(), 10000);
+}
+
+TEST(FlatMap, insertions) {
+    FlatMap<int, std::string> map;
+
+    map.insert(1, "Chris");
+    map.insert(120, "Bob");
+    map.insert(53, "Anna");
+    map.insert(200, "Alice");
+    EXPECT_EQ(map.size(), 4);
+
+    map.insert(1, "New Chris");
+    EXPECT_EQ(map.size(), 4);
+    EXPECT_EQ(map[1], "New Chris");
+
+    map[2] = "John";
+    EXPECT_EQ(map.size(), 5);
+
+    map[2] = "New John";
+    EXPECT_EQ(map.size(), 5);
+    EXPECT_EQ(map[2], "New John");
+}
+
+TEST(FlatMap, removals) {
+    FlatMap<int, std::string> map {{1, "Bob"},  {2, "Alice"}};
+
+    try {
+        map.remove(0);
+        FAIL();
+    }
+    catch (const std::runtime_error& e) {
+        std::string msg = e.what();
+        EXPECT_TRUE(msg ==  "no such key in the map");
+    }
+
+    map.remove(1);
+    EXPECT_EQ(map.size(), 1);
+    EXPECT_FALSE(map.contains(1));
+    EXPECT_TRUE(map.contains(2));
+
+    map.clear();
+    EXPECT_EQ(map.size(), 0);
+    EXPECT_EQ(map.begin(), map.end());
+}
+
+TEST(FlatMap, churn) {
+    FlatMap<int, int> map;
+    for (int round = 0; round < 50; ++round) {
+        for (int i = 0; i < 1000; ++i)
+            map.insert(round * 1000 + i, i);
+        for (int i = 0; i < 1000; ++i)
+            map.remove(round * 1000 + i);
+    }
+    EXPECT_EQ(map.size(), 0);
+    EXPECT_LE(map.capacity(), 4096);
+
+    for (int i = 0; i < 1000; ++i)
+        map.insert(i, i);
+    for (int i = 0; i < 1000; i += 2)
+        map.remove(i);
+    for (int i = 0; i < 1000; ++i)
+        EXPECT_EQ(map.contains(i), i % 2 == 1);
+}
+
+struct ConstantHash {
+    std::size_t operator()(int) const { return 42; }
+};
+
+TEST(FlatMap, collisions) {
+    FlatMap<int, int, ConstantHash> map;
+    for (int i = 0; i < 200; ++i)
+        map.insert(i, i * 2);
+
+    EXPECT_EQ(map.size(), 200);
+    for (int i = 0; i < 200; ++i)
+        EXPECT_EQ(map[i], i * 2);
+    EXPECT_EQ(map.find(500), map.end());
+
+    for (int i = 0; i < 200; i += 3)
+        map.remove(i);
+    for (int i = 0; i < 200; ++i)
+        EXPECT_EQ(map.contains(i), i % 3 != 0);
+}
+
+TEST(FlatMap, stats) {
+    FlatMap<int, int> map;
+    EXPECT_EQ(map.stats().bytes_allocated, 0);
+
+    for (int i = 0; i < 1000; ++i)
+        map.insert(i, i);
+    for (int i = 0; i < 1500; ++i)
+        map.contains(i);
+    map.find(0);
+    map[1] = 2;
+
+    MapStats s = map.stats();
+    EXPECT_EQ(s.size, 1000);
+    EXPECT_EQ(s.buckets, map.capacity());
+    EXPECT_EQ(s.rehashes, 6);  // 32 -> 2048 slots
+    EXPECT_EQ(s.bytes_allocated, map.capacity() * (1 + sizeof(std::pair<int, int>)));
+    EXPECT_EQ(s.hits, 1002);
+    EXPECT_EQ(s.misses, 500);
+
+    std::size_t elements {};
+    for (std::size_t n = 0; n < s.histogram.size(); ++n)
+        elements += s.histogram[n];
+    EXPECT_EQ(elements, 1000);
+    EXPECT_GE(s.histogram[1], 900);  // at 1000 / 2048 almost everything is in its home group
+
+    FlatMap<int, int, ConstantHash> bad_map;
+    for (int i = 0; i < 200; ++i)
+        bad_map.insert(i, i);
+    EXPECT_GT(bad_map.stats().max_length, 1);
+}
+
+TEST(FlatMap, group_matching) {
+    signed char group[32];
+    for (int seed = 0; seed < 64; ++seed) {
+        for (int i = 0; i < 32; ++i)
+            group[i] = static_cast<signed char>((i * 37 + seed * 11) % 7 == 0 ? -128 : (i * seed) % 5);
+
+        for (signed char b : {static_cast<signed char>(-128), static_cast<signed char>(0),
+                              static_cast<signed char>(3), static_cast<signed char>(100)})
+            EXPECT_EQ(simd::match_byte(group, b), simd::match_byte_scalar(group, b));
+        EXPECT_EQ(simd::match_negative(group), simd::match_negative_scalar(group));
+    }
+}
+
+TEST(FlatMap, find) {
+    FlatMap<int, std::string> map {{1, "Bob"},  {2, "Alice"}};
+
+    auto found = map.find(1);
+    EXPECT_EQ(found->first, 1);
+    EXPECT_EQ(found->second, "Bob");
+
+    found->second = "New Bob";
+    EXPECT_EQ(map[1], "New Bob");
+
+    auto not_found = map.find(0);
+    EXPECT_EQ(not_found, map.end());
+}
+
+TEST(FlatMap, iteration) {
+    FlatMap<int, int> map;
+    for (int i = 0; i < 100; ++i)
+        map.insert(i, i);
+
+    int count {}, sum {};
+    for (auto& p : map) {
+        ++count;
+        sum += p.second;
+        p.second = 0;
+    }
+    EXPECT_EQ(count, 100);
+    EXPECT_EQ(sum, 4950);
+
+    for (auto iter = map.cbegin(); iter != map.cend(); ++iter)
+        EXPECT_EQ(iter->second, 0);
+}
+
+TEST(FlatMap, overloads) {
+    FlatMap<int, std::string> map;
+    for (int i = 0; i < 11; ++i)
+        map.insert(i, "A" + std::to_string(i));
+
+    FlatMap<int, std::string> copy_map = map;
+    EXPECT_EQ(copy_map.size(), 11);
+    EXPECT_TRUE(copy_map == map);
+
+    copy_map[0] = "B0";
+    EXPECT_TRUE(copy_map != map);
+
+    FlatMap<int, std::string> move_map = std::move(map);
+    EXPECT_EQ(move_map.size(), 11);
+    EXPECT_EQ(map.empty(), true);
+
+    EXPECT_EQ(move_map[0], "A0");
+
+    move_map[100] = "A100";
+    EXPECT_EQ(move_map.size(), 12);
+    EXPECT_EQ(move_map[100], "A100");
+}
+
+TEST(FlatMap, swap) {
+    FlatMap<int, std::string> map_1 {{1, "Bob"},  {20, "Alice"}};
+    FlatMap<int, std::string> map_2 {{10, "John"}};
+
+    map_1.swap(map_2);
+
+    EXPECT_EQ(map_2.size(), 2);
+    EXPECT_EQ(map_2[20], "Alice");
+    EXPECT_EQ(map_2[1], "Bob");
+
+    EXPECT_EQ(map_1.size(), 1);
+    EXPECT_EQ(map_1[10], "John");
+}
+
+int main(int argc, char** argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
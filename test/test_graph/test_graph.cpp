@@ -1,6 +1,8 @@
+#include <memory_resource>
 #include <string>
 #include <gtest/gtest.h>
 #include "data_structures.hpp"
+#include "TestResources.hpp"
 
 using namespace data_structures;
 
@@ -83,6 +85,24 @@ TEST(Graph, removals) {
     }
 }
 
+TEST(Graph, allocators) {
+    // The vertices and their edge lists, once they no longer fit inline, come from the arena
+    std::pmr::monotonic_buffer_resource arena;
+    {
+        DefaultResourceGuard guard;
+        Graph<int, std::pmr::polymorphic_allocator<int>> graph{std::pmr::polymorphic_allocator<int>{&arena}};
+        for (int i = 0; i < 20; ++i)
+            graph.add_vertex(i);
+        for (int i = 1; i < 20; ++i)
+            graph.add_edge(0, i, i);
+        graph.remove_vertex(5);
+        EXPECT_EQ(graph.get_no_vertices(), 19);
+        EXPECT_EQ(graph.get_no_edges(), 36);
+        EXPECT_EQ(graph.get_weight(0, 19), 19);
+        EXPECT_EQ(graph.get_allocator().resource(), &arena);
+    }
+}
+
 TEST(Graph, weights) {
     Graph<int> graph {1, 2, 3};
 
@@ -0,0 +1,171 @@
+#include <cstdint>
+#include <limits>
+#include <string>
+#include <type_traits>
+#include <gtest/gtest.h>
+#include "data_structures.hpp"
+
+using namespace data_structures;
+
+TEST(IntMap, constructors) {
+    IntMap<std::uint32_t, std::uint32_t> default_map;
+    EXPECT_EQ(default_map.size(), 0);
+    EXPECT_EQ(default_map.empty(), true);
+    EXPECT_EQ(default_map.capacity(), 0);
+    EXPECT_EQ(default_map.begin(), default_map.end());
+
+    IntMap<std::uint32_t, std::uint32_t> initializer_map {{1, 10}, {2, 20}};
+    EXPECT_EQ(initializer_map.size(), 2);
+    EXPECT_EQ(initializer_map[1], 10);
+    EXPECT_EQ(initializer_map[2], 20);
+
+    IntMap<std::uint32_t, std::uint32_t> copy_map(initializer_map);
+    EXPECT_TRUE(copy_map == initializer_map);
+
+    IntMap<std::uint32_t, std::uint32_t> move_map(std::move(initializer_map));
+    EXPECT_EQ(move_map.size(), 2);
+    EXPECT_EQ(initializer_map.empty(), true);
+    EXPECT_TRUE(move_map == copy_map);
+}
+
+TEST(IntMap, operations) {
+    IntMap<std::int64_t, double> map;
+    for (std::int64_t i = -5000; i < 5000; ++i)
+        map.insert(i, i * 0.5);
+    EXPECT_EQ(map.size(), 10000);
+    for (std::int64_t i = -5000; i < 5000; ++i)
+        EXPECT_EQ(map[i], i * 0.5);
+    EXPECT_FALSE(map.contains(5000));
+
+    map.insert(7, 1.5);
+    EXPECT_EQ(map.size(), 10000);
+    EXPECT_EQ(map[7], 1.5);
+
+    for (std::int64_t i = -5000; i < 5000; i += 3)
+        map.remove(i);
+    for (std::int64_t i = -5000; i < 5000; ++i)
+        EXPECT_EQ(map.contains(i), (i + 5000) % 3 != 0);
+
+    try {
+        map.remove(-5000);
+        FAIL();
+    }
+    catch (const std::runtime_error& e) {
+        std::string msg = e.what();
+        EXPECT_TRUE(msg ==  "no such key in the map");
+    }
+
+    auto found = map.find(2);
+    EXPECT_EQ(found->first, 2);
+    found->second = 42.0;
+    EXPECT_EQ(map[2], 42.0);
+    EXPECT_EQ(map.find(-5000), map.end());
+
+    map.clear();
+    EXPECT_EQ(map.size(), 0);
+    EXPECT_EQ(map.begin(), map.end());
+}
+
+struct ConstantHash {
+    std::size_t operator()(std::uint32_t) const { return 3; }
+};
+
+// With a constant hash every key lands in one cluster, so removals have to shift keys back
+// across the end of the table and probes run through many blocks
+TEST(IntMap, clusters) {
+    IntMap<std::uint32_t, std::uint32_t, ConstantHash> map;
+    for (std::uint32_t i = 0; i < 20; ++i)
+        map.insert(i, i * 2);
+    for (std::uint32_t i = 0; i < 20; i += 2)
+        map.remove(i);
+
+    EXPECT_EQ(map.size(), 10);
+    for (std::uint32_t i = 0; i < 20; ++i) {
+        EXPECT_EQ(map.contains(i), i % 2 == 1);
+        if (i % 2) {
+            EXPECT_EQ(map[i], i * 2);
+        }
+    }
+}
+
+TEST(IntMap, sentinel_key) {
+    constexpr std::uint16_t max = std::numeric_limits<std::uint16_t>::max();
+    IntMap<std::uint16_t, int> map;
+    map[max] = 1;
+    EXPECT_EQ(map.size(), 1);
+    EXPECT_TRUE(map.contains(max));
+    EXPECT_EQ(map.capacity(), 0);  // the sentinel key is not stored in the table
+
+    map.insert(1, 2);
+    int count {}, sum {};
+    for (auto [key, value] : map) {
+        ++count;
+        sum += value;
+        EXPECT_TRUE(key == 1 || key == max);
+    }
+    EXPECT_EQ(count, 2);
+    EXPECT_EQ(sum, 3);
+
+    map.remove(max);
+    EXPECT_FALSE(map.contains(max));
+    EXPECT_EQ(map.size(), 1);
+}
+
+TEST(IntMap, iteration) {
+    IntMap<std::uint32_t, std::uint32_t> map;
+    for (std::uint32_t i = 0; i < 1000; ++i)
+        map.insert(i, i);
+    map.insert(std::numeric_limits<std::uint32_t>::max(), 0);
+
+    std::uint64_t sum {};
+    std::size_t count {};
+    map.for_each([&](std::uint32_t key, std::uint32_t& value) {
+        sum += key == std::numeric_limits<std::uint32_t>::max() ? 0 : key;
+        value = 1;
+        ++count;
+    });
+    EXPECT_EQ(count, 1001);
+    EXPECT_EQ(sum, 499500);
+
+    count = 0;
+    for (auto iter = map.cbegin(); iter != map.cend(); ++iter) {
+        EXPECT_EQ(iter->second, 1);
+        ++count;
+    }
+    EXPECT_EQ(count, 1001);
+}
+
+TEST(IntMap, compact_map) {
+    EXPECT_TRUE((std::is_same_v<CompactMap<std::uint64_t, std::uint64_t>, IntMap<std::uint64_t, std::uint64_t>>));
+    EXPECT_TRUE((std::is_same_v<CompactMap<int, std::string>, Map<int, std::string>>));
+    EXPECT_TRUE((std::is_same_v<CompactMap<std::string, int>, Map<std::string, int>>));
+}
+
+TEST(IntMap, key_matching) {
+    std::uint32_t keys32[8];
+    std::uint64_t keys64[4];
+    for (std::uint32_t seed = 0; seed < 64; ++seed) {
+        for (std::uint32_t i = 0; i < 8; ++i)
+            keys32[i] = (i * 7 + seed) % 3 == 0 ? 0xFFFFFFFFu : (i * seed) % 4;
+        for (std::uint32_t i = 0; i < 4; ++i)
+            keys64[i] = (i * 5 + seed) % 3 == 0 ? (std::uint64_t{1} << 32) | i : (i * seed) % 3;
+
+        for (std::uint32_t k : {0u, 1u, 3u, 0xFFFFFFFFu}) {
+            EXPECT_EQ(simd::match_key32(keys32, k), simd::match_key32_scalar(keys32, k));
+#if defined(DATA_STRUCTURES_HAS_SSE2)
+            EXPECT_EQ(simd::match_key32_sse2(keys32, k), simd::match_key32_scalar(keys32, k));
+#endif
+        }
+        for (std::uint64_t k : {std::uint64_t{0}, std::uint64_t{1}, std::uint64_t{2}, (std::uint64_t{1} << 32) | 1}) {
+            EXPECT_EQ(simd::match_key64(keys64, k), simd::match_key64_scalar(keys64, k));
+#if defined(DATA_STRUCTURES_HAS_SSE2)
+            EXPECT_EQ(simd::match_key64_sse2(keys64, k), simd::match_key64_scalar(keys64, k));
+#endif
+        }
+    }
+}
+
+int main(int argc, char** argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
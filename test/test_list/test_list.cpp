@@ -1,5 +1,7 @@
+#include <memory_resource>
 #include <gtest/gtest.h>
 #include "data_structures.hpp"
+#include "TestResources.hpp"
 
 using namespace data_structures;
 
@@ -127,6 +129,26 @@ TEST(List, overloadata_structures) {
     EXPECT_EQ(list.empty(), true);
 }
 
+TEST(List, allocators) {
+    std::pmr::monotonic_buffer_resource arena;
+    {
+        DefaultResourceGuard guard;
+        List<int, std::pmr::polymorphic_allocator<int>> list{std::pmr::polymorphic_allocator<int>{&arena}};
+        for (int i = 0; i < 100; ++i)
+            list.push_back(i);
+        list.pop_front();
+        list.insert(0, -1);
+        EXPECT_EQ(list.size(), 100);
+        EXPECT_EQ(list.front(), -1);
+        EXPECT_EQ(list.get_allocator().resource(), &arena);
+
+        List<int, std::pmr::polymorphic_allocator<int>> copy(list, list.get_allocator());
+        EXPECT_TRUE(copy == list);
+        copy = std::move(list);
+        EXPECT_EQ(copy.back(), 99);
+    }
+}
+
 TEST(List, swap) {
     List<int> list_1{ 1, 1, 1 };
     List<int> list_2{ 0, 0 };
@@ -1,6 +1,11 @@
+#include <atomic>
+#include <memory_resource>
 #include <string>
+#include <string_view>
+#include <vector>
 #include <gtest/gtest.h>
 #include "data_structures.hpp"
+#include "TestResources.hpp"
 
 using namespace data_structures;
 
@@ -49,6 +54,205 @@ TEST(Map, rehash) {
         EXPECT_EQ(map[i], i);   
 }
 
+TEST(Map, incremental_rehash) {
+    Map<int, int> map;
+    map.set_rehash_step(4);
+    EXPECT_EQ(map.get_rehash_step(), 4);
+
+    bool seen_rehashing = false;
+    for (int i = 0; i < 10000; ++i) {
+        map.insert(i, i);
+        seen_rehashing = seen_rehashing || map.rehashing();
+    }
+    EXPECT_TRUE(seen_rehashing);
+    EXPECT_EQ(map.size(), 10000);
+
+    std::size_t count {};
+    for (auto iter = map.begin(); iter != map.end(); ++iter)
+        ++count;
+    EXPECT_EQ(count, 10000);
+
+    for (int i = 0; i < 10000; i += 2)
+        map.remove(i);
+    EXPECT_EQ(map.size(), 5000);
+    for (int i = 1; i < 10000; i += 2)
+        EXPECT_EQ(map[i], i);
+    EXPECT_EQ(map.find(0), map.end());
+
+    map.set_rehash_step(0);
+    EXPECT_FALSE(map.rehashing());
+    EXPECT_EQ(map.size(), 5000);
+    EXPECT_EQ(map[9999], 9999);
+}
+
+TEST(Map, incremental_rehash_finishes_in_time) {
+    // With a step of one bucket per call the inserts between two rehashes could not drain the
+    // old table, so the calls move more; the next rehash never has to finish the previous one
+    for (std::size_t step : {1, 2, 1000}) {
+        Map<int, int> map;
+        map.set_rehash_step(step);
+        std::size_t growths {};
+        for (int i = 0; i < 200000; ++i) {
+            std::size_t buckets = map.capacity();
+            bool was_rehashing = map.rehashing();
+            map.insert(i, i);
+            if (map.capacity() != buckets) {
+                ++growths;
+                EXPECT_FALSE(was_rehashing) << "at size " << i << " with step " << step;
+            }
+        }
+        EXPECT_GE(growths, 5);
+        EXPECT_EQ(map.size(), 200000);
+        EXPECT_EQ(map[123456], 123456);
+        EXPECT_EQ(map.get_rehash_step(), step);
+    }
+}
+
+TEST(Map, equality_ignores_layout) {
+    Map<int, int> grown;
+    Map<int, int> reserved;
+    reserved.reserve(20000);
+    for (int i = 0; i < 10000; ++i) {
+        grown.insert(i, i);
+        reserved.insert(9999 - i, 9999 - i);
+    }
+    EXPECT_NE(grown.capacity(), reserved.capacity());
+    EXPECT_TRUE(grown == reserved);
+    EXPECT_TRUE(reserved == grown);
+    reserved[5] = -5;
+    EXPECT_TRUE(grown != reserved);
+
+    // Stop inserting while the old table is still being drained
+    Map<int, int> rehashing;
+    rehashing.set_rehash_step(1);
+    Map<int, int> settled;
+    int n {};
+    do {
+        rehashing.insert(n, n);
+        settled.insert(n, n);
+        ++n;
+    } while (!rehashing.rehashing() || n < 100);
+    EXPECT_TRUE(rehashing.rehashing());
+    EXPECT_FALSE(settled.rehashing());
+    EXPECT_TRUE(rehashing == settled);
+    EXPECT_TRUE(settled == rehashing);
+}
+
+TEST(Map, bulk_load) {
+    Map<int, int> reserved;
+    reserved.reserve(100000);
+    std::size_t buckets = reserved.capacity();
+    EXPECT_GE(buckets, 100000 / 0.9);
+    for (int i = 0; i < 100000; ++i)
+        reserved.insert(i, i);
+    EXPECT_EQ(reserved.capacity(), buckets);
+
+    std::vector<std::pair<int, std::string>> entries {{1, "Bob"}, {2, "Alice"}, {1, "New Bob"}};
+    Map<int, std::string> range_map(entries.begin(), entries.end());
+    EXPECT_EQ(range_map.size(), 2);
+    EXPECT_EQ(range_map[1], "New Bob");
+    EXPECT_EQ(range_map[2], "Alice");
+
+    range_map.insert(entries.begin(), entries.begin() + 1);
+    EXPECT_EQ(range_map.size(), 2);
+    EXPECT_EQ(range_map[1], "Bob");
+
+    Vector<std::pair<int, std::string>> vec;
+    for (int i = 0; i < 10000; ++i)
+        vec.push_back({i, "A" + std::to_string(i)});
+
+    Map<int, std::string> copied(vec);
+    EXPECT_EQ(copied.size(), 10000);
+    EXPECT_EQ(vec[5].second, "A5");
+
+    Map<int, std::string> moved(std::move(vec));
+    EXPECT_EQ(moved.size(), 10000);
+    EXPECT_TRUE(moved == copied);
+    for (int i = 0; i < 10000; ++i)
+        EXPECT_EQ(moved[i], "A" + std::to_string(i));
+}
+
+TEST(Map, power_of_two_policy) {
+    EXPECT_EQ(PowerOfTwoPolicy::next_size(1000), 1024);
+    EXPECT_EQ(PrimeSizePolicy::next_size(1000), 1543);
+    EXPECT_EQ(PrimeSizePolicy::next_size(3000000000), 3221225482);
+
+    Map<int, int, std::hash<int>, PowerOfTwoPolicy> map;
+    EXPECT_EQ(map.capacity(), 64);
+    for (int i = 0; i < 10000; ++i)
+        map.insert(i * 64, i);  // keys that all share their low bits
+
+    EXPECT_EQ(map.size(), 10000);
+    EXPECT_EQ(map.capacity(), 16384);
+    for (int i = 0; i < 10000; ++i)
+        EXPECT_EQ(map[i * 64], i);
+    EXPECT_FALSE(map.contains(1));
+
+    map.set_rehash_step(2);
+    for (int i = 10000; i < 20000; ++i)
+        map.insert(i * 64, i);
+    for (int i = 0; i < 20000; i += 2)
+        map.remove(i * 64);
+    EXPECT_EQ(map.size(), 10000);
+    for (int i = 1; i < 20000; i += 2)
+        EXPECT_EQ(map[i * 64], i);
+
+    std::size_t count {};
+    for (auto iter = map.begin(); iter != map.end(); ++iter)
+        ++count;
+    EXPECT_EQ(count, 10000);
+}
+
+struct ConstantHash {
+    std::size_t operator()(int) const { return 7; }
+};
+
+TEST(Map, stats) {
+    Map<int, int> map;
+    MapStats empty = map.stats();
+    EXPECT_EQ(empty.size, 0);
+    EXPECT_EQ(empty.buckets, 53);
+    EXPECT_EQ(empty.max_length, 0);
+    EXPECT_EQ(empty.histogram[0], 53);
+    EXPECT_EQ(empty.rehashes, 0);
+
+    for (int i = 0; i < 1000; ++i)
+        map.insert(i, i);
+    MapStats s = map.stats();
+    EXPECT_EQ(s.size, 1000);
+    EXPECT_EQ(s.buckets, map.capacity());
+    EXPECT_DOUBLE_EQ(s.load_factor, 1000.0 / map.capacity());
+    EXPECT_EQ(s.rehashes, 5);
+    EXPECT_GT(s.rehash_time.count(), 0);
+    EXPECT_GE(s.bytes_allocated, 1000 * sizeof(std::pair<int, int>));
+    EXPECT_EQ(s.histogram.size(), s.max_length + 1);
+
+    std::size_t buckets {}, elements {};
+    for (std::size_t n = 0; n < s.histogram.size(); ++n) {
+        buckets += s.histogram[n];
+        elements += n * s.histogram[n];
+    }
+    EXPECT_EQ(buckets, s.buckets);
+    EXPECT_EQ(elements, 1000);
+#ifndef DATA_STRUCTURES_MAP_COUNTERS
+    EXPECT_EQ(s.hits, 0);  // the lookup counters are compiled out
+    EXPECT_EQ(s.misses, 0);
+#else
+    EXPECT_EQ(s.hits, 0);
+    map.contains(1);
+    map.find(5000);
+    EXPECT_EQ(map.stats().hits, 1);
+    EXPECT_EQ(map.stats().misses, 1);
+#endif
+
+    Map<int, int, ConstantHash> bad_map;
+    for (int i = 0; i < 40; ++i)
+        bad_map.insert(i, i);
+    MapStats bad = bad_map.stats();
+    EXPECT_EQ(bad.max_length, 40);
+    EXPECT_EQ(bad.histogram[40], 1);
+}
+
 TEST(Map, insertions) {
     Map<int, std::string> map;
     
@@ -65,6 +269,57 @@ TEST(Map, insertions) {
     EXPECT_EQ(map.size(), 5);
 }
 
+struct Tracked {
+    static int copies;
+    int value {};
+
+    Tracked() = default;
+    explicit Tracked(int in_value) : value{in_value} {}
+    Tracked(const Tracked& rhs) : value{rhs.value} { ++copies; }
+    Tracked(Tracked&& rhs) noexcept : value{rhs.value} {}
+    Tracked& operator=(const Tracked& rhs) { value = rhs.value; ++copies; return *this; }
+    Tracked& operator=(Tracked&& rhs) noexcept { value = rhs.value; return *this; }
+};
+
+int Tracked::copies = 0;
+
+TEST(Map, emplacement) {
+    Map<int, Tracked> map;
+    Tracked::copies = 0;
+
+    EXPECT_TRUE(map.try_emplace(1, 10).second);
+    EXPECT_FALSE(map.try_emplace(1, 20).second);
+
+    EXPECT_TRUE(map.emplace(2, Tracked{20}).second);
+    EXPECT_FALSE(map.emplace(2, Tracked{30}).second);
+
+    EXPECT_FALSE(map.insert_or_assign(2, Tracked{40}).second);
+    EXPECT_TRUE(map.insert_or_assign(3, Tracked{30}).second);
+    map.insert(4, Tracked{40});
+
+    // Enough elements to go through several rehashes
+    for (int i = 5; i < 1000; ++i)
+        map.try_emplace(i, i * 10);
+
+    EXPECT_EQ(Tracked::copies, 0);
+    EXPECT_EQ(map.size(), 999);
+    EXPECT_EQ(map[1].value, 10);
+    EXPECT_EQ(map[2].value, 40);
+    for (int i = 3; i < 1000; ++i)
+        EXPECT_EQ(map[i].value, i * 10);
+
+    auto found = map.try_emplace(7, 0).first;
+    EXPECT_EQ(found->first, 7);
+    EXPECT_EQ(found->second.value, 70);
+
+    Map<std::string, std::string> strings;
+    std::string key {"key"}, value(100, 'v');
+    strings.try_emplace(std::move(key), std::move(value));
+    EXPECT_TRUE(key.empty());
+    EXPECT_TRUE(value.empty());
+    EXPECT_EQ(strings["key"], std::string(100, 'v'));
+}
+
 TEST(Map, removals) {
     Map<int, std::string> map {{1, "Bob"},  {2, "Alice"}};
 
@@ -92,6 +347,192 @@ TEST(Map, find) {
 
     auto not_found = map.find(0);
     EXPECT_EQ(not_found, map.end());
+
+    EXPECT_EQ(map.count(1), 1);
+    EXPECT_EQ(map.count(0), 0);
+    EXPECT_TRUE(map.contains(2));
+
+    const Map<int, std::string>& const_map = map;
+    auto const_found = const_map.find(2);
+    EXPECT_EQ(const_found->second, "Alice");
+    EXPECT_EQ(const_map.find(0), const_map.cend());
+    EXPECT_EQ(const_map[1], "Bob");
+
+    try {
+        const_map[0];
+        FAIL();
+    }
+    catch (const std::runtime_error& e) {
+        std::string msg = e.what();
+        EXPECT_TRUE(msg ==  "no such key in the map");
+    }
+    EXPECT_EQ(map.size(), 2);
+}
+
+TEST(Map, subscript_inserts) {
+    Map<std::string, int> map;
+    for (int i = 0; i < 1000; ++i)
+        ++map[std::to_string(i % 100)];
+
+    EXPECT_EQ(map.size(), 100);
+    for (int i = 0; i < 100; ++i)
+        EXPECT_EQ(map[std::to_string(i)], 10);
+}
+
+TEST(Map, batch_lookup) {
+    Map<int, int> map;
+    for (int i = 0; i < 1000; i += 2)
+        map.insert(i, i * 3);
+
+    Vector<int> keys;
+    for (int i = 0; i < 1000; ++i)
+        keys.push_back(i);
+
+    Vector<int*> found = map.find_batch(keys);
+    Vector<bool> present = map.contains_batch(keys);
+    EXPECT_EQ(found.size(), 1000);
+    for (int i = 0; i < 1000; ++i) {
+        EXPECT_EQ(present[i], i % 2 == 0);
+        if (i % 2 == 0) {
+            ASSERT_NE(found[i], nullptr);
+            EXPECT_EQ(*found[i], i * 3);
+        }
+        else {
+            EXPECT_EQ(found[i], nullptr);
+        }
+    }
+    *found[10] = -1;
+    EXPECT_EQ(map[10], -1);
+
+    // Keys spread over both tables while an incremental rehash is in progress
+    Map<int, int> incremental;
+    incremental.set_rehash_step(1);
+    for (int i = 0; i < 1000; ++i)
+        incremental.insert(i, i);
+    const Map<int, int>& const_map = incremental;
+    const int* values[1000];
+    const_map.find_batch(&keys[0], keys.size(), values);
+    for (int i = 0; i < 1000; ++i) {
+        ASSERT_NE(values[i], nullptr);
+        EXPECT_EQ(*values[i], i);
+    }
+
+    EXPECT_EQ(map.find_batch(Vector<int>{}).size(), 0);
+}
+
+TEST(Map, parallel_operations) {
+    Vector<std::pair<int, int>> pairs;
+    for (int i = 0; i < 100000; ++i)
+        pairs.push_back({i % 60000, i});  // the keys below 40000 appear twice
+
+    Map<int, int> map {{-1, -1}, {5, 0}};
+    map.parallel_insert(pairs.begin(), pairs.end(), 4);
+    EXPECT_EQ(map.size(), 60001);
+    EXPECT_EQ(map[-1], -1);
+    for (int i = 0; i < 60000; ++i)
+        EXPECT_EQ(map[i], i < 40000 ? i + 60000 : i);
+
+    Map<int, int> serial {{-1, -1}, {5, 0}};
+    serial.insert(pairs.begin(), pairs.end());
+    EXPECT_TRUE(map == serial);
+
+    map.parallel_for_each([](const int&, int& value) { ++value; }, 8);
+    std::atomic<long long> sum {};
+    std::atomic<std::size_t> count {};
+    const Map<int, int>& const_map = map;
+    const_map.parallel_for_each([&](const int& key, const int& value) {
+        EXPECT_EQ(value, key == -1 ? 0 : (key < 40000 ? key + 60001 : key + 1));
+        sum += value;
+        ++count;
+    }, 3);
+    EXPECT_EQ(count, 60001);
+
+    long long expected {};
+    for (auto iter = map.cbegin(); iter != map.cend(); ++iter)
+        expected += iter->second;
+    EXPECT_EQ(sum, expected);
+
+    // A pool resource is not thread safe, so a map that allocates from one is filled serially
+    using Alloc = std::pmr::polymorphic_allocator<std::pair<int, int>>;
+    std::pmr::unsynchronized_pool_resource pool;
+    Map<int, int, std::hash<int>, PrimeSizePolicy, Alloc> pool_map{Alloc{&pool}};
+    pool_map.insert(-1, -1);
+    pool_map.insert(5, 0);
+    pool_map.parallel_insert(pairs.begin(), pairs.end(), 4);
+    EXPECT_EQ(pool_map.size(), 60001);
+    for (int i = 0; i < 60000; ++i)
+        EXPECT_EQ(pool_map[i], i < 40000 ? i + 60000 : i);
+
+    Map<int, int> empty;
+    empty.parallel_insert(pairs.begin(), pairs.begin());
+    EXPECT_TRUE(empty.empty());
+    std::size_t calls {};
+    empty.parallel_for_each([&](const int&, int&) { ++calls; });
+    EXPECT_EQ(calls, 0);
+}
+
+TEST(Map, heterogeneous_lookup) {
+    Map<std::string, int, StringHash> map;
+    map.insert("Bob", 1);
+    map.insert("Alice", 2);
+
+    std::string_view bob {"Bob"};
+    EXPECT_TRUE(map.contains(bob));
+    EXPECT_TRUE(map.contains("Alice"));
+    EXPECT_FALSE(map.contains("John"));
+    EXPECT_TRUE(map.contains(std::string{"Bob"}));
+
+    auto found = map.find(bob);
+    EXPECT_EQ(found->first, "Bob");
+    EXPECT_EQ(found->second, 1);
+    EXPECT_EQ(map.find("John"), map.end());
+
+    EXPECT_EQ(map[bob], 1);
+    map["John"] = 3;
+    EXPECT_EQ(map.size(), 3);
+    EXPECT_EQ(map[std::string{"John"}], 3);
+
+    map.remove(std::string_view{"Alice"});
+    EXPECT_EQ(map.size(), 2);
+    EXPECT_FALSE(map.contains("Alice"));
+
+    try {
+        map.remove("Alice");
+        FAIL();
+    }
+    catch (const std::runtime_error& e) {
+        std::string msg = e.what();
+        EXPECT_TRUE(msg ==  "no such key in the map");
+    }
+}
+
+TEST(Map, iterators) {
+    Map<int, Tracked> map;
+    for (int i = 0; i < 100; ++i)
+        map.try_emplace(i, i);
+
+    Tracked::copies = 0;
+    int sum {};
+    for (auto& p : map) {
+        sum += p.second.value;
+        p.second.value *= 2;
+    }
+    EXPECT_EQ(sum, 4950);
+    EXPECT_EQ(Tracked::copies, 0);
+
+    for (int i = 0; i < 100; ++i)
+        EXPECT_EQ(map[i].value, i * 2);
+
+    auto iter = map.find(10);
+    iter->second.value = -1;
+    (*iter).second.value -= 1;
+    EXPECT_EQ(map[10].value, -2);
+
+    const Map<int, Tracked>& const_map = map;
+    EXPECT_EQ(&const_map.find(10)->second, &map[10]);
+    for (auto citer = const_map.cbegin(); citer != const_map.cend(); ++citer)
+        sum += citer->second.value;
+    EXPECT_EQ(Tracked::copies, 0);
 }
 
 TEST(Map, overloadata_structures) {
@@ -128,6 +569,86 @@ TEST(Map, swap) {
     EXPECT_EQ(map_1[10], "John");
 }
 
+TEST(Map, allocators) {
+    // Every allocation, of the buckets and of the strings in them, comes from the arena
+    using Alloc = std::pmr::polymorphic_allocator<std::pair<int, std::pmr::string>>;
+    std::pmr::monotonic_buffer_resource arena;
+    {
+        DefaultResourceGuard guard;
+        Map<int, std::pmr::string, std::hash<int>, PrimeSizePolicy, Alloc> map{Alloc{&arena}};
+        for (int i = 0; i < 1000; ++i)
+            map[i].assign(40, 'a' + i % 26);
+        EXPECT_EQ(map.size(), 1000);
+        EXPECT_EQ(map.get_allocator().resource(), &arena);
+        EXPECT_EQ(map[999].get_allocator().resource(), &arena);
+
+        Map<int, std::pmr::string, std::hash<int>, PrimeSizePolicy, Alloc> copy(map, Alloc{&arena});
+        EXPECT_TRUE(copy == map);
+
+        auto moved = std::move(map);
+        EXPECT_EQ(moved.size(), 1000);
+        moved.remove(0);
+        moved.clear();
+        EXPECT_TRUE(moved.empty());
+    }
+}
+
+// Propagates on move assignment but compares unequal to an allocator with another counter
+template <typename T>
+struct MovingAllocator {
+    using value_type = T;
+    using propagate_on_container_move_assignment = std::true_type;
+    using is_always_equal = std::false_type;
+
+    long* live;
+
+    explicit MovingAllocator(long* in_live) : live{in_live} {}
+    template <typename U>
+    MovingAllocator(const MovingAllocator<U>& rhs) : live{rhs.live} {}
+
+    T* allocate(std::size_t n) {
+        *live += static_cast<long>(n * sizeof(T));
+        return std::allocator<T>{}.allocate(n);
+    }
+    void deallocate(T* p, std::size_t n) {
+        *live -= static_cast<long>(n * sizeof(T));
+        std::allocator<T>{}.deallocate(p, n);
+    }
+
+    template <typename U>
+    bool operator==(const MovingAllocator<U>& rhs) const { return live == rhs.live; }
+    template <typename U>
+    bool operator!=(const MovingAllocator<U>& rhs) const { return live != rhs.live; }
+};
+
+TEST(Map, move_assignment_propagates) {
+    using Alloc = MovingAllocator<std::pair<int, int>>;
+    long live {};
+    long other_live {};
+    {
+        Map<int, int, std::hash<int>, PrimeSizePolicy, Alloc> map{Alloc{&live}};
+        map.set_rehash_step(1);
+        for (int i = 0; i < 1000; ++i)
+            map.insert(i, i);
+        const int* value = &map[500];
+
+        // The allocator comes along with the tables, so nothing is copied
+        Map<int, int, std::hash<int>, PrimeSizePolicy, Alloc> other{Alloc{&other_live}};
+        other.insert(-1, -1);
+        other = std::move(map);
+        EXPECT_EQ(other.get_allocator().live, &live);
+        EXPECT_EQ(&other[500], value);
+        EXPECT_EQ(other.size(), 1000);
+        EXPECT_FALSE(other.contains(-1));
+        EXPECT_EQ(other_live, 0);
+        EXPECT_TRUE(map.empty());
+        map.insert(1, 1);
+        EXPECT_EQ(map[1], 1);
+    }
+    EXPECT_EQ(live, 0);
+    EXPECT_EQ(other_live, 0);
+}
+
 int main(int argc, char** argv) {
     ::testing::InitGoogleTest(&argc, argv);
     return RUN_ALL_TESTS();
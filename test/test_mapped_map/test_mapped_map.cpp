@@ -0,0 +1,192 @@
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <gtest/gtest.h>
+#include "data_structures.hpp"
+
+using namespace data_structures;
+
+static std::string snapshot_path(const std::string& name) {
+    return ::testing::TempDir() + name;
+}
+
+TEST(MappedMap, round_trip) {
+    Map<int, double> map;
+    for (int i = 0; i < 10000; ++i)
+        map.insert(i, i * 0.5);
+
+    std::string path = snapshot_path("round_trip.snap");
+    save_snapshot(map, path);
+
+    MappedMap<int, double> mapped(path);
+    EXPECT_EQ(mapped.size(), 10000);
+    EXPECT_FALSE(mapped.modified());
+    for (int i = 0; i < 10000; ++i) {
+        const double* v = mapped.find(i);
+        ASSERT_NE(v, nullptr);
+        EXPECT_EQ(*v, i * 0.5);
+    }
+    EXPECT_EQ(mapped.find(-1), nullptr);
+    EXPECT_FALSE(mapped.contains(10000));
+
+    std::remove(path.c_str());
+}
+
+TEST(MappedMap, overlay) {
+    Map<int, int> map {{1, 10}, {2, 20}, {3, 30}};
+    std::string path = snapshot_path("overlay.snap");
+    save_snapshot(map, path);
+
+    MappedMap<int, int> mapped(path);
+    mapped.insert(2, 200);   // shadows the snapshot
+    mapped.insert(4, 40);    // new key
+    EXPECT_TRUE(mapped.remove(3));
+    EXPECT_FALSE(mapped.remove(3));
+    EXPECT_TRUE(mapped.remove(4));
+    mapped.insert(5, 50);
+    EXPECT_TRUE(mapped.modified());
+
+    EXPECT_EQ(mapped.size(), 3);
+    EXPECT_EQ(*mapped.find(1), 10);
+    EXPECT_EQ(*mapped.find(2), 200);
+    EXPECT_FALSE(mapped.contains(3));
+    EXPECT_FALSE(mapped.contains(4));
+    EXPECT_EQ(*mapped.find(5), 50);
+
+    // Saving over the file that is mapped leaves the mapping intact
+    mapped.save(path);
+    EXPECT_EQ(*mapped.find(1), 10);
+
+    MappedMap<int, int> reopened(path);
+    EXPECT_EQ(reopened.size(), 3);
+    EXPECT_FALSE(reopened.modified());
+    EXPECT_EQ(*reopened.find(1), 10);
+    EXPECT_EQ(*reopened.find(2), 200);
+    EXPECT_FALSE(reopened.contains(3));
+    EXPECT_EQ(*reopened.find(5), 50);
+
+    MappedMap<int, int> moved(std::move(reopened));
+    EXPECT_EQ(*moved.find(2), 200);
+
+    std::remove(path.c_str());
+}
+
+TEST(MappedMap, invalid_files) {
+    try {
+        MappedMap<int, int> mapped(snapshot_path("missing.snap"));
+        FAIL();
+    }
+    catch (const std::runtime_error& e) {
+        std::string msg = e.what();
+        EXPECT_TRUE(msg == "cannot open snapshot file");
+    }
+
+    Map<int, int> map {{1, 10}};
+    std::string path = snapshot_path("wrong_type.snap");
+    save_snapshot(map, path);
+    try {
+        MappedMap<int, double> mapped(path);  // the entries have a different layout
+        FAIL();
+    }
+    catch (const std::runtime_error& e) {
+        std::string msg = e.what();
+        EXPECT_TRUE(msg == "invalid snapshot file");
+    }
+
+    std::ofstream{path, std::ios::binary | std::ios::trunc} << "not a snapshot";
+    EXPECT_THROW((MappedMap<int, int>{path}), std::runtime_error);
+
+    std::remove(path.c_str());
+}
+
+TEST(MappedMap, corrupt_files) {
+    Map<int, int> map;
+    for (int i = 0; i < 1000; ++i)
+        map.insert(i, i);
+    std::string path = snapshot_path("corrupt.snap");
+    save_snapshot(map, path);
+
+    std::string bytes;
+    {
+        std::ifstream in{path, std::ios::binary};
+        bytes.assign(std::istreambuf_iterator<char>{in}, std::istreambuf_iterator<char>{});
+    }
+    auto write_file = [&](const std::string& data) {
+        std::ofstream{path, std::ios::binary | std::ios::trunc}.write(data.data(), data.size());
+    };
+
+    // Truncated in the middle of the entries
+    write_file(bytes.substr(0, bytes.size() - sizeof(SnapshotEntry<int,int>)));
+    EXPECT_THROW((MappedMap<int, int>{path}), std::runtime_error);
+
+    // A bucket count whose offsets table would overflow the size computation
+    std::string huge = bytes;
+    std::uint64_t buckets = ~std::uint64_t{0} / sizeof(std::uint64_t);
+    std::memcpy(&huge[offsetof(SnapshotHeader, buckets)], &buckets, sizeof(buckets));
+    write_file(huge);
+    EXPECT_THROW((MappedMap<int, int>{path}), std::runtime_error);
+
+    // A last offset that does not match the size is caught at open
+    std::string bad_end = bytes;
+    std::uint64_t offset = 1u << 30;
+    std::uint64_t snapshot_buckets;
+    std::memcpy(&snapshot_buckets, &bytes[offsetof(SnapshotHeader, buckets)], sizeof(snapshot_buckets));
+    std::memcpy(&bad_end[snapshot::offsets_offset() + snapshot_buckets * sizeof(std::uint64_t)], &offset, sizeof(offset));
+    write_file(bad_end);
+    EXPECT_THROW((MappedMap<int, int>{path}), std::runtime_error);
+
+    // An offset past the entries in the middle of the table is only read, and caught,
+    // by a lookup of the buckets around it (key 0 and key 1 hash to buckets 0 and 1)
+    std::string bad_offset = bytes;
+    std::memcpy(&bad_offset[snapshot::offsets_offset() + sizeof(std::uint64_t)], &offset, sizeof(offset));
+    write_file(bad_offset);
+    {
+        MappedMap<int, int> corrupt{path};
+        EXPECT_THROW(corrupt.find(0), std::runtime_error);
+        EXPECT_THROW(corrupt.find(1), std::runtime_error);
+        EXPECT_EQ(*corrupt.find(500), 500);
+    }
+
+    write_file(bytes);
+    EXPECT_EQ((MappedMap<int, int>{path}).size(), 1000);
+
+    std::remove(path.c_str());
+}
+
+struct SeededHash {
+    std::size_t seed {};
+    std::size_t operator()(int key) const { return std::hash<int>{}(key) ^ seed; }
+};
+
+TEST(MappedMap, hash_and_policy_mismatch) {
+    Map<int, int, SeededHash> seeded{SeededHash{0x9e3779b9}};
+    for (int i = 0; i < 1000; ++i)
+        seeded.insert(i, i);
+    std::string path = snapshot_path("mismatch.snap");
+
+    // The snapshot is laid out with the map's own hasher, seed included
+    save_snapshot(seeded, path);
+    MappedMap<int, int, SeededHash> mapped(path, SeededHash{0x9e3779b9});
+    for (int i = 0; i < 1000; ++i)
+        EXPECT_EQ(*mapped.find(i), i);
+    EXPECT_THROW((MappedMap<int, int, SeededHash>{path, SeededHash{1}}), std::runtime_error);
+
+    Map<int, int, std::hash<int>, PowerOfTwoPolicy> pow2_map;
+    for (int i = 0; i < 1000; ++i)
+        pow2_map.insert(i, i);
+    save_snapshot(pow2_map, path);
+    EXPECT_THROW((MappedMap<int, int>{path}), std::runtime_error);
+    MappedMap<int, int, std::hash<int>, PowerOfTwoPolicy> pow2_mapped(path);
+    EXPECT_EQ(*pow2_mapped.find(999), 999);
+
+    std::remove(path.c_str());
+}
+
+int main(int argc, char** argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -1,5 +1,8 @@
+#include <functional>
+#include <memory_resource>
 #include <gtest/gtest.h>
 #include "data_structures.hpp"
+#include "TestResources.hpp"
 
 using namespace data_structures;
 
@@ -108,6 +111,34 @@ TEST(PriorityQueue, swap) {
     }
 }
 
+TEST(PriorityQueue, allocators) {
+    using Alloc = std::pmr::polymorphic_allocator<int>;
+    TrackingResource resource;
+    TrackingResource other_resource;
+    {
+        DefaultResourceGuard guard;
+        PriorityQueue<int, std::less<int>, Alloc> pq{std::less<int>{}, Alloc{&resource}};
+        for (int i = 0; i < 1000; ++i)
+            pq.insert(i);
+        EXPECT_GT(resource.live(), 0);
+
+        // The allocators are unequal and do not propagate, so the elements move into the
+        // memory of the other resource and each buffer is freed by the resource it came from
+        PriorityQueue<int, std::less<int>, Alloc> other{std::less<int>{}, Alloc{&other_resource}};
+        other.insert(-1);
+        other = std::move(pq);
+        EXPECT_EQ(other.get_allocator().resource(), &other_resource);
+        EXPECT_EQ(other.size(), 1000);
+        EXPECT_TRUE(pq.empty());
+        for (int i = 999; i >= 0; --i) {
+            EXPECT_EQ(other.top(), i);
+            other.pop();
+        }
+    }
+    EXPECT_EQ(resource.live(), 0);
+    EXPECT_EQ(other_resource.live(), 0);
+}
+
 int main(int argc, char** argv) {
     ::testing::InitGoogleTest(&argc, argv);
     return RUN_ALL_TESTS();
@@ -0,0 +1,103 @@
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+#include <gtest/gtest.h>
+#include "data_structures.hpp"
+
+using namespace data_structures;
+
+TEST(RcuMap, constructors) {
+    RcuMap<int, std::string> default_map;
+    EXPECT_EQ(default_map.size(), 0);
+    EXPECT_EQ(default_map.empty(), true);
+    EXPECT_EQ(default_map.capacity(), 64);
+    EXPECT_FALSE(default_map.find(1).has_value());
+}
+
+TEST(RcuMap, operations) {
+    RcuMap<int, std::string> map;
+
+    map.insert(1, "Bob");
+    map.insert(2, "Alice");
+    map.insert(65, "John");  // same bucket as 1
+    EXPECT_EQ(map.size(), 3);
+    EXPECT_EQ(map.find(1).value(), "Bob");
+    EXPECT_EQ(map.find(65).value(), "John");
+
+    map.insert(1, "New Bob");
+    EXPECT_EQ(map.size(), 3);
+    EXPECT_EQ(map.find(1).value(), "New Bob");
+    EXPECT_EQ(map.find(65).value(), "John");
+
+    std::size_t length {};
+    EXPECT_TRUE(map.visit(2, [&](const std::string& v) { length = v.size(); }));
+    EXPECT_EQ(length, 5);
+    EXPECT_FALSE(map.visit(3, [&](const std::string& v) { length = v.size(); }));
+
+    EXPECT_TRUE(map.remove(65));
+    EXPECT_FALSE(map.remove(65));
+    EXPECT_FALSE(map.contains(65));
+    EXPECT_TRUE(map.contains(1));
+    EXPECT_EQ(map.size(), 2);
+
+    map.clear();
+    EXPECT_EQ(map.empty(), true);
+    EXPECT_FALSE(map.contains(1));
+}
+
+TEST(RcuMap, rehash) {
+    RcuMap<int, int> map;
+    for (int i = 0; i < 10000; ++i)
+        map.insert(i, i);
+
+    EXPECT_EQ(map.size(), 10000);
+    EXPECT_GE(map.capacity(), 10000);
+    for (int i = 0; i < 10000; ++i)
+        EXPECT_EQ(map.find(i).value(), i);
+}
+
+TEST(RcuMap, concurrent_readers) {
+    RcuMap<int, int> map;
+    for (int i = 0; i < 1000; ++i)
+        map.insert(i, i * 2);
+
+    std::atomic<bool> done {false};
+    std::atomic<int> errors {};
+
+    std::vector<std::thread> readers;
+    for (int t = 0; t < 4; ++t) {
+        readers.emplace_back([&] {
+            while (!done.load()) {
+                for (int i = 0; i < 1000; ++i) {
+                    auto v = map.find(i);  // the first 1000 keys are never removed
+                    if (!v || (*v != i * 2 && *v != i * 3))
+                        ++errors;
+                }
+            }
+        });
+    }
+
+    for (int i = 1000; i < 20000; ++i)
+        map.insert(i, i);
+    for (int i = 0; i < 1000; ++i)
+        map.insert(i, i * 3);
+    for (int i = 1000; i < 20000; i += 2)
+        map.remove(i);
+
+    done.store(true);
+    for (auto& t : readers)
+        t.join();
+
+    EXPECT_EQ(errors.load(), 0);
+    EXPECT_EQ(map.size(), 10500);
+    EXPECT_EQ(map.find(0).value(), 0);
+    EXPECT_EQ(map.find(999).value(), 2997);
+    EXPECT_FALSE(map.contains(1000));
+    EXPECT_TRUE(map.contains(1001));
+}
+
+int main(int argc, char** argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
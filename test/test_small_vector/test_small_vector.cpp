@@ -0,0 +1,153 @@
+#include <string>
+#include <gtest/gtest.h>
+#include "data_structures.hpp"
+
+using namespace data_structures;
+
+TEST(SmallVector, constructors) {
+    SmallVector<int, 4> default_vec;
+    EXPECT_EQ(default_vec.size(), 0);
+    EXPECT_EQ(default_vec.capacity(), 4);
+    EXPECT_TRUE(default_vec.inlined());
+
+    SmallVector<int, 4> sized_vec(3);
+    EXPECT_EQ(sized_vec.size(), 3);
+    EXPECT_EQ(sized_vec[2], 0);
+
+    SmallVector<std::string, 2> value_vec(5, "a");
+    EXPECT_EQ(value_vec.size(), 5);
+    EXPECT_FALSE(value_vec.inlined());
+    EXPECT_EQ(value_vec[4], "a");
+
+    SmallVector<std::string, 2> initializer_vec {"a", "b"};
+    EXPECT_TRUE(initializer_vec.inlined());
+    EXPECT_EQ(initializer_vec[1], "b");
+
+    SmallVector<std::string, 2> copy_vec(value_vec);
+    EXPECT_TRUE(copy_vec == value_vec);
+
+    // Heap buffers are stolen, inline elements are moved one by one
+    SmallVector<std::string, 2> move_heap(std::move(value_vec));
+    EXPECT_EQ(move_heap.size(), 5);
+    EXPECT_TRUE(value_vec.empty());
+    EXPECT_TRUE(value_vec.inlined());
+
+    SmallVector<std::string, 2> move_inline(std::move(initializer_vec));
+    EXPECT_TRUE(move_inline.inlined());
+    EXPECT_EQ(move_inline[0], "a");
+    EXPECT_TRUE(initializer_vec.empty());
+}
+
+TEST(SmallVector, spill) {
+    SmallVector<std::string, 3> vec;
+    for (int i = 0; i < 3; ++i)
+        vec.push_back(std::to_string(i));
+    EXPECT_TRUE(vec.inlined());
+
+    vec.push_back(vec[0]);  // an element of the vector itself, while it moves to the heap
+    EXPECT_FALSE(vec.inlined());
+    EXPECT_EQ(vec.size(), 4);
+    EXPECT_EQ(vec.back(), "0");
+    for (int i = 0; i < 3; ++i)
+        EXPECT_EQ(vec[i], std::to_string(i));
+
+    vec.emplace_back(3, 'x');
+    EXPECT_EQ(vec.back(), "xxx");
+    vec.pop_back();
+    vec.pop_back();
+    EXPECT_EQ(vec.size(), 3);
+}
+
+TEST(SmallVector, insert_erase) {
+    SmallVector<int, 4> vec {1, 2, 4};
+    auto iter = vec.insert(vec.begin() + 2, 3);
+    EXPECT_EQ(*iter, 3);
+    vec.insert(vec.end(), 5);
+    vec.insert(vec.begin(), 0);
+    EXPECT_EQ(vec.size(), 6);
+    for (int i = 0; i < 6; ++i)
+        EXPECT_EQ(vec[i], i);
+
+    iter = vec.erase(vec.begin() + 1);
+    EXPECT_EQ(*iter, 2);
+    vec.erase(vec.find(5));
+    EXPECT_EQ(vec.size(), 4);
+    EXPECT_EQ(vec.back(), 4);
+    EXPECT_EQ(vec.find(1), vec.end());
+
+    try {
+        vec.erase(vec.end());
+        FAIL();
+    }
+    catch (const std::invalid_argument& e) {
+        std::string msg = e.what();
+        EXPECT_TRUE(msg == "invalid position");
+    }
+}
+
+TEST(SmallVector, access) {
+    SmallVector<int, 2> vec;
+    try {
+        vec.front();
+        FAIL();
+    }
+    catch (const std::runtime_error& e) {
+        std::string msg = e.what();
+        EXPECT_TRUE(msg == "vector is empty");
+    }
+
+    vec.push_back(1);
+    vec.push_back(2);
+    EXPECT_EQ(vec.front(), 1);
+    EXPECT_EQ(vec.at(1), 2);
+    EXPECT_THROW(vec.at(2), std::invalid_argument);
+
+    int sum {};
+    for (auto iter = vec.cbegin(); iter != vec.cend(); ++iter)
+        sum += *iter;
+    EXPECT_EQ(sum, 3);
+}
+
+TEST(SmallVector, swap) {
+    SmallVector<std::string, 2> small {"a"};
+    SmallVector<std::string, 2> large {"b", "c", "d"};
+    SmallVector<std::string, 2> other_large {"e", "f", "g", "h"};
+
+    small.swap(large);
+    EXPECT_EQ(small.size(), 3);
+    EXPECT_EQ(large.size(), 1);
+    EXPECT_EQ(large[0], "a");
+    EXPECT_EQ(small[2], "d");
+
+    small.swap(other_large);
+    EXPECT_EQ(small.size(), 4);
+    EXPECT_EQ(other_large[0], "b");
+
+    large = other_large;
+    EXPECT_TRUE(large == other_large);
+    large = SmallVector<std::string, 2>{"z"};
+    EXPECT_EQ(large.size(), 1);
+    EXPECT_TRUE(large != other_large);
+}
+
+TEST(SmallVector, resize) {
+    SmallVector<int, 4> vec;
+    vec.resize(2);
+    EXPECT_TRUE(vec.inlined());
+    vec.resize(10, 7);
+    EXPECT_EQ(vec.size(), 10);
+    EXPECT_EQ(vec[1], 0);
+    EXPECT_EQ(vec[9], 7);
+    vec.resize(1);
+    EXPECT_EQ(vec.size(), 1);
+
+    vec.reserve(100);
+    EXPECT_EQ(vec.capacity(), 100);
+    vec.clear();
+    EXPECT_TRUE(vec.empty());
+}
+
+int main(int argc, char** argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
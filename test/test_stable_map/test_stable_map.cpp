@@ -0,0 +1,130 @@
+#include <string>
+#include <gtest/gtest.h>
+#include "data_structures.hpp"
+
+using namespace data_structures;
+
+TEST(StableMap, constructors) {
+    StableMap<int, std::string> default_map;
+    EXPECT_EQ(default_map.size(), 0);
+    EXPECT_EQ(default_map.empty(), true);
+    EXPECT_EQ(default_map.begin(), default_map.end());
+
+    StableMap<int, std::string> initializer_map {{1, "Bob"},  {2, "Alice"}};
+    EXPECT_EQ(initializer_map.size(), 2);
+    EXPECT_EQ(initializer_map[1], "Bob");
+    EXPECT_EQ(initializer_map[2], "Alice");
+
+    StableMap<int, std::string> copy_map(initializer_map);
+    EXPECT_EQ(copy_map.size(), 2);
+    EXPECT_TRUE(copy_map == initializer_map);
+
+    std::string* bob = &initializer_map[1];
+    StableMap<int, std::string> move_map(std::move(initializer_map));
+    EXPECT_EQ(move_map.size(), 2);
+    EXPECT_EQ(initializer_map.empty(), true);
+    EXPECT_EQ(&move_map[1], bob);
+
+    initializer_map.insert(3, "John");
+    EXPECT_EQ(initializer_map.size(), 1);
+    EXPECT_EQ(initializer_map[3], "John");
+}
+
+TEST(StableMap, operations) {
+    StableMap<int, std::string> map;
+
+    map.insert(1, "Chris");
+    map.insert(54, "Anna");  // same bucket as 1
+    map[2] = "John";
+    EXPECT_EQ(map.size(), 3);
+
+    map.insert(1, "New Chris");
+    EXPECT_EQ(map.size(), 3);
+    EXPECT_EQ(map[1], "New Chris");
+
+    auto found = map.find(54);
+    EXPECT_EQ(found->second, "Anna");
+    found->second = "New Anna";
+    EXPECT_EQ(map[54], "New Anna");
+    EXPECT_EQ(map.find(0), map.end());
+    EXPECT_EQ(map.count(2), 1);
+
+    try {
+        map.remove(0);
+        FAIL();
+    }
+    catch (const std::runtime_error& e) {
+        std::string msg = e.what();
+        EXPECT_TRUE(msg ==  "no such key in the map");
+    }
+
+    map.remove(1);
+    EXPECT_EQ(map.size(), 2);
+    EXPECT_FALSE(map.contains(1));
+    EXPECT_EQ(map[54], "New Anna");
+
+    int count {};
+    for (auto& p : map) {
+        ++count;
+        EXPECT_TRUE(p.first == 2 || p.first == 54);
+    }
+    EXPECT_EQ(count, 2);
+
+    map.clear();
+    EXPECT_EQ(map.size(), 0);
+    EXPECT_EQ(map.cbegin(), map.cend());
+}
+
+TEST(StableMap, try_emplace) {
+    StableMap<int, std::string> map;
+    auto result = map.try_emplace(1, 3, 'a');
+    EXPECT_TRUE(result.second);
+    EXPECT_EQ(result.first->second, "aaa");
+
+    result = map.try_emplace(1, 3, 'b');
+    EXPECT_FALSE(result.second);
+    EXPECT_EQ(result.first->second, "aaa");
+    EXPECT_EQ(map.size(), 1);
+}
+
+TEST(StableMap, pointer_stability) {
+    StableMap<int, int> map;
+    map.insert(0, 0);
+    int* first = &map[0];
+
+    Vector<int*> values;
+    for (int i = 1; i < 10000; ++i) {
+        map.insert(i, i);
+        values.push_back(&map[i]);
+    }
+    EXPECT_GT(map.capacity(), 10000);
+
+    EXPECT_EQ(first, &map[0]);
+    for (int i = 1; i < 10000; ++i)
+        EXPECT_EQ(values[i - 1], &map[i]);
+}
+
+TEST(StableMap, node_reuse) {
+    StableMap<int, int> map;
+    for (int i = 0; i < 100; ++i)
+        map.insert(i, i);
+    int* removed = &map[50];
+
+    map.remove(50);
+    map.insert(1000, 1000);
+    EXPECT_EQ(&map[1000], removed);  // the freed node is handed out again
+
+    for (int round = 0; round < 100; ++round) {
+        for (int i = 0; i < 100; ++i)
+            map.remove(i == 50 ? 1000 : i);
+        for (int i = 0; i < 100; ++i)
+            map.insert(i == 50 ? 1000 : i, round);
+    }
+    EXPECT_EQ(map.size(), 100);
+    EXPECT_EQ(map[1000], 99);
+}
+
+int main(int argc, char** argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -1,5 +1,7 @@
+#include <memory_resource>
 #include <gtest/gtest.h>
 #include "data_structures.hpp"
+#include "TestResources.hpp"
 
 using namespace data_structures;
 
@@ -33,6 +35,21 @@ TEST(Trie, removals) {
     EXPECT_EQ(trie.size(), 3);
 }
 
+TEST(Trie, allocators) {
+	std::pmr::monotonic_buffer_resource arena;
+	{
+		DefaultResourceGuard guard;
+		BasicTrie<std::pmr::polymorphic_allocator<char>> trie{std::pmr::polymorphic_allocator<char>{&arena}};
+		trie.insert("arena");
+		trie.insert("area");
+		trie.remove("area");
+		EXPECT_EQ(trie.size(), 1);
+		EXPECT_TRUE(trie.search("arena"));
+		EXPECT_TRUE(trie.starts_with("are"));
+		EXPECT_EQ(trie.get_allocator().resource(), &arena);
+	}
+}
+
 TEST(Trie, searches) {
     Trie trie {"dog", "car", "orange", "split"};
 
@@ -1,12 +1,21 @@
+#include <cstdint>
+#include <iterator>
+#include <limits>
+#include <memory_resource>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
 #include <gtest/gtest.h>
 #include "data_structures.hpp"
+#include "TestResources.hpp"
 
 using namespace data_structures;
 
 TEST(Vector, constructors) {
     Vector<int> default_vector;
     EXPECT_EQ(default_vector.size(), 0);
-    EXPECT_EQ(default_vector.capacity(), 10);
+    EXPECT_EQ(default_vector.capacity(), 0);
 
     Vector<int> vector_size(5);
     EXPECT_EQ(vector_size.size(), 5);
@@ -70,6 +79,72 @@ TEST(Vector, removals) {
     EXPECT_EQ(vector.capacity(), 10);
 }
 
+TEST(Vector, range_operations) {
+    Vector<int> vector {0, 1, 5, 6};
+    int middle[] = {2, 3, 4};
+    auto iter = vector.insert(vector.begin() + 2, std::begin(middle), std::end(middle));
+    EXPECT_EQ(*iter, 2);
+    EXPECT_EQ(vector.size(), 7);
+    for (int i = 0; i < 7; ++i)
+        EXPECT_EQ(vector[i], i);
+
+    vector.append_range(std::vector<int>{7, 8, 9, 10, 11});  // grows past the capacity
+    EXPECT_EQ(vector.size(), 12);
+    EXPECT_EQ(vector.end() - vector.begin(), 12);
+    for (int i = 0; i < 12; ++i)
+        EXPECT_EQ(vector[i], i);
+
+    iter = vector.erase(vector.begin() + 1, vector.begin() + 11);
+    EXPECT_EQ(*iter, 11);
+    EXPECT_EQ(vector.size(), 2);
+    EXPECT_EQ(vector[0], 0);
+    EXPECT_EQ(vector[1], 11);
+    EXPECT_EQ(vector.erase(vector.begin(), vector.begin()), vector.begin());
+
+    iter = vector.erase(vector.begin() + 1);
+    EXPECT_EQ(iter, vector.end());
+    vector.insert(vector.end(), 12);
+    EXPECT_EQ(vector.back(), 12);
+
+    // Elements that are not trivially copyable, with tails both shorter and longer than the range
+    Vector<std::string> strings {"a", "e"};
+    std::vector<std::string> bcd {"b", "c", "d"};
+    strings.insert(strings.begin() + 1, bcd.begin(), bcd.end());
+    strings.insert(strings.begin(), std::string{"_"});
+    strings.insert(strings.begin() + 1, strings[5]);  // an element of the vector itself
+    const Vector<std::string>& const_strings = strings;
+    std::string joined;
+    for (const auto& str : const_strings)
+        joined += str;
+    EXPECT_EQ(joined, "_eabcde");
+
+    strings.erase(strings.begin(), strings.begin() + 2);
+    strings.append_range(Vector<std::string>{"f", "g"});
+    std::vector<std::string> tail {"x", "y"};
+    strings.insert(strings.begin() + 5, tail.begin(), tail.end());
+    joined.clear();
+    for (const auto& str : const_strings)
+        joined += str;
+    EXPECT_EQ(joined, "abcdexyfg");
+
+    // A single pass range is appended and rotated into place
+    std::istringstream input {"1 2 3"};
+    Vector<int> numbers {0, 4};
+    numbers.insert(numbers.begin() + 1, std::istream_iterator<int>{input}, std::istream_iterator<int>{});
+    EXPECT_EQ(numbers.size(), 5);
+    for (int i = 0; i < 5; ++i)
+        EXPECT_EQ(numbers[i], i);
+
+    try {
+        numbers.erase(numbers.begin() + 3, numbers.begin() + 1);
+        FAIL();
+    }
+    catch (const std::invalid_argument& e) {
+        std::string msg = e.what();
+        EXPECT_TRUE(msg == "invalid position");
+    }
+}
+
 TEST(Vector, access) {
     Vector<int> vector;
 
@@ -120,6 +195,128 @@ TEST(Vector, find) {
 
     Vector<int>::iterator not_found = vector.find(0);
     EXPECT_EQ(not_found, vector.end());
+
+    const Vector<std::string> words {"a", "b", "a"};
+    EXPECT_EQ(*words.find("b"), "b");
+    EXPECT_EQ(words.count("a"), 2);
+    EXPECT_EQ(words.min(), "a");
+    EXPECT_EQ(words.max(), "b");
+    EXPECT_EQ(words.sum(), "aba");
+    EXPECT_THROW(Vector<int>{}.min(), std::runtime_error);
+    EXPECT_EQ(Vector<int>{}.sum(), 0);
+}
+
+// Every kernel must agree with the plain loops, at every length around the register widths
+template <typename T>
+void check_kernels(T low, T high) {
+    Vector<T> vec;
+    for (std::size_t n = 0; n < 300; n += n < 70 ? 1 : 37) {
+        vec.clear();
+        for (std::size_t i = 0; i < n; ++i)
+            vec.push_back(static_cast<T>(i * 7 % 11 == 3 ? high : i * 5 % 13 == 1 ? low : static_cast<T>(i % 5)));
+        const T* p = n ? &vec[0] : nullptr;
+
+        for (T value : {low, high, static_cast<T>(2), static_cast<T>(9)}) {
+            EXPECT_EQ(simd::find(p, n, value), simd::find_scalar(p, n, value));
+            EXPECT_EQ(simd::count(p, n, value), simd::count_scalar(p, n, value));
+#if defined(DATA_STRUCTURES_HAS_SSE2)
+            EXPECT_EQ(simd::find_sse2(p, n, value), simd::find_scalar(p, n, value));
+            EXPECT_EQ(simd::count_sse2(p, n, value), simd::count_scalar(p, n, value));
+#endif
+#if defined(DATA_STRUCTURES_HAS_AVX2)
+            if (simd::has_avx2) {
+                EXPECT_EQ(simd::find_avx2(p, n, value), simd::find_scalar(p, n, value));
+                EXPECT_EQ(simd::count_avx2(p, n, value), simd::count_scalar(p, n, value));
+            }
+#endif
+#if defined(DATA_STRUCTURES_HAS_AVX512)
+            if (simd::has_avx512) {
+                EXPECT_EQ(simd::find_avx512(p, n, value), simd::find_scalar(p, n, value));
+                EXPECT_EQ(simd::count_avx512(p, n, value), simd::count_scalar(p, n, value));
+            }
+#endif
+        }
+        if (!n)
+            continue;
+
+        const T min = simd::reduce_scalar<simd::Reduction::min>(p, n);
+        const T max = simd::reduce_scalar<simd::Reduction::max>(p, n);
+        const T sum = simd::reduce_scalar<simd::Reduction::sum>(p, n);
+        EXPECT_EQ(vec.min(), min);
+        EXPECT_EQ(vec.max(), max);
+        EXPECT_EQ(vec.sum(), sum);
+#if defined(DATA_STRUCTURES_HAS_SSE2)
+        if constexpr (simd::has_minmax_sse2_v<T>) {
+            EXPECT_EQ((simd::reduce_sse2<simd::Reduction::min>(p, n)), min);
+            EXPECT_EQ((simd::reduce_sse2<simd::Reduction::max>(p, n)), max);
+        }
+        EXPECT_EQ((simd::reduce_sse2<simd::Reduction::sum>(p, n)), sum);
+#endif
+#if defined(DATA_STRUCTURES_HAS_AVX2)
+        if (simd::has_avx2) {
+            EXPECT_EQ((simd::reduce_avx2<simd::Reduction::min>(p, n)), min);
+            EXPECT_EQ((simd::reduce_avx2<simd::Reduction::max>(p, n)), max);
+            EXPECT_EQ((simd::reduce_avx2<simd::Reduction::sum>(p, n)), sum);
+        }
+#endif
+#if defined(DATA_STRUCTURES_HAS_AVX512)
+        if (simd::has_avx512) {
+            EXPECT_EQ((simd::reduce_avx512<simd::Reduction::min>(p, n)), min);
+            EXPECT_EQ((simd::reduce_avx512<simd::Reduction::max>(p, n)), max);
+            EXPECT_EQ((simd::reduce_avx512<simd::Reduction::sum>(p, n)), sum);
+        }
+#endif
+
+        // Equal arrays, then arrays that differ in the last element only
+        Vector<T> copy(vec);
+        for (bool same : {true, false}) {
+            if (!same)
+                copy[n - 1] = copy[n - 1] == low ? high : low;
+            EXPECT_EQ(simd::equal(p, &copy[0], n), same);
+            EXPECT_EQ(simd::equal_scalar(p, &copy[0], n), same);
+#if defined(DATA_STRUCTURES_HAS_SSE2)
+            EXPECT_EQ(simd::equal_sse2(p, &copy[0], n), same);
+#endif
+#if defined(DATA_STRUCTURES_HAS_AVX2)
+            if (simd::has_avx2) {
+                EXPECT_EQ(simd::equal_avx2(p, &copy[0], n), same);
+            }
+#endif
+#if defined(DATA_STRUCTURES_HAS_AVX512)
+            if (simd::has_avx512) {
+                EXPECT_EQ(simd::equal_avx512(p, &copy[0], n), same);
+            }
+#endif
+        }
+        EXPECT_FALSE(vec == copy);
+    }
+}
+
+TEST(Vector, simd) {
+    check_kernels<std::int8_t>(-128, 127);
+    check_kernels<std::uint8_t>(0, 255);
+    check_kernels<std::int16_t>(-32768, 32767);
+    check_kernels<std::uint16_t>(0, 65535);
+    check_kernels<std::int32_t>(-2000000000, 2000000000);
+    check_kernels<std::uint32_t>(0, 4000000000u);
+    check_kernels<std::int64_t>(-(std::int64_t{1} << 62), std::int64_t{1} << 62);
+    check_kernels<std::uint64_t>(0, ~std::uint64_t{});
+    check_kernels<float>(-1.5f, 256.25f);    // sums of these are exact in any order
+    check_kernels<double>(-1e6, 0.25);
+
+    // Floating point lanes compare as numbers: NaN equals nothing, -0.0 equals 0.0
+    Vector<double> nan(40, 1.0);
+    nan[33] = std::numeric_limits<double>::quiet_NaN();
+    EXPECT_FALSE(nan == nan);
+    EXPECT_EQ(nan.count(nan[33]), 0);
+    Vector<float> zeros(40, 0.0f);
+    Vector<float> negative_zeros(40, -0.0f);
+    EXPECT_TRUE(zeros == negative_zeros);
+    EXPECT_EQ(zeros.find(-0.0f), zeros.begin());
+
+    // Integer sums wrap around in the element type
+    Vector<std::uint8_t> bytes(1000, 1);
+    EXPECT_EQ(bytes.sum(), 1000 % 256);
 }
 
 TEST(Vector, overloadata_structures) {
@@ -136,8 +333,284 @@ TEST(Vector, overloadata_structures) {
     EXPECT_EQ(move_vector.size(), 11);
     EXPECT_EQ(move_vector.capacity(), 20);
     EXPECT_EQ(vector.empty(), true);
+    EXPECT_EQ(vector.capacity(), 0);
+}
+
+TEST(Vector, lazy_allocation) {
+    Vector<std::string> vector;
+    EXPECT_EQ(vector.capacity(), 0);
+    EXPECT_EQ(vector.begin(), vector.end());
+    for (auto& s : vector)
+        FAIL() << s;
+
+    Vector<std::string> empty_copy(vector);
+    EXPECT_EQ(empty_copy.capacity(), 0);
+    EXPECT_EQ(Vector<int>(0).capacity(), 0);
+    EXPECT_EQ(Vector<int>(0, 1).capacity(), 0);
+
+    vector.push_back("a");
     EXPECT_EQ(vector.capacity(), 10);
+    EXPECT_EQ(vector[0], "a");
+
+    // Moving steals the buffer and leaves the source without one
+    Vector<std::string> moved(std::move(vector));
+    EXPECT_EQ(moved.size(), 1);
+    EXPECT_EQ(moved.capacity(), 10);
+    EXPECT_EQ(vector.capacity(), 0);
+    EXPECT_TRUE(vector.empty());
+
+    vector.emplace_back("b");
+    EXPECT_EQ(vector.size(), 1);
+    EXPECT_EQ(vector[0], "b");
+
+    Vector<std::string> reserved;
+    reserved.reserve(3);
+    EXPECT_EQ(reserved.capacity(), 3);
+}
+
+struct ThrowingMove {
+    static int copies;
+    int value {};
+
+    ThrowingMove() = default;
+    explicit ThrowingMove(int in_value) : value{in_value} {}
+    ThrowingMove(const ThrowingMove& rhs) : value{rhs.value} { ++copies; }
+    ThrowingMove(ThrowingMove&& rhs) noexcept(false) : value{rhs.value} {}
+    ThrowingMove& operator=(const ThrowingMove&) = default;
+};
+
+int ThrowingMove::copies = 0;
+
+struct alignas(64) Aligned {
+    int value;
+};
+
+TEST(Vector, reallocation) {
+    // Trivially copyable elements are grown with realloc()
+    Vector<float> floats;
+    for (int i = 0; i < 100000; ++i)
+        floats.push_back(i * 0.5f);
+    floats.reserve(1000000);
+    EXPECT_EQ(floats.size(), 100000);
+    for (int i = 0; i < 100000; ++i)
+        EXPECT_EQ(floats[i], i * 0.5f);
+
+    Vector<Aligned> aligned;
+    for (int i = 0; i < 100; ++i)
+        aligned.push_back(Aligned{i});
+    EXPECT_EQ(reinterpret_cast<std::uintptr_t>(&aligned[0]) % 64, 0);
+    EXPECT_EQ(aligned[99].value, 99);
+
+    // A move constructor that may throw is not used, so a failed reallocation could not lose elements
+    Vector<ThrowingMove> throwing;
+    for (int i = 0; i < 10; ++i)
+        throwing.emplace_back(i);
+    ThrowingMove::copies = 0;
+    throwing.emplace_back(10);
+    EXPECT_EQ(ThrowingMove::copies, 10);
+    EXPECT_EQ(throwing[10].value, 10);
+
+    // Strings have a nothrow move constructor and are moved
+    Vector<std::string> strings;
+    for (int i = 0; i < 50; ++i)
+        strings.push_back(std::string(40, 'a' + i % 26));
+    EXPECT_EQ(strings[49], std::string(40, 'a' + 49 % 26));
+}
+
+// Counts its live instances and throws from the copy that brings copies_left to 0
+struct ThrowingCopy {
+    static int live;
+    static int copies_left;
+    int value {};
+
+    explicit ThrowingCopy(int in_value) : value{in_value} { ++live; }
+    ThrowingCopy(const ThrowingCopy& rhs) : value{rhs.value} {
+        if (--copies_left == 0)
+            throw std::runtime_error("copy failed");
+        ++live;
+    }
+    ThrowingCopy(ThrowingCopy&& rhs) noexcept : value{rhs.value} { ++live; }
+    ThrowingCopy& operator=(const ThrowingCopy&) = default;
+    ThrowingCopy& operator=(ThrowingCopy&&) = default;
+    ~ThrowingCopy() { --live; }
+};
+
+int ThrowingCopy::live = 0;
+int ThrowingCopy::copies_left = 0;
+
+// Trivially copyable, but the conversion from int can throw
+struct ThrowingConversion {
+    static int conversions_left;
+    int value {};
+
+    ThrowingConversion(int in_value) : value{in_value} {
+        if (--conversions_left == 0)
+            throw std::runtime_error("conversion failed");
+    }
+};
+
+int ThrowingConversion::conversions_left = 0;
+
+TEST(Vector, insert_exception_safety) {
+    {
+        std::vector<ThrowingCopy> source;
+        for (int i = 0; i < 5; ++i)
+            source.emplace_back(100 + i);
+
+        for (std::size_t index : {0, 3, 6}) {
+            Vector<ThrowingCopy> vec;
+            vec.reserve(20);
+            for (int i = 0; i < 6; ++i)
+                vec.emplace_back(i);
+            int live = ThrowingCopy::live;
+
+            // The fourth copy of the range throws
+            ThrowingCopy::copies_left = 4;
+            EXPECT_THROW(vec.insert(vec.begin() + index, source.begin(), source.end()), std::runtime_error);
+            EXPECT_EQ(ThrowingCopy::live, live);
+            ASSERT_EQ(vec.size(), 6);
+            for (int i = 0; i < 6; ++i)
+                EXPECT_EQ(vec[i].value, i);
+
+            // So does the copy of a single element
+            ThrowingCopy::copies_left = 1;
+            EXPECT_THROW(vec.insert(vec.begin() + index, source[0]), std::runtime_error);
+            EXPECT_EQ(ThrowingCopy::live, live);
+            EXPECT_EQ(vec.size(), 6);
+
+            ThrowingCopy::copies_left = 0;
+            vec.insert(vec.begin() + index, source.begin(), source.end());
+            ASSERT_EQ(vec.size(), 11);
+            for (std::size_t i = 0; i < 11; ++i) {
+                int expected = static_cast<int>(i < index ? i : i < index + 5 ? 100 + (i - index) : i - 5);
+                EXPECT_EQ(vec[i].value, expected);
+            }
+        }
+        EXPECT_EQ(ThrowingCopy::live, 5);
+    }
+
+    std::vector<int> ints {100, 101, 102, 103, 104};
+    for (std::size_t index : {0, 3, 6}) {
+        ThrowingConversion::conversions_left = 0;
+        Vector<ThrowingConversion> vec;
+        for (int i = 0; i < 6; ++i)
+            vec.emplace_back(i);
+
+        // The gap opened for the range is closed again
+        ThrowingConversion::conversions_left = 4;
+        EXPECT_THROW(vec.insert(vec.begin() + index, ints.begin(), ints.end()), std::runtime_error);
+        ASSERT_EQ(vec.size(), 6);
+        for (int i = 0; i < 6; ++i)
+            EXPECT_EQ(vec[i].value, i);
+    }
+}
+
+// A stateful allocator that keeps count of the bytes it has handed out
+template <typename T>
+struct CountingAllocator {
+    using value_type = T;
+    std::size_t* live;
+
+    explicit CountingAllocator(std::size_t* in_live) : live{in_live} {}
+    template <typename U>
+    CountingAllocator(const CountingAllocator<U>& rhs) : live{rhs.live} {}
+
+    T* allocate(std::size_t n) {
+        *live += n * sizeof(T);
+        return std::allocator<T>{}.allocate(n);
+    }
+
+    void deallocate(T* p, std::size_t n) {
+        *live -= n * sizeof(T);
+        std::allocator<T>{}.deallocate(p, n);
+    }
+
+    template <typename U>
+    bool operator==(const CountingAllocator<U>& rhs) const { return live == rhs.live; }
+    template <typename U>
+    bool operator!=(const CountingAllocator<U>& rhs) const { return live != rhs.live; }
+};
+
+TEST(Vector, allocators) {
+    using Alloc = CountingAllocator<std::string>;
+    std::size_t live {};
+    std::size_t other_live {};
+    {
+        Vector<std::string, Alloc> vec{Alloc{&live}};
+        EXPECT_EQ(live, 0);
+        for (int i = 0; i < 20; ++i)
+            vec.push_back(std::string(30, 'a' + i));
+        EXPECT_EQ(live, vec.capacity() * sizeof(std::string));
+
+        Vector<std::string, Alloc> copy(vec);
+        EXPECT_TRUE(copy.get_allocator() == vec.get_allocator());
+        EXPECT_TRUE(copy == vec);
+
+        // The allocator does not propagate, so the elements move into memory of the other allocator
+        Vector<std::string, Alloc> other{Alloc{&other_live}};
+        other = std::move(vec);
+        EXPECT_TRUE(other == copy);
+        EXPECT_TRUE(other.get_allocator() != copy.get_allocator());
+        EXPECT_EQ(other_live, other.capacity() * sizeof(std::string));
+
+        // Equal allocators let the buffer change owner
+        Vector<std::string, Alloc> stolen(std::move(copy), Alloc{&live});
+        EXPECT_TRUE(copy.empty());
+        EXPECT_EQ(stolen.size(), 20);
+    }
+    EXPECT_EQ(live, 0);
+    EXPECT_EQ(other_live, 0);
+
+    // With a polymorphic allocator every allocation, of the inner vectors too, comes from the arena
+    std::pmr::monotonic_buffer_resource arena;
+    {
+        DefaultResourceGuard guard;
+        using Inner = Vector<int, std::pmr::polymorphic_allocator<int>>;
+        Vector<Inner, std::pmr::polymorphic_allocator<Inner>> nested{std::pmr::polymorphic_allocator<Inner>{&arena}};
+        for (int i = 0; i < 20; ++i) {
+            nested.emplace_back();
+            for (int j = 0; j <= i; ++j)
+                nested.back().push_back(j);
+        }
+        EXPECT_EQ(nested[19].size(), 20);
+        EXPECT_EQ(nested[19][19], 19);
+        EXPECT_EQ(nested[0].get_allocator().resource(), &arena);
+    }
+}
+
+#if __has_include(<sys/mman.h>)
+TEST(Vector, huge_pages) {
+    using Alloc = HugePageAllocator<std::uint64_t>;
+    Vector<std::uint64_t, Alloc> vec{Alloc{4096, NumaPolicy::interleave, 1}};  // mapped from 512 elements on
+    for (std::uint64_t i = 0; i < 100; ++i)
+        vec.push_back(i);
+    EXPECT_FALSE(vec.get_allocator().mapped(vec.capacity()));
+
+    // A new mapping is aligned to a huge page, later ones may have been moved by mremap()
+    vec.reserve(1000);
+    EXPECT_TRUE(vec.get_allocator().mapped(vec.capacity()));
+    EXPECT_EQ(reinterpret_cast<std::uintptr_t>(&vec[0]) % huge_pages::page_size, 0);
+    EXPECT_EQ(vec[99], 99);
+    for (std::uint64_t i = 100; i < 1000000; ++i)
+        vec.push_back(i);
+    EXPECT_EQ(vec.size(), 1000000);
+    for (std::uint64_t i = 0; i < 1000000; i += 999)
+        EXPECT_EQ(vec[i], i);
+
+    Vector<std::uint64_t, Alloc> moved(std::move(vec));
+    EXPECT_EQ(moved.back(), 999999);
+    vec = moved;
+    EXPECT_TRUE(vec == moved);
+
+    // Elements that are not trivially copyable are moved to a new mapping one by one
+    Vector<std::string, HugePageAllocator<std::string>> strings{HugePageAllocator<std::string>{4096}};
+    for (int i = 0; i < 10000; ++i)
+        strings.push_back(std::to_string(i));
+    EXPECT_EQ(strings[9999], "9999");
+    Vector<std::string, HugePageAllocator<std::string>> copy(strings);
+    EXPECT_TRUE(copy == strings);
 }
+#endif
 
 TEST(Vector, swap) {
     Vector<int> vector_1 {1, 1, 1};